@@ -0,0 +1,108 @@
+import os
+import re
+import shutil
+import subprocess
+import sys
+import tempfile
+import time
+
+# split-push 可执行文件路径
+exe_path = "split-push.exe" if os.name == "nt" else "./split-push"
+# 每一轮生成的目录数量，逐轮翻倍
+directory_counts = [1000, 2000, 4000, 8000, 16000]
+# 每个目录下的小文件数量
+files_per_directory = 4
+# 每个目录的子目录数量（决定树的宽度）
+fanout = 8
+# 扫描线程数，0 表示使用默认值
+scan_threads = 0
+# 参与对比的扫描后端，Linux 下同时测量 FindFirstFile 兼容层、getdents64 和 io_uring 批量 statx
+scan_backends = ["find"] if os.name == "nt" else ["find", "getdents", "uring"]
+
+
+def build_tree(root, directory_count):
+    created = 0
+    pending = [root]
+    while pending and created < directory_count:
+        parent = pending.pop(0)
+        for i in range(fanout):
+            if created >= directory_count:
+                break
+            path = os.path.join(parent, f"d{i:02d}")
+            os.makedirs(path, exist_ok=True)
+            for j in range(files_per_directory):
+                with open(os.path.join(path, f"f{j:02d}.txt"), "wb") as f:
+                    f.write(b"x" * 128)
+            pending.append(path)
+            created += 1
+    return created
+
+
+def run_benchmark(tree_root, backend):
+    command = [exe_path, f"--bench-scan={tree_root}", f"--scan-backend={backend}"]
+    if scan_threads > 0:
+        command.append(f"--scan-threads={scan_threads}")
+    output = subprocess.run(
+        command, capture_output=True, text=True, encoding="utf-8", errors="replace"
+    ).stdout
+    match = re.search(
+        r"BENCH dirs=(\d+) entries=(\d+) seconds=([\d.]+) us_per_dir=([\d.]+) "
+        r"entries_per_sec=(\d+) backend=(\w+)",
+        output,
+    )
+    if not match:
+        print(output)
+        raise RuntimeError("未能解析基准测试输出")
+    if match.group(6) != backend:
+        print(f"  (后端 {backend} 不可用，实际使用 {match.group(6)})")
+    return (
+        int(match.group(1)),
+        int(match.group(2)),
+        float(match.group(3)),
+        float(match.group(4)),
+        int(match.group(5)),
+    )
+
+
+def main():
+    if len(sys.argv) > 1:
+        global exe_path
+        exe_path = sys.argv[1]
+    if not os.path.exists(exe_path):
+        print(f"找不到可执行文件: {exe_path}")
+        return
+    work_dir = tempfile.mkdtemp(prefix="scan-bench-")
+    print(f"临时目录: {work_dir}")
+    print(
+        f"{'后端':>9} {'目录数':>8} {'条目数':>10} {'耗时(秒)':>10} {'每目录(微秒)':>14} {'相对首轮':>10} {'相对find':>10} {'条目/秒':>12}"
+    )
+    baselines = {}
+    try:
+        for directory_count in directory_counts:
+            tree_root = os.path.join(work_dir, f"tree-{directory_count}")
+            os.makedirs(tree_root)
+            start = time.time()
+            build_tree(tree_root, directory_count)
+            print(f"  (生成 {directory_count} 个目录耗时 {time.time() - start:.1f} 秒)")
+            find_seconds = None
+            for backend in scan_backends:
+                dirs, entries, seconds, us_per_dir, entries_per_sec = run_benchmark(
+                    tree_root, backend
+                )
+                baseline = baselines.setdefault(backend, us_per_dir)
+                ratio = us_per_dir / baseline if baseline > 0 else 0
+                if find_seconds is None:
+                    find_seconds = seconds
+                speedup = find_seconds / seconds if seconds > 0 else 0
+                print(
+                    f"{backend:>9} {dirs:>8} {entries:>10} {seconds:>10.4f} {us_per_dir:>14.2f} {ratio:>10.2f} {speedup:>10.2f} {entries_per_sec:>12}"
+                )
+    finally:
+        shutil.rmtree(work_dir, ignore_errors=True)
+    print("每目录耗时保持稳定即说明扫描时间随目录树大小线性增长")
+    if len(scan_backends) > 1:
+        print("相对find 大于 1 表示该后端比 FindFirstFile 兼容层更快")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,1007 @@
+#ifndef COMPAT_H
+#define COMPAT_H
+
+#ifdef _WIN32
+#include <windows.h>
+#define compat_fopen fopen
+#else
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/fs.h>
+#include <linux/io_uring.h>
+#include <pthread.h>
+#include <sched.h>
+#include <signal.h>
+#include <stdarg.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/sendfile.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+#include <wchar.h>
+
+#define WINAPI
+#define TRUE 1
+#define FALSE 0
+#define MAX_PATH 260
+#define INFINITE 0xFFFFFFFF
+#define CP_ACP 0
+#define CP_UTF8 65001
+#define _TRUNCATE ((size_t)-1)
+#define _MAX_DRIVE 3
+#define _MAX_DIR 256
+#define _MAX_FNAME 256
+#define _MAX_EXT 256
+#define _countof(array) (sizeof(array) / sizeof((array)[0]))
+#define INVALID_HANDLE_VALUE ((HANDLE)(intptr_t)-1)
+#define INVALID_FILE_ATTRIBUTES ((DWORD)-1)
+#define FILE_ATTRIBUTE_DIRECTORY 0x10
+#define FILE_ATTRIBUTE_NORMAL 0x80
+#define FILE_ATTRIBUTE_REPARSE_POINT 0x400
+#define FILE_FLAG_BACKUP_SEMANTICS 0x02000000
+#define FILE_FLAG_SEQUENTIAL_SCAN 0x08000000
+#define FILE_READ_ATTRIBUTES 0x80
+#define GENERIC_READ 0x80000000
+#define GENERIC_WRITE 0x40000000
+#define FILE_SHARE_READ 1
+#define FILE_SHARE_WRITE 2
+#define FILE_SHARE_DELETE 4
+#define CREATE_ALWAYS 2
+#define OPEN_EXISTING 3
+#define OPEN_ALWAYS 4
+#define FILE_BEGIN 0
+#define FILE_CURRENT 1
+#define FILE_END 2
+#define PAGE_READONLY 2
+#define FILE_MAP_READ 4
+#define MOVEFILE_REPLACE_EXISTING 1
+#define FindExInfoBasic 1
+#define FindExSearchNameMatch 0
+#define FIND_FIRST_EX_LARGE_FETCH 2
+#define ERROR_FILE_NOT_FOUND 2
+#define ERROR_PATH_NOT_FOUND 3
+#define ERROR_ACCESS_DENIED 5
+#define ERROR_SHARING_VIOLATION 32
+#define ERROR_ALREADY_EXISTS 183
+#define GETDENTS_BUFFER_SIZE (64 * 1024)
+#define STATX_RING_ENTRIES 256
+
+typedef unsigned long DWORD;
+typedef int BOOL;
+typedef unsigned char BYTE;
+typedef long LONG;
+typedef long long LONGLONG;
+typedef void *HANDLE;
+typedef void *LPVOID;
+typedef pthread_mutex_t CRITICAL_SECTION;
+typedef DWORD (*LPTHREAD_START_ROUTINE)(LPVOID);
+typedef enum { GetFileExInfoStandard } GET_FILEEX_INFO_LEVELS;
+
+typedef union {
+  struct {
+    uint32_t LowPart;
+    uint32_t HighPart;
+  };
+  unsigned long long QuadPart;
+} ULARGE_INTEGER;
+
+typedef union {
+  struct {
+    uint32_t LowPart;
+    int32_t HighPart;
+  };
+  long long QuadPart;
+} LARGE_INTEGER;
+
+typedef struct {
+  uintptr_t Internal;
+  uintptr_t InternalHigh;
+  DWORD Offset;
+  DWORD OffsetHigh;
+  HANDLE hEvent;
+} OVERLAPPED;
+
+typedef struct {
+  uint32_t dwLowDateTime;
+  uint32_t dwHighDateTime;
+} FILETIME;
+
+typedef struct {
+  DWORD dwFileAttributes;
+  FILETIME ftCreationTime;
+  FILETIME ftLastAccessTime;
+  FILETIME ftLastWriteTime;
+  DWORD nFileSizeHigh;
+  DWORD nFileSizeLow;
+  wchar_t cFileName[MAX_PATH];
+} WIN32_FIND_DATAW;
+
+typedef struct {
+  DWORD dwFileAttributes;
+  FILETIME ftCreationTime;
+  FILETIME ftLastAccessTime;
+  FILETIME ftLastWriteTime;
+  DWORD nFileSizeHigh;
+  DWORD nFileSizeLow;
+} WIN32_FILE_ATTRIBUTE_DATA;
+
+typedef struct {
+  DWORD dwFileAttributes;
+  FILETIME ftCreationTime;
+  FILETIME ftLastAccessTime;
+  FILETIME ftLastWriteTime;
+  DWORD dwVolumeSerialNumber;
+  DWORD nFileSizeHigh;
+  DWORD nFileSizeLow;
+  DWORD nNumberOfLinks;
+  DWORD nFileIndexHigh;
+  DWORD nFileIndexLow;
+} BY_HANDLE_FILE_INFORMATION;
+
+typedef struct {
+  DWORD dwNumberOfProcessors;
+} SYSTEM_INFO;
+
+typedef enum {
+  COMPAT_HANDLE_FILE,
+  COMPAT_HANDLE_FIND,
+  COMPAT_HANDLE_THREAD,
+  COMPAT_HANDLE_MAPPING
+} CompatHandleKind;
+
+typedef struct {
+  CompatHandleKind kind;
+  int fd;
+  DIR *dir;
+  pthread_t thread;
+  LPTHREAD_START_ROUTINE start;
+  LPVOID param;
+  size_t size;
+} CompatHandle;
+
+typedef struct {
+  uint64_t d_ino;
+  int64_t d_off;
+  unsigned short d_reclen;
+  unsigned char d_type;
+  char d_name[];
+} LinuxDirent64;
+
+typedef struct CompatView {
+  struct CompatView *next;
+  void *address;
+  size_t size;
+} CompatView;
+
+static CompatView *g_compat_views = NULL;
+static pthread_mutex_t g_compat_views_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static inline DWORD GetLastError(void) {
+  switch (errno) {
+  case ENOENT:
+    return ERROR_FILE_NOT_FOUND;
+  case ENOTDIR:
+    return ERROR_PATH_NOT_FOUND;
+  case EACCES:
+  case EPERM:
+    return ERROR_ACCESS_DENIED;
+  case EBUSY:
+  case ETXTBSY:
+    return ERROR_SHARING_VIOLATION;
+  case EEXIST:
+    return ERROR_ALREADY_EXISTS;
+  default:
+    return (DWORD)errno;
+  }
+}
+
+static inline int MultiByteToWideChar(unsigned int code_page, DWORD flags,
+                                      const char *str, int length, wchar_t *out,
+                                      int out_size) {
+  const unsigned char *p = (const unsigned char *)str;
+  const unsigned char *end = length < 0 ? NULL : p + length;
+  int count = 0;
+  while (end ? p < end : 1) {
+    uint32_t c = *p++;
+    if (c >= 0xF0 && (p[0] & 0xC0) == 0x80 && (p[1] & 0xC0) == 0x80 &&
+        (p[2] & 0xC0) == 0x80) {
+      c = ((c & 0x07) << 18) | ((p[0] & 0x3F) << 12) | ((p[1] & 0x3F) << 6) |
+          (p[2] & 0x3F);
+      p += 3;
+    } else if (c >= 0xE0 && (p[0] & 0xC0) == 0x80 &&
+               (p[1] & 0xC0) == 0x80) {
+      c = ((c & 0x0F) << 12) | ((p[0] & 0x3F) << 6) | (p[1] & 0x3F);
+      p += 2;
+    } else if (c >= 0xC0 && (p[0] & 0xC0) == 0x80) {
+      c = ((c & 0x1F) << 6) | (p[0] & 0x3F);
+      p += 1;
+    } else if (c >= 0x80) {
+      c = 0xFFFD;
+    }
+    if (out) {
+      if (count >= out_size) {
+        return 0;
+      }
+      out[count] = (wchar_t)c;
+    }
+    count++;
+    if (!end && c == 0) {
+      break;
+    }
+  }
+  return count;
+}
+
+static inline int WideCharToMultiByte(unsigned int code_page, DWORD flags,
+                                      const wchar_t *wstr, int length,
+                                      char *out, int out_size,
+                                      const char *default_char,
+                                      BOOL *used_default) {
+  const wchar_t *end = length < 0 ? NULL : wstr + length;
+  int count = 0;
+  for (const wchar_t *p = wstr; end ? p < end : 1; p++) {
+    uint32_t c = (uint32_t)*p;
+    unsigned char bytes[4];
+    int n;
+    if (c < 0x80) {
+      bytes[0] = (unsigned char)c;
+      n = 1;
+    } else if (c < 0x800) {
+      bytes[0] = (unsigned char)(0xC0 | (c >> 6));
+      bytes[1] = (unsigned char)(0x80 | (c & 0x3F));
+      n = 2;
+    } else if (c < 0x10000) {
+      bytes[0] = (unsigned char)(0xE0 | (c >> 12));
+      bytes[1] = (unsigned char)(0x80 | ((c >> 6) & 0x3F));
+      bytes[2] = (unsigned char)(0x80 | (c & 0x3F));
+      n = 3;
+    } else {
+      bytes[0] = (unsigned char)(0xF0 | (c >> 18));
+      bytes[1] = (unsigned char)(0x80 | ((c >> 12) & 0x3F));
+      bytes[2] = (unsigned char)(0x80 | ((c >> 6) & 0x3F));
+      bytes[3] = (unsigned char)(0x80 | (c & 0x3F));
+      n = 4;
+    }
+    if (out) {
+      if (count + n > out_size) {
+        return 0;
+      }
+      memcpy(out + count, bytes, n);
+    }
+    count += n;
+    if (!end && c == 0) {
+      break;
+    }
+  }
+  return count;
+}
+
+static inline char *compat_narrow_path(const char *path) {
+  size_t length = strlen(path);
+  char *result = (char *)malloc(length + 1);
+  if (!result) {
+    return NULL;
+  }
+  for (size_t i = 0; i <= length; i++) {
+    result[i] = path[i] == '\\' ? '/' : path[i];
+  }
+  return result;
+}
+
+static inline char *compat_path(const wchar_t *wpath) {
+  int length = WideCharToMultiByte(CP_UTF8, 0, wpath, -1, NULL, 0, NULL, NULL);
+  char *result = (char *)malloc(length > 0 ? length : 1);
+  if (!result) {
+    return NULL;
+  }
+  WideCharToMultiByte(CP_UTF8, 0, wpath, -1, result, length, NULL, NULL);
+  for (char *p = result; *p; p++) {
+    if (*p == '\\') {
+      *p = '/';
+    }
+  }
+  return result;
+}
+
+static inline void compat_filetime(const struct timespec *time,
+                                   FILETIME *filetime) {
+  unsigned long long value =
+      ((unsigned long long)time->tv_sec + 11644473600ULL) * 10000000ULL +
+      (unsigned long long)time->tv_nsec / 100;
+  filetime->dwLowDateTime = (uint32_t)value;
+  filetime->dwHighDateTime = (uint32_t)(value >> 32);
+}
+
+static inline DWORD compat_attributes(const struct stat *st, int is_link) {
+  DWORD attributes =
+      S_ISDIR(st->st_mode) ? FILE_ATTRIBUTE_DIRECTORY : FILE_ATTRIBUTE_NORMAL;
+  return is_link ? attributes | FILE_ATTRIBUTE_REPARSE_POINT : attributes;
+}
+
+static inline int compat_stat_at(int dir_fd, const char *name,
+                                 WIN32_FIND_DATAW *data) {
+  struct stat st;
+  if (fstatat(dir_fd, name, &st, AT_SYMLINK_NOFOLLOW) != 0) {
+    return 0;
+  }
+  int is_link = S_ISLNK(st.st_mode);
+  struct stat target;
+  const struct stat *type = &st;
+  if (is_link && fstatat(dir_fd, name, &target, 0) == 0) {
+    type = &target;
+  }
+  data->dwFileAttributes = compat_attributes(type, is_link);
+  long long size = S_ISDIR(type->st_mode) ? 0 : (long long)st.st_size;
+  data->nFileSizeLow = (DWORD)(size & 0xFFFFFFFF);
+  data->nFileSizeHigh = (DWORD)(size >> 32);
+  compat_filetime(&st.st_mtim, &data->ftLastWriteTime);
+  data->ftCreationTime = data->ftLastWriteTime;
+  data->ftLastAccessTime = data->ftLastWriteTime;
+  return 1;
+}
+
+static inline BOOL compat_find_next(CompatHandle *handle,
+                                    WIN32_FIND_DATAW *find_data) {
+  struct dirent *entry;
+  while ((entry = readdir(handle->dir)) != NULL) {
+    if (!compat_stat_at(dirfd(handle->dir), entry->d_name, find_data)) {
+      continue;
+    }
+    MultiByteToWideChar(CP_UTF8, 0, entry->d_name, -1, find_data->cFileName,
+                        MAX_PATH);
+    find_data->cFileName[MAX_PATH - 1] = L'\0';
+    return TRUE;
+  }
+  return FALSE;
+}
+
+static inline HANDLE FindFirstFileW(const wchar_t *pattern,
+                                    WIN32_FIND_DATAW *find_data) {
+  char *path = compat_path(pattern);
+  if (!path) {
+    return INVALID_HANDLE_VALUE;
+  }
+  char *wildcard = strrchr(path, '/');
+  if (wildcard && strcmp(wildcard, "/*") == 0) {
+    *wildcard = '\0';
+  } else if (strcmp(path, "*") == 0) {
+    strcpy(path, ".");
+  }
+  DIR *dir = opendir(path);
+  free(path);
+  if (!dir) {
+    return INVALID_HANDLE_VALUE;
+  }
+  CompatHandle *handle = (CompatHandle *)calloc(1, sizeof(CompatHandle));
+  handle->kind = COMPAT_HANDLE_FIND;
+  handle->dir = dir;
+  if (!compat_find_next(handle, find_data)) {
+    closedir(dir);
+    free(handle);
+    return INVALID_HANDLE_VALUE;
+  }
+  return handle;
+}
+
+static inline HANDLE FindFirstFileExW(const wchar_t *pattern, int info_level,
+                                      WIN32_FIND_DATAW *find_data,
+                                      int search_op, void *filter,
+                                      DWORD flags) {
+  return FindFirstFileW(pattern, find_data);
+}
+
+static inline BOOL FindNextFileW(HANDLE handle, WIN32_FIND_DATAW *find_data) {
+  return compat_find_next((CompatHandle *)handle, find_data);
+}
+
+static inline BOOL FindClose(HANDLE handle) {
+  closedir(((CompatHandle *)handle)->dir);
+  free(handle);
+  return TRUE;
+}
+
+static inline DWORD compat_get_attributes(const char *path) {
+  struct stat st, link;
+  if (!path || stat(path, &st) != 0) {
+    return INVALID_FILE_ATTRIBUTES;
+  }
+  int is_link = lstat(path, &link) == 0 && S_ISLNK(link.st_mode);
+  return compat_attributes(&st, is_link);
+}
+
+static inline DWORD GetFileAttributesW(const wchar_t *wpath) {
+  char *path = compat_path(wpath);
+  DWORD attributes = compat_get_attributes(path);
+  free(path);
+  return attributes;
+}
+
+static inline DWORD GetFileAttributesA(const char *name) {
+  char *path = compat_narrow_path(name);
+  DWORD attributes = compat_get_attributes(path);
+  free(path);
+  return attributes;
+}
+
+static inline BOOL GetFileAttributesExW(const wchar_t *wpath,
+                                        GET_FILEEX_INFO_LEVELS level,
+                                        void *out) {
+  char *path = compat_path(wpath);
+  WIN32_FIND_DATAW find_data;
+  int ok = path && compat_stat_at(AT_FDCWD, path, &find_data);
+  free(path);
+  if (!ok) {
+    return FALSE;
+  }
+  WIN32_FILE_ATTRIBUTE_DATA *data = (WIN32_FILE_ATTRIBUTE_DATA *)out;
+  data->dwFileAttributes = find_data.dwFileAttributes;
+  data->ftCreationTime = find_data.ftCreationTime;
+  data->ftLastAccessTime = find_data.ftLastAccessTime;
+  data->ftLastWriteTime = find_data.ftLastWriteTime;
+  data->nFileSizeHigh = find_data.nFileSizeHigh;
+  data->nFileSizeLow = find_data.nFileSizeLow;
+  return TRUE;
+}
+
+static inline HANDLE CreateFileW(const wchar_t *wpath, DWORD access,
+                                 DWORD share_mode, void *security,
+                                 DWORD disposition, DWORD flags,
+                                 HANDLE template_file) {
+  char *path = compat_path(wpath);
+  if (!path) {
+    return INVALID_HANDLE_VALUE;
+  }
+  int open_flags = O_RDONLY;
+  if ((access & GENERIC_READ) && (access & GENERIC_WRITE)) {
+    open_flags = O_RDWR;
+  } else if (access & GENERIC_WRITE) {
+    open_flags = O_WRONLY;
+  }
+  if (disposition == CREATE_ALWAYS) {
+    open_flags |= O_CREAT | O_TRUNC;
+  } else if (disposition == OPEN_ALWAYS) {
+    open_flags |= O_CREAT;
+  }
+  int fd = open(path, open_flags | O_CLOEXEC, 0666);
+  free(path);
+  if (fd < 0) {
+    return INVALID_HANDLE_VALUE;
+  }
+  CompatHandle *handle = (CompatHandle *)calloc(1, sizeof(CompatHandle));
+  handle->kind = COMPAT_HANDLE_FILE;
+  handle->fd = fd;
+  return handle;
+}
+
+static inline BOOL
+GetFileInformationByHandle(HANDLE handle, BY_HANDLE_FILE_INFORMATION *info) {
+  struct stat st;
+  if (fstat(((CompatHandle *)handle)->fd, &st) != 0) {
+    return FALSE;
+  }
+  memset(info, 0, sizeof(BY_HANDLE_FILE_INFORMATION));
+  info->dwFileAttributes = compat_attributes(&st, 0);
+  compat_filetime(&st.st_mtim, &info->ftLastWriteTime);
+  info->ftCreationTime = info->ftLastWriteTime;
+  info->ftLastAccessTime = info->ftLastWriteTime;
+  info->dwVolumeSerialNumber = (DWORD)st.st_dev;
+  info->nFileSizeHigh = (DWORD)((unsigned long long)st.st_size >> 32);
+  info->nFileSizeLow = (DWORD)(st.st_size & 0xFFFFFFFF);
+  info->nNumberOfLinks = (DWORD)st.st_nlink;
+  info->nFileIndexHigh = (DWORD)((unsigned long long)st.st_ino >> 32);
+  info->nFileIndexLow = (DWORD)(st.st_ino & 0xFFFFFFFF);
+  return TRUE;
+}
+
+static inline DWORD GetFileSize(HANDLE handle, DWORD *size_high) {
+  struct stat st;
+  if (fstat(((CompatHandle *)handle)->fd, &st) != 0) {
+    st.st_size = 0;
+  }
+  if (size_high) {
+    *size_high = (DWORD)((unsigned long long)st.st_size >> 32);
+  }
+  return (DWORD)(st.st_size & 0xFFFFFFFF);
+}
+
+static inline BOOL GetFileSizeEx(HANDLE handle, LARGE_INTEGER *size) {
+  struct stat st;
+  if (fstat(((CompatHandle *)handle)->fd, &st) != 0) {
+    return FALSE;
+  }
+  size->QuadPart = st.st_size;
+  return TRUE;
+}
+
+static inline BOOL GetFileTime(HANDLE handle, FILETIME *creation,
+                               FILETIME *access, FILETIME *write) {
+  BY_HANDLE_FILE_INFORMATION info;
+  if (!GetFileInformationByHandle(handle, &info)) {
+    return FALSE;
+  }
+  if (creation) {
+    *creation = info.ftCreationTime;
+  }
+  if (access) {
+    *access = info.ftLastAccessTime;
+  }
+  if (write) {
+    *write = info.ftLastWriteTime;
+  }
+  return TRUE;
+}
+
+static inline BOOL ReadFile(HANDLE handle, void *buffer, DWORD size,
+                            DWORD *read_size, OVERLAPPED *overlapped) {
+  int fd = ((CompatHandle *)handle)->fd;
+  ssize_t result =
+      overlapped ? pread(fd, buffer, size,
+                         ((off_t)overlapped->OffsetHigh << 32) |
+                             overlapped->Offset)
+                 : read(fd, buffer, size);
+  if (result < 0) {
+    return FALSE;
+  }
+  if (read_size) {
+    *read_size = (DWORD)result;
+  }
+  return TRUE;
+}
+
+static inline BOOL WriteFile(HANDLE handle, const void *buffer, DWORD size,
+                             DWORD *written_size, OVERLAPPED *overlapped) {
+  int fd = ((CompatHandle *)handle)->fd;
+  ssize_t result =
+      overlapped ? pwrite(fd, buffer, size,
+                          ((off_t)overlapped->OffsetHigh << 32) |
+                              overlapped->Offset)
+                 : write(fd, buffer, size);
+  if (result < 0) {
+    return FALSE;
+  }
+  if (written_size) {
+    *written_size = (DWORD)result;
+  }
+  return TRUE;
+}
+
+static inline BOOL SetFilePointerEx(HANDLE handle, LARGE_INTEGER distance,
+                                    LARGE_INTEGER *new_position, DWORD method) {
+  int whence = method == FILE_BEGIN     ? SEEK_SET
+               : method == FILE_CURRENT ? SEEK_CUR
+                                        : SEEK_END;
+  off_t position =
+      lseek(((CompatHandle *)handle)->fd, distance.QuadPart, whence);
+  if (position < 0) {
+    return FALSE;
+  }
+  if (new_position) {
+    new_position->QuadPart = position;
+  }
+  return TRUE;
+}
+
+static inline HANDLE CreateFileMappingW(HANDLE file, void *security,
+                                        DWORD protect, DWORD size_high,
+                                        DWORD size_low, const wchar_t *name) {
+  struct stat st;
+  if (fstat(((CompatHandle *)file)->fd, &st) != 0 || st.st_size == 0) {
+    return NULL;
+  }
+  CompatHandle *handle = (CompatHandle *)calloc(1, sizeof(CompatHandle));
+  handle->kind = COMPAT_HANDLE_MAPPING;
+  handle->fd = dup(((CompatHandle *)file)->fd);
+  handle->size = (size_t)st.st_size;
+  return handle;
+}
+
+static inline void *MapViewOfFile(HANDLE mapping, DWORD access,
+                                  DWORD offset_high, DWORD offset_low,
+                                  size_t size) {
+  CompatHandle *handle = (CompatHandle *)mapping;
+  void *address =
+      mmap(NULL, handle->size, PROT_READ, MAP_PRIVATE, handle->fd, 0);
+  if (address == MAP_FAILED) {
+    return NULL;
+  }
+  CompatView *view = (CompatView *)malloc(sizeof(CompatView));
+  view->address = address;
+  view->size = handle->size;
+  pthread_mutex_lock(&g_compat_views_lock);
+  view->next = g_compat_views;
+  g_compat_views = view;
+  pthread_mutex_unlock(&g_compat_views_lock);
+  return address;
+}
+
+static inline BOOL UnmapViewOfFile(const void *address) {
+  pthread_mutex_lock(&g_compat_views_lock);
+  CompatView **link = &g_compat_views;
+  while (*link && (*link)->address != address) {
+    link = &(*link)->next;
+  }
+  CompatView *view = *link;
+  if (view) {
+    *link = view->next;
+  }
+  pthread_mutex_unlock(&g_compat_views_lock);
+  if (!view) {
+    return FALSE;
+  }
+  munmap(view->address, view->size);
+  free(view);
+  return TRUE;
+}
+
+static inline BOOL CloseHandle(HANDLE object) {
+  CompatHandle *handle = (CompatHandle *)object;
+  if (!handle || handle == INVALID_HANDLE_VALUE) {
+    return FALSE;
+  }
+  if (handle->kind == COMPAT_HANDLE_FILE ||
+      handle->kind == COMPAT_HANDLE_MAPPING) {
+    close(handle->fd);
+  }
+  free(handle);
+  return TRUE;
+}
+
+static inline BOOL CreateDirectoryW(const wchar_t *wpath, void *security) {
+  char *path = compat_path(wpath);
+  int result = path ? mkdir(path, 0777) : -1;
+  free(path);
+  return result == 0;
+}
+
+static inline BOOL RemoveDirectoryW(const wchar_t *wpath) {
+  char *path = compat_path(wpath);
+  int result = path ? rmdir(path) : -1;
+  free(path);
+  return result == 0;
+}
+
+static inline BOOL DeleteFileW(const wchar_t *wpath) {
+  char *path = compat_path(wpath);
+  int result = path ? unlink(path) : -1;
+  free(path);
+  return result == 0;
+}
+
+static inline int _wremove(const wchar_t *wpath) {
+  return DeleteFileW(wpath) ? 0 : -1;
+}
+
+static inline BOOL MoveFileExW(const wchar_t *wfrom, const wchar_t *wto,
+                               DWORD flags) {
+  char *from = compat_path(wfrom);
+  char *to = compat_path(wto);
+  int result = from && to ? rename(from, to) : -1;
+  free(from);
+  free(to);
+  return result == 0;
+}
+
+static inline BOOL CopyFileW(const wchar_t *wfrom, const wchar_t *wto,
+                             BOOL fail_if_exists) {
+  char *from = compat_path(wfrom);
+  char *to = compat_path(wto);
+  int in = from ? open(from, O_RDONLY | O_CLOEXEC) : -1;
+  int out = in >= 0 && to
+                ? open(to,
+                       O_WRONLY | O_CREAT | O_CLOEXEC |
+                           (fail_if_exists ? O_EXCL : O_TRUNC),
+                       0666)
+                : -1;
+  free(from);
+  free(to);
+  int ok = in >= 0 && out >= 0;
+  char buffer[64 * 1024];
+  ssize_t got;
+  while (ok && (got = read(in, buffer, sizeof(buffer))) > 0) {
+    ok = write(out, buffer, (size_t)got) == got;
+  }
+  if (in >= 0) {
+    close(in);
+  }
+  if (out >= 0) {
+    close(out);
+  }
+  return ok;
+}
+
+static inline FILE *_wfopen(const wchar_t *wpath, const wchar_t *wmode) {
+  char *path = compat_path(wpath);
+  char *mode = compat_path(wmode);
+  FILE *file = path && mode ? fopen(path, mode) : NULL;
+  free(path);
+  free(mode);
+  return file;
+}
+
+static inline FILE *compat_fopen(const char *name, const char *mode) {
+  char *path = compat_narrow_path(name);
+  FILE *file = path ? fopen(path, mode) : NULL;
+  free(path);
+  return file;
+}
+
+static inline int _wsystem(const wchar_t *wcommand) {
+  char *command = compat_path(wcommand);
+  if (!command) {
+    return -1;
+  }
+  const char *null_redirects[] = {" >nul", " >nul 2>&1"};
+  size_t length = strlen(command);
+  for (int i = 0; i < 2; i++) {
+    size_t suffix = strlen(null_redirects[i]);
+    if (length < suffix ||
+        strcmp(command + length - suffix, null_redirects[i]) != 0) {
+      continue;
+    }
+    char *expanded = (char *)malloc(length + 7);
+    if (!expanded) {
+      free(command);
+      return -1;
+    }
+    memcpy(expanded, command, length - suffix);
+    sprintf(expanded + length - suffix, " >/dev/null%s",
+            null_redirects[i] + 5);
+    free(command);
+    command = expanded;
+    break;
+  }
+  int status = system(command);
+  free(command);
+  return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+}
+
+static inline FILE *_popen(const char *command, const char *mode) {
+  if (mode[0] == 'w') {
+    signal(SIGPIPE, SIG_IGN);
+  }
+  return popen(command, mode[0] == 'w' ? "w" : "r");
+}
+
+static inline int _pclose(FILE *pipe) {
+  int status = pclose(pipe);
+  return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+}
+
+static inline int _snwprintf_s(wchar_t *buffer, size_t buffer_size,
+                               size_t count, const wchar_t *format, ...) {
+  va_list args;
+  va_start(args, format);
+  int result = vswprintf(buffer, buffer_size, format, args);
+  va_end(args);
+  if (result < 0 && buffer_size > 0) {
+    buffer[buffer_size - 1] = L'\0';
+  }
+  return result;
+}
+
+static inline int strcpy_s(char *dest, size_t dest_size, const char *src) {
+  size_t length = strlen(src);
+  if (length >= dest_size) {
+    if (dest_size > 0) {
+      dest[0] = '\0';
+    }
+    return ERANGE;
+  }
+  memcpy(dest, src, length + 1);
+  return 0;
+}
+
+static inline int strncpy_s(char *dest, size_t dest_size, const char *src,
+                            size_t count) {
+  size_t length = strnlen(src, count);
+  if (length >= dest_size) {
+    if (dest_size > 0) {
+      dest[0] = '\0';
+    }
+    return ERANGE;
+  }
+  memcpy(dest, src, length);
+  dest[length] = '\0';
+  return 0;
+}
+
+static inline int wcscpy_s(wchar_t *dest, size_t dest_size,
+                           const wchar_t *src) {
+  size_t length = wcslen(src);
+  if (length >= dest_size) {
+    if (dest_size > 0) {
+      dest[0] = L'\0';
+    }
+    return ERANGE;
+  }
+  wmemcpy(dest, src, length + 1);
+  return 0;
+}
+
+static inline int wcsncpy_s(wchar_t *dest, size_t dest_size, const wchar_t *src,
+                            size_t count) {
+  size_t length = wcsnlen(src, count);
+  if (length >= dest_size) {
+    if (dest_size > 0) {
+      dest[0] = L'\0';
+    }
+    return ERANGE;
+  }
+  wmemcpy(dest, src, length);
+  dest[length] = L'\0';
+  return 0;
+}
+
+static inline int wcscat_s(wchar_t *dest, size_t dest_size,
+                           const wchar_t *src) {
+  size_t length = wcslen(dest);
+  if (length >= dest_size) {
+    return ERANGE;
+  }
+  return wcscpy_s(dest + length, dest_size - length, src);
+}
+
+static inline int _wtoi(const wchar_t *str) {
+  return (int)wcstol(str, NULL, 10);
+}
+
+static inline wchar_t *_wcsdup(const wchar_t *str) { return wcsdup(str); }
+
+static inline int _wsplitpath_s(const wchar_t *path, wchar_t *drive,
+                                size_t drive_size, wchar_t *dir,
+                                size_t dir_size, wchar_t *fname,
+                                size_t fname_size, wchar_t *ext,
+                                size_t ext_size) {
+  const wchar_t *base = path;
+  for (const wchar_t *p = path; *p; p++) {
+    if (*p == L'\\' || *p == L'/') {
+      base = p + 1;
+    }
+  }
+  const wchar_t *dot = wcsrchr(base, L'.');
+  if (!dot || dot == base) {
+    dot = base + wcslen(base);
+  }
+  drive[0] = L'\0';
+  wcsncpy_s(dir, dir_size, path, (size_t)(base - path));
+  wcsncpy_s(fname, fname_size, base, (size_t)(dot - base));
+  wcsncpy_s(ext, ext_size, dot, wcslen(dot));
+  return 0;
+}
+
+static inline int _wmakepath_s(wchar_t *path, size_t path_size,
+                               const wchar_t *drive, const wchar_t *dir,
+                               const wchar_t *fname, const wchar_t *ext) {
+  return swprintf(path, path_size, L"%ls%ls%ls%ls", drive, dir, fname, ext) <
+                 0
+             ? ERANGE
+             : 0;
+}
+
+static inline DWORD GetTempPathA(DWORD size, char *buffer) {
+  const char *tmp = getenv("TMPDIR");
+  int length = snprintf(buffer, size, "%s/", tmp && *tmp ? tmp : "/tmp");
+  return length < 0 || (DWORD)length >= size ? 0 : (DWORD)length;
+}
+
+static inline DWORD GetCurrentDirectoryA(DWORD size, char *buffer) {
+  return getcwd(buffer, size) ? (DWORD)strlen(buffer) : 0;
+}
+
+static inline DWORD GetCurrentDirectoryW(DWORD size, wchar_t *buffer) {
+  char path[4096];
+  if (!getcwd(path, sizeof(path))) {
+    return 0;
+  }
+  int length = MultiByteToWideChar(CP_UTF8, 0, path, -1, buffer, (int)size);
+  for (wchar_t *p = buffer; length > 0 && *p; p++) {
+    if (*p == L'/') {
+      *p = L'\\';
+    }
+  }
+  return length > 0 ? (DWORD)(length - 1) : 0;
+}
+
+static inline DWORD GetFullPathNameW(const wchar_t *wpath, DWORD size,
+                                     wchar_t *buffer, wchar_t **file_part) {
+  if (wpath[0] == L'\\' || wpath[0] == L'/') {
+    return wcscpy_s(buffer, size, wpath) == 0 ? (DWORD)wcslen(buffer) : 0;
+  }
+  DWORD length = GetCurrentDirectoryW(size, buffer);
+  if (length == 0 || length + 1 + wcslen(wpath) >= size) {
+    return 0;
+  }
+  buffer[length] = L'/';
+  wcscpy_s(buffer + length + 1, size - length - 1, wpath);
+  return (DWORD)wcslen(buffer);
+}
+
+static inline DWORD GetCurrentProcessId(void) { return (DWORD)getpid(); }
+
+static inline BOOL SetConsoleOutputCP(unsigned int code_page) { return TRUE; }
+
+static inline BOOL QueryPerformanceFrequency(LARGE_INTEGER *frequency) {
+  frequency->QuadPart = 1000000000LL;
+  return TRUE;
+}
+
+static inline BOOL QueryPerformanceCounter(LARGE_INTEGER *counter) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  counter->QuadPart = now.tv_sec * 1000000000LL + now.tv_nsec;
+  return TRUE;
+}
+
+static inline void GetSystemInfo(SYSTEM_INFO *info) {
+  long processors = sysconf(_SC_NPROCESSORS_ONLN);
+  info->dwNumberOfProcessors = processors > 0 ? (DWORD)processors : 1;
+}
+
+static inline void *compat_thread_main(void *param) {
+  CompatHandle *handle = (CompatHandle *)param;
+  handle->start(handle->param);
+  return NULL;
+}
+
+static inline HANDLE CreateThread(void *security, size_t stack_size,
+                                  LPTHREAD_START_ROUTINE start, LPVOID param,
+                                  DWORD flags, DWORD *thread_id) {
+  CompatHandle *handle = (CompatHandle *)calloc(1, sizeof(CompatHandle));
+  handle->kind = COMPAT_HANDLE_THREAD;
+  handle->start = start;
+  handle->param = param;
+  if (pthread_create(&handle->thread, NULL, compat_thread_main, handle) != 0) {
+    free(handle);
+    return NULL;
+  }
+  return handle;
+}
+
+static inline DWORD WaitForSingleObject(HANDLE object, DWORD milliseconds) {
+  CompatHandle *handle = (CompatHandle *)object;
+  if (handle->kind == COMPAT_HANDLE_THREAD && handle->start) {
+    pthread_join(handle->thread, NULL);
+    handle->start = NULL;
+  }
+  return 0;
+}
+
+static inline void InitializeCriticalSection(CRITICAL_SECTION *lock) {
+  pthread_mutex_init(lock, NULL);
+}
+
+static inline void DeleteCriticalSection(CRITICAL_SECTION *lock) {
+  pthread_mutex_destroy(lock);
+}
+
+static inline void EnterCriticalSection(CRITICAL_SECTION *lock) {
+  pthread_mutex_lock(lock);
+}
+
+static inline void LeaveCriticalSection(CRITICAL_SECTION *lock) {
+  pthread_mutex_unlock(lock);
+}
+
+static inline LONG InterlockedIncrement(volatile LONG *value) {
+  return __atomic_add_fetch(value, 1, __ATOMIC_SEQ_CST);
+}
+
+static inline LONG InterlockedDecrement(volatile LONG *value) {
+  return __atomic_sub_fetch(value, 1, __ATOMIC_SEQ_CST);
+}
+
+static inline LONG InterlockedCompareExchange(volatile LONG *value,
+                                              LONG exchange, LONG comparand) {
+  __atomic_compare_exchange_n(value, &comparand, exchange, 0,
+                              __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+  return comparand;
+}
+
+static inline BOOL SwitchToThread(void) { return sched_yield() == 0; }
+
+static inline void Sleep(DWORD milliseconds) { usleep(milliseconds * 1000); }
+#endif
+#endif
@@ -1,11 +1,65 @@
+#ifndef _WIN32
+#define _GNU_SOURCE
+#endif
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <windows.h>
+#include "compat.h"
+#include "split-manifest.h"
+#include "parallel-walk.h"
 
 #define MAX_PATH_LENGTH 4096
 #define BUFFER_SIZE (1024 * 1024)
+#define MAX_SCAN_DEPTH 256
+#define MAX_SCAN_THREADS 64
+#ifdef _WIN32
+#define DEFAULT_SCAN_BACKEND SCAN_BACKEND_FIND
+#else
+#define DEFAULT_SCAN_BACKEND SCAN_BACKEND_GETDENTS
+#endif
+
+typedef enum { SCAN_BACKEND_FIND, SCAN_BACKEND_GETDENTS } ScanBackend;
+
+struct DirNode {
+  const struct DirNode *parent;
+  const wchar_t *name;
+  int name_length;
+  int depth;
+};
+
+typedef int (*WalkEntryCallback)(void *context, int worker_index,
+                                 const wchar_t *full_path,
+                                 const WIN32_FIND_DATAW *find_data);
+
+typedef struct {
+  WalkDeque *deques;
+  int thread_count;
+  int max_depth;
+  volatile LONG pending;
+  WalkEntryCallback on_entry;
+  void *context;
+  long long directories_scanned;
+  long long entries_scanned;
+  size_t node_bytes;
+} ParallelWalker;
+
+typedef struct {
+  ParallelWalker *walker;
+  int index;
+  Arena arena;
+  long long directories_scanned;
+  long long entries_scanned;
+} WalkWorker;
+
+typedef struct {
+  wchar_t **dirs;
+  int count;
+  int capacity;
+} SplitDirBucket;
+
+int g_scan_threads = 0;
+ScanBackend g_scan_backend = DEFAULT_SCAN_BACKEND;
 
 void *safe_malloc(size_t size) {
   void *ptr = malloc(size);
@@ -16,6 +70,16 @@ void *safe_malloc(size_t size) {
   return ptr;
 }
 
+void *safe_realloc(void *ptr, size_t size) {
+  void *new_ptr = realloc(ptr, size);
+  if (!new_ptr && size > 0) {
+    fprintf(stderr, "错误：内存重新分配失败（请求大小：%zu 字节）\n", size);
+    free(ptr);
+    exit(EXIT_FAILURE);
+  }
+  return new_ptr;
+}
+
 char *ansi_to_utf8(const char *ansi_str) {
   if (!ansi_str)
     return NULL;
@@ -87,7 +151,8 @@ void remove_quotes(char *str) {
 
 int safe_path_join(wchar_t *dest, size_t dest_size, const wchar_t *path1,
                    const wchar_t *path2) {
-  if (_snwprintf_s(dest, dest_size, _TRUNCATE, L"%s\\%s", path1, path2) < 0) {
+  if (_snwprintf_s(dest, dest_size, _TRUNCATE, L"%ls\\%ls", path1, path2) <
+      0) {
     dest[dest_size - 1] = L'\0';
     return 0;
   }
@@ -150,6 +215,8 @@ int create_directory_recursive(const wchar_t *wpath) {
 typedef struct {
   wchar_t path[MAX_PATH_LENGTH];
   int part_number;
+  long long size;
+  unsigned long long hash;
 } PartFile;
 
 int compare_part_files(const void *a, const void *b) {
@@ -212,6 +279,42 @@ int get_part_files(const wchar_t *split_dir, PartFile **part_files,
   return 1;
 }
 
+int split_manifest_read(const wchar_t *split_dir, SplitManifest *manifest) {
+  memset(manifest, 0, sizeof(SplitManifest));
+  wchar_t manifest_path[MAX_PATH_LENGTH];
+  if (!safe_path_join(manifest_path, MAX_PATH_LENGTH, split_dir,
+                      L"" SPLIT_MANIFEST_NAME)) {
+    return 0;
+  }
+  FILE *file = _wfopen(manifest_path, L"rb");
+  if (!file) {
+    return 0;
+  }
+  return split_manifest_parse(file, manifest);
+}
+
+int get_manifest_part_files(const wchar_t *split_dir,
+                            const SplitManifest *manifest,
+                            PartFile **part_files, int *file_count) {
+  *part_files = (PartFile *)safe_malloc(sizeof(PartFile) * manifest->part_count);
+  *file_count = 0;
+  for (int i = 0; i < manifest->part_count; i++) {
+    PartFile *current = &((*part_files)[i]);
+    wchar_t *wname = char_to_wchar(manifest->parts[i].name);
+    int ok = wname && safe_path_join(current->path, MAX_PATH_LENGTH, split_dir,
+                                     wname);
+    free(wname);
+    if (!ok) {
+      return 0;
+    }
+    current->part_number = i + 1;
+    current->size = manifest->parts[i].size;
+    current->hash = manifest->parts[i].hash;
+    (*file_count)++;
+  }
+  return 1;
+}
+
 int get_merged_file_path(const wchar_t *split_dir, wchar_t *merged_path,
                          size_t merged_path_size) {
   wchar_t temp_path[MAX_PATH_LENGTH];
@@ -228,7 +331,7 @@ int get_merged_file_path(const wchar_t *split_dir, wchar_t *merged_path,
   _wsplitpath_s(original_path, drive, _MAX_DRIVE, dir, _MAX_DIR, fname,
                 _MAX_FNAME, ext, _MAX_EXT);
   wchar_t merged_fname[_MAX_FNAME + 50];
-  _snwprintf_s(merged_fname, _countof(merged_fname), _TRUNCATE, L"%s-merged",
+  _snwprintf_s(merged_fname, _countof(merged_fname), _TRUNCATE, L"%ls-merged",
                fname);
   _wmakepath_s(merged_path, merged_path_size, drive, dir, merged_fname, ext);
   return 1;
@@ -237,7 +340,19 @@ int get_merged_file_path(const wchar_t *split_dir, wchar_t *merged_path,
 int merge_part_files(const wchar_t *split_dir, const wchar_t *output_file) {
   PartFile *part_files = NULL;
   int file_count = 0;
-  if (!get_part_files(split_dir, &part_files, &file_count)) {
+  SplitManifest manifest;
+  int has_manifest = split_manifest_read(split_dir, &manifest);
+  if (has_manifest) {
+    if (!get_manifest_part_files(split_dir, &manifest, &part_files,
+                                 &file_count)) {
+      printf("  ❌ 无法解析拆分清单中的分块路径\n");
+      free(part_files);
+      split_manifest_free(&manifest);
+      return 0;
+    }
+    printf("  🔐 使用拆分清单：%d 个分块，文件哈希 %016llx\n", file_count,
+           manifest.file_hash);
+  } else if (!get_part_files(split_dir, &part_files, &file_count)) {
     printf("  ❌ 无法在目录中找到分块文件\n");
     return 0;
   }
@@ -262,6 +377,7 @@ int merge_part_files(const wchar_t *split_dir, const wchar_t *output_file) {
     DWORD error = GetLastError();
     printf("  ❌ 无法创建输出文件（错误：%lu）\n", error);
     free(part_files);
+    split_manifest_free(&manifest);
     return 0;
   }
   BYTE *buffer = (BYTE *)safe_malloc(BUFFER_SIZE);
@@ -283,6 +399,9 @@ int merge_part_files(const wchar_t *split_dir, const wchar_t *output_file) {
       continue;
     }
     DWORD bytes_read, bytes_written;
+    Xxh64State state;
+    xxh64_init(&state);
+    long long part_written = 0;
     while (ReadFile(hPart, buffer, BUFFER_SIZE, &bytes_read, NULL) &&
            bytes_read > 0) {
       if (!WriteFile(hOutput, buffer, bytes_read, &bytes_written, NULL) ||
@@ -291,9 +410,22 @@ int merge_part_files(const wchar_t *split_dir, const wchar_t *output_file) {
         success = 0;
         break;
       }
-      total_written += bytes_written;
+      if (has_manifest) {
+        xxh64_update(&state, buffer, bytes_read);
+      }
+      part_written += bytes_written;
     }
+    total_written += part_written;
     CloseHandle(hPart);
+    if (success && has_manifest) {
+      unsigned long long hash = xxh64_digest(&state);
+      if (part_written != part_files[i].size || hash != part_files[i].hash) {
+        printf("  ❌ 分块校验失败：%lld 字节，哈希 %016llx（清单记录 %lld "
+               "字节，哈希 %016llx）\n",
+               part_written, hash, part_files[i].size, part_files[i].hash);
+        success = 0;
+      }
+    }
     if (success) {
       printf("  ✅ 成功合并分块 %d\n", part_files[i].part_number);
     }
@@ -301,6 +433,15 @@ int merge_part_files(const wchar_t *split_dir, const wchar_t *output_file) {
   free(buffer);
   CloseHandle(hOutput);
   free(part_files);
+  if (success && has_manifest && total_written != manifest.source_size) {
+    printf("  ❌ 合并大小 %lld 字节与清单记录 %lld 字节不符\n", total_written,
+           manifest.source_size);
+    success = 0;
+  }
+  if (success && has_manifest) {
+    printf("  🔐 分块哈希校验通过，文件哈希 %016llx\n", manifest.file_hash);
+  }
+  split_manifest_free(&manifest);
   if (success) {
     printf("  ✅ 合并完成\n");
     printf("  📊 总写入字节数：%lld\n", total_written);
@@ -347,61 +488,319 @@ int get_current_directory(wchar_t *buffer, size_t buffer_size) {
   return (len > 0 && len < buffer_size);
 }
 
-int find_split_directories_recursive(const wchar_t *search_dir,
-                                     wchar_t ***dir_list, int *dir_count,
-                                     int *capacity) {
-  wchar_t search_pattern[MAX_PATH_LENGTH];
-  if (!safe_path_join(search_pattern, MAX_PATH_LENGTH, search_dir, L"*")) {
+int get_scan_thread_count(void) {
+  int thread_count = g_scan_threads;
+  if (thread_count <= 0) {
+    SYSTEM_INFO system_info;
+    GetSystemInfo(&system_info);
+    thread_count = (int)system_info.dwNumberOfProcessors;
+  }
+  if (thread_count < 1) {
+    thread_count = 1;
+  }
+  if (thread_count > MAX_SCAN_THREADS) {
+    thread_count = MAX_SCAN_THREADS;
+  }
+  return thread_count;
+}
+
+int build_node_path(const DirNode *node, wchar_t *buffer, size_t buffer_size) {
+  size_t length = 0;
+  for (const DirNode *n = node; n; n = n->parent) {
+    length += n->name_length + (n->parent ? 1 : 0);
+  }
+  if (length + 1 > buffer_size) {
+    return 0;
+  }
+  size_t pos = length;
+  buffer[pos] = L'\0';
+  for (const DirNode *n = node; n; n = n->parent) {
+    pos -= n->name_length;
+    memcpy(buffer + pos, n->name, sizeof(wchar_t) * n->name_length);
+    if (n->parent) {
+      buffer[--pos] = L'\\';
+    }
+  }
+  return 1;
+}
+
+void walk_push_task(ParallelWalker *walker, WalkWorker *worker,
+                    const DirNode *parent, const wchar_t *name) {
+  int name_length = (int)wcslen(name);
+  DirNode *node = (DirNode *)arena_alloc(&worker->arena, sizeof(DirNode));
+  wchar_t *name_copy = (wchar_t *)arena_alloc(
+      &worker->arena, sizeof(wchar_t) * (name_length + 1));
+  memcpy(name_copy, name, sizeof(wchar_t) * (name_length + 1));
+  node->parent = parent;
+  node->name = name_copy;
+  node->name_length = name_length;
+  node->depth = parent ? parent->depth + 1 : 0;
+  InterlockedIncrement(&walker->pending);
+  walk_deque_push(&walker->deques[worker->index], node);
+}
+
+void walk_visit_entry(WalkWorker *worker, const DirNode *task,
+                      const wchar_t *dir_path,
+                      const WIN32_FIND_DATAW *find_data) {
+  ParallelWalker *walker = worker->walker;
+  worker->entries_scanned++;
+  wchar_t full_path[MAX_PATH_LENGTH];
+  if (!safe_path_join(full_path, MAX_PATH_LENGTH, dir_path,
+                      find_data->cFileName)) {
+    return;
+  }
+  int descend =
+      walker->on_entry(walker->context, worker->index, full_path, find_data);
+  if ((find_data->dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) && descend &&
+      task->depth < walker->max_depth) {
+    walk_push_task(walker, worker, task, find_data->cFileName);
+  }
+}
+
+int parse_scan_backend(const char *name, ScanBackend *backend) {
+  if (strcmp(name, "find") == 0) {
+    *backend = SCAN_BACKEND_FIND;
+    return 1;
+  }
+#ifndef _WIN32
+  if (strcmp(name, "getdents") == 0) {
+    *backend = SCAN_BACKEND_GETDENTS;
+    return 1;
+  }
+#endif
+  return 0;
+}
+
+#ifndef _WIN32
+int linux_entry_info(int dir_fd, const char *name, unsigned char type,
+                     WIN32_FIND_DATAW *find_data) {
+  memset(&find_data->ftLastWriteTime, 0, sizeof(FILETIME));
+  find_data->nFileSizeLow = 0;
+  find_data->nFileSizeHigh = 0;
+  if (type == DT_DIR) {
+    find_data->dwFileAttributes = FILE_ATTRIBUTE_DIRECTORY;
+    return 1;
+  }
+  if (type == DT_REG) {
+    find_data->dwFileAttributes = FILE_ATTRIBUTE_NORMAL;
+    return 1;
+  }
+  struct stat st;
+  if (fstatat(dir_fd, name, &st, 0) != 0 &&
+      fstatat(dir_fd, name, &st, AT_SYMLINK_NOFOLLOW) != 0) {
     return 0;
   }
+  find_data->dwFileAttributes = compat_attributes(&st, type == DT_LNK);
+  return 1;
+}
+
+void walk_read_directory_getdents(WalkWorker *worker, const DirNode *task,
+                                  const wchar_t *dir_path) {
+  char *path = compat_path(dir_path);
+  int dir_fd = path ? open(path, O_RDONLY | O_DIRECTORY | O_CLOEXEC) : -1;
+  free(path);
+  if (dir_fd < 0) {
+    return;
+  }
+  worker->directories_scanned++;
+  unsigned long long buffer[GETDENTS_BUFFER_SIZE / sizeof(unsigned long long)];
   WIN32_FIND_DATAW find_data;
-  HANDLE hFind = FindFirstFileW(search_pattern, &find_data);
+  long bytes;
+  while ((bytes = syscall(SYS_getdents64, dir_fd, buffer, sizeof(buffer))) >
+         0) {
+    for (long offset = 0; offset < bytes;) {
+      const LinuxDirent64 *entry =
+          (const LinuxDirent64 *)((const char *)buffer + offset);
+      offset += entry->d_reclen;
+      if (strcmp(entry->d_name, ".") == 0 ||
+          strcmp(entry->d_name, "..") == 0) {
+        continue;
+      }
+      if (!linux_entry_info(dir_fd, entry->d_name, entry->d_type,
+                            &find_data) ||
+          MultiByteToWideChar(CP_UTF8, 0, entry->d_name, -1,
+                              find_data.cFileName, MAX_PATH) <= 0) {
+        continue;
+      }
+      walk_visit_entry(worker, task, dir_path, &find_data);
+    }
+  }
+  close(dir_fd);
+}
+#endif
+
+void walk_process_directory(WalkWorker *worker, const DirNode *task) {
+  wchar_t dir_path[MAX_PATH_LENGTH];
+  if (!build_node_path(task, dir_path, MAX_PATH_LENGTH)) {
+    return;
+  }
+#ifndef _WIN32
+  if (g_scan_backend == SCAN_BACKEND_GETDENTS) {
+    walk_read_directory_getdents(worker, task, dir_path);
+    return;
+  }
+#endif
+  wchar_t search_path[MAX_PATH_LENGTH];
+  if (!safe_path_join(search_path, MAX_PATH_LENGTH, dir_path, L"*")) {
+    return;
+  }
+  WIN32_FIND_DATAW find_data;
+  HANDLE hFind =
+      FindFirstFileExW(search_path, FindExInfoBasic, &find_data,
+                       FindExSearchNameMatch, NULL, FIND_FIRST_EX_LARGE_FETCH);
   if (hFind == INVALID_HANDLE_VALUE) {
-    return 0;
+    return;
   }
+  worker->directories_scanned++;
   do {
     if (wcscmp(find_data.cFileName, L".") == 0 ||
         wcscmp(find_data.cFileName, L"..") == 0) {
       continue;
     }
-    if (find_data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) {
-      wchar_t full_path[MAX_PATH_LENGTH];
-      safe_path_join(full_path, MAX_PATH_LENGTH, search_dir,
-                     find_data.cFileName);
-      wchar_t *split_pos = wcsstr(find_data.cFileName, L"-split");
-      if (split_pos && wcslen(split_pos) == 6) {
-        if (*dir_count >= *capacity) {
-          *capacity *= 2;
-          *dir_list =
-              (wchar_t **)realloc(*dir_list, sizeof(wchar_t *) * (*capacity));
-          if (!*dir_list) {
-            FindClose(hFind);
-            return 0;
-          }
-        }
-        (*dir_list)[*dir_count] = _wcsdup(full_path);
-        if (!(*dir_list)[*dir_count]) {
-          FindClose(hFind);
-          return 0;
-        }
-        (*dir_count)++;
-      } else {
-        find_split_directories_recursive(full_path, dir_list, dir_count,
-                                         capacity);
-      }
-    }
+    walk_visit_entry(worker, task, dir_path, &find_data);
   } while (FindNextFileW(hFind, &find_data));
   FindClose(hFind);
-  return 1;
+}
+
+DWORD WINAPI walk_worker_main(LPVOID param) {
+  WalkWorker *worker = (WalkWorker *)param;
+  ParallelWalker *walker = worker->walker;
+  int idle_rounds = 0;
+  DirNode *task;
+  for (;;) {
+    int found = walk_deque_pop(&walker->deques[worker->index], &task);
+    for (int i = 1; !found && i < walker->thread_count; i++) {
+      int victim = (worker->index + i) % walker->thread_count;
+      found = walk_deque_steal(&walker->deques[victim], &task);
+    }
+    if (found) {
+      idle_rounds = 0;
+      walk_process_directory(worker, task);
+      InterlockedDecrement(&walker->pending);
+      continue;
+    }
+    if (InterlockedCompareExchange(&walker->pending, 0, 0) == 0) {
+      break;
+    }
+    if (++idle_rounds < 64) {
+      SwitchToThread();
+    } else {
+      Sleep(1);
+    }
+  }
+  return 0;
+}
+
+void parallel_walk(ParallelWalker *walker, const wchar_t *root) {
+  int thread_count = walker->thread_count;
+  walker->deques = (WalkDeque *)safe_malloc(sizeof(WalkDeque) * thread_count);
+  WalkWorker *workers =
+      (WalkWorker *)safe_malloc(sizeof(WalkWorker) * thread_count);
+  for (int i = 0; i < thread_count; i++) {
+    walker->deques[i].tasks = NULL;
+    walker->deques[i].head = 0;
+    walker->deques[i].tail = 0;
+    walker->deques[i].capacity = 0;
+    InitializeCriticalSection(&walker->deques[i].lock);
+    workers[i].walker = walker;
+    workers[i].index = i;
+    arena_init(&workers[i].arena, 64 * 1024);
+    workers[i].directories_scanned = 0;
+    workers[i].entries_scanned = 0;
+  }
+  walker->pending = 0;
+  walk_push_task(walker, &workers[0], NULL, root);
+  HANDLE *threads = (HANDLE *)safe_malloc(sizeof(HANDLE) * thread_count);
+  for (int i = 1; i < thread_count; i++) {
+    threads[i] = CreateThread(NULL, 0, walk_worker_main, &workers[i], 0, NULL);
+  }
+  walk_worker_main(&workers[0]);
+  for (int i = 1; i < thread_count; i++) {
+    if (threads[i]) {
+      WaitForSingleObject(threads[i], INFINITE);
+      CloseHandle(threads[i]);
+    }
+  }
+  walker->directories_scanned = 0;
+  walker->entries_scanned = 0;
+  walker->node_bytes = 0;
+  for (int i = 0; i < thread_count; i++) {
+    walker->node_bytes += workers[i].arena.bytes_used;
+    arena_free_all(&workers[i].arena);
+    walker->directories_scanned += workers[i].directories_scanned;
+    walker->entries_scanned += workers[i].entries_scanned;
+    free(walker->deques[i].tasks);
+    DeleteCriticalSection(&walker->deques[i].lock);
+  }
+  free(threads);
+  free(workers);
+  free(walker->deques);
+  walker->deques = NULL;
+}
+
+int compare_wide_paths(const void *a, const void *b) {
+  const wchar_t *path1 = *(const wchar_t *const *)a;
+  const wchar_t *path2 = *(const wchar_t *const *)b;
+  return wcscmp(path1, path2);
+}
+
+int split_dir_visit_entry(void *context, int worker_index,
+                          const wchar_t *full_path,
+                          const WIN32_FIND_DATAW *find_data) {
+  if (!(find_data->dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)) {
+    return 0;
+  }
+  const wchar_t *split_pos = wcsstr(find_data->cFileName, L"-split");
+  if (!split_pos || wcslen(split_pos) != 6) {
+    return 1;
+  }
+  SplitDirBucket *bucket = &((SplitDirBucket *)context)[worker_index];
+  if (bucket->count >= bucket->capacity) {
+    int new_capacity = bucket->capacity == 0 ? 16 : bucket->capacity * 2;
+    bucket->dirs = (wchar_t **)safe_realloc(bucket->dirs,
+                                            sizeof(wchar_t *) * new_capacity);
+    bucket->capacity = new_capacity;
+  }
+  bucket->dirs[bucket->count] = _wcsdup(full_path);
+  if (bucket->dirs[bucket->count]) {
+    bucket->count++;
+  }
+  return 0;
 }
 
 int find_all_split_directories(const wchar_t *search_dir, wchar_t ***dir_list,
                                int *dir_count) {
-  int capacity = 50;
-  *dir_list = (wchar_t **)safe_malloc(sizeof(wchar_t *) * capacity);
+  DWORD attr = GetFileAttributesW(search_dir);
+  if (attr == INVALID_FILE_ATTRIBUTES || !(attr & FILE_ATTRIBUTE_DIRECTORY)) {
+    return 0;
+  }
+  int thread_count = get_scan_thread_count();
+  SplitDirBucket *buckets =
+      (SplitDirBucket *)safe_malloc(sizeof(SplitDirBucket) * thread_count);
+  memset(buckets, 0, sizeof(SplitDirBucket) * thread_count);
+  ParallelWalker walker = {0};
+  walker.thread_count = thread_count;
+  walker.max_depth = MAX_SCAN_DEPTH;
+  walker.on_entry = split_dir_visit_entry;
+  walker.context = buckets;
+  parallel_walk(&walker, search_dir);
+  int total = 0;
+  for (int i = 0; i < thread_count; i++) {
+    total += buckets[i].count;
+  }
+  *dir_list = (wchar_t **)safe_malloc(sizeof(wchar_t *) * (total + 1));
   *dir_count = 0;
-  return find_split_directories_recursive(search_dir, dir_list, dir_count,
-                                          &capacity);
+  for (int i = 0; i < thread_count; i++) {
+    for (int j = 0; j < buckets[i].count; j++) {
+      (*dir_list)[(*dir_count)++] = buckets[i].dirs[j];
+    }
+    free(buckets[i].dirs);
+  }
+  free(buckets);
+  qsort(*dir_list, *dir_count, sizeof(wchar_t *), compare_wide_paths);
+  printf("🔍 扫描了 %lld 个目录（%d 线程）\n\n", walker.directories_scanned,
+         thread_count);
+  return 1;
 }
 
 void print_usage(const char *program_name) {
@@ -416,6 +815,9 @@ void print_usage(const char *program_name) {
          program_name);
   printf("    - 合并多个指定的分割目录\n\n");
   printf("输出文件将在相同位置创建，并带有 '-merged' 后缀\n");
+  printf("\n选项：\n");
+  printf("  --scan-threads=N    搜索 '-split' 目录时使用的线程数（默认：CPU 核数）\n");
+  printf("  --scan-backend=NAME 目录枚举方式：find 或 getdents（仅 Linux，默认）\n");
 }
 
 int process_single_directory(const wchar_t *split_dir) {
@@ -455,7 +857,19 @@ int main(int argc, char *argv[]) {
   printf("========================================\n\n");
   int total_processed = 0;
   int successful_merges = 0;
-  if (argc == 1) {
+  int positional_count = 0;
+  for (int i = 1; i < argc; i++) {
+    if (strncmp(argv[i], "--scan-threads=", 15) == 0) {
+      g_scan_threads = atoi(argv[i] + 15);
+    } else if (strncmp(argv[i], "--scan-backend=", 15) == 0) {
+      if (!parse_scan_backend(argv[i] + 15, &g_scan_backend)) {
+        printf("⚠️  不可用的扫描后端：%s\n", argv[i] + 15);
+      }
+    } else {
+      positional_count++;
+    }
+  }
+  if (positional_count == 0) {
     printf("🔄 未提供参数，正在递归搜索所有 '-split' 目录...\n\n");
     wchar_t current_dir[MAX_PATH_LENGTH];
     if (!get_current_directory(current_dir, MAX_PATH_LENGTH)) {
@@ -497,6 +911,10 @@ int main(int argc, char *argv[]) {
     free(split_dirs);
   } else {
     for (int i = 1; i < argc; i++) {
+      if (strncmp(argv[i], "--scan-threads=", 15) == 0 ||
+          strncmp(argv[i], "--scan-backend=", 15) == 0) {
+        continue;
+      }
       char *utf8_path = ansi_to_utf8(argv[i]);
       if (!utf8_path) {
         printf("❌ 转换参数编码失败：%s\n", argv[i]);
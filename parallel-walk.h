@@ -0,0 +1,113 @@
+#ifndef PARALLEL_WALK_H
+#define PARALLEL_WALK_H
+
+void *safe_malloc(size_t size);
+void *safe_realloc(void *ptr, size_t size);
+
+typedef struct DirNode DirNode;
+
+typedef struct ArenaChunk {
+  struct ArenaChunk *next;
+  size_t used;
+  size_t capacity;
+  unsigned char data[];
+} ArenaChunk;
+
+typedef struct {
+  ArenaChunk *head;
+  size_t chunk_size;
+  size_t bytes_used;
+} Arena;
+
+typedef struct {
+  DirNode **tasks;
+  int head;
+  int tail;
+  int capacity;
+  CRITICAL_SECTION lock;
+} WalkDeque;
+
+static inline void arena_init(Arena *arena, size_t chunk_size) {
+  arena->head = NULL;
+  arena->chunk_size = chunk_size;
+  arena->bytes_used = 0;
+}
+
+static inline void *arena_alloc(Arena *arena, size_t size) {
+  size = (size + 7) & ~(size_t)7;
+  ArenaChunk *chunk = arena->head;
+  if (!chunk || chunk->used + size > chunk->capacity) {
+    size_t capacity = size > arena->chunk_size ? size : arena->chunk_size;
+    chunk = (ArenaChunk *)safe_malloc(sizeof(ArenaChunk) + capacity);
+    chunk->next = arena->head;
+    chunk->used = 0;
+    chunk->capacity = capacity;
+    arena->head = chunk;
+  }
+  void *ptr = chunk->data + chunk->used;
+  chunk->used += size;
+  arena->bytes_used += size;
+  return ptr;
+}
+
+static inline void arena_free_all(Arena *arena) {
+  ArenaChunk *chunk = arena->head;
+  while (chunk) {
+    ArenaChunk *next = chunk->next;
+    free(chunk);
+    chunk = next;
+  }
+  arena->head = NULL;
+  arena->bytes_used = 0;
+}
+
+static inline void walk_deque_push(WalkDeque *deque, DirNode *task) {
+  EnterCriticalSection(&deque->lock);
+  if (deque->tail >= deque->capacity) {
+    int live = deque->tail - deque->head;
+    if (deque->head > 0) {
+      memmove(deque->tasks, deque->tasks + deque->head,
+              sizeof(DirNode *) * live);
+      deque->head = 0;
+      deque->tail = live;
+    }
+    if (deque->tail >= deque->capacity) {
+      int new_capacity = deque->capacity == 0 ? 64 : deque->capacity * 2;
+      deque->tasks = (DirNode **)safe_realloc(deque->tasks,
+                                              sizeof(DirNode *) * new_capacity);
+      deque->capacity = new_capacity;
+    }
+  }
+  deque->tasks[deque->tail++] = task;
+  LeaveCriticalSection(&deque->lock);
+}
+
+static inline int walk_deque_pop(WalkDeque *deque, DirNode **task) {
+  int found = 0;
+  EnterCriticalSection(&deque->lock);
+  if (deque->tail > deque->head) {
+    *task = deque->tasks[--deque->tail];
+    found = 1;
+  }
+  if (deque->tail == deque->head) {
+    deque->head = deque->tail = 0;
+  }
+  LeaveCriticalSection(&deque->lock);
+  return found;
+}
+
+static inline int walk_deque_steal(WalkDeque *deque, DirNode **task) {
+  int found = 0;
+  EnterCriticalSection(&deque->lock);
+  if (deque->tail > deque->head) {
+    *task = deque->tasks[deque->head++];
+    found = 1;
+  }
+  if (deque->tail == deque->head) {
+    deque->head = deque->tail = 0;
+  }
+  LeaveCriticalSection(&deque->lock);
+  return found;
+}
+
+#endif
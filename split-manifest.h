@@ -0,0 +1,236 @@
+#ifndef SPLIT_MANIFEST_H
+#define SPLIT_MANIFEST_H
+
+#define SPLIT_MANIFEST_NAME "split-manifest.txt"
+#define SPLIT_MANIFEST_VERSION 1
+#define SPLIT_MANIFEST_LINE_SIZE (4096 + 128)
+#define SPLIT_MAX_PARTS 9999
+#define XXH_PRIME64_1 0x9E3779B185EBCA87ULL
+#define XXH_PRIME64_2 0xC2B2AE3D27D4EB4FULL
+#define XXH_PRIME64_3 0x165667B19E3779F9ULL
+#define XXH_PRIME64_4 0x85EBCA77C2B2AE63ULL
+#define XXH_PRIME64_5 0x27D4EB2F165667C5ULL
+
+typedef struct {
+  unsigned long long total;
+  unsigned long long v[4];
+  BYTE pending[32];
+  int pending_size;
+} Xxh64State;
+
+typedef struct {
+  char *name;
+  long long size;
+  unsigned long long hash;
+} ManifestPart;
+
+typedef struct {
+  long long source_size;
+  unsigned long long source_mtime;
+  unsigned long long file_hash;
+  int part_count;
+  ManifestPart *parts;
+  long long manifest_size;
+} SplitManifest;
+
+static inline unsigned long long xxh64_rotl(unsigned long long value,
+                                            int bits) {
+  return (value << bits) | (value >> (64 - bits));
+}
+
+static inline unsigned long long xxh64_read64(const BYTE *p) {
+  return (unsigned long long)p[0] | ((unsigned long long)p[1] << 8) |
+         ((unsigned long long)p[2] << 16) | ((unsigned long long)p[3] << 24) |
+         ((unsigned long long)p[4] << 32) | ((unsigned long long)p[5] << 40) |
+         ((unsigned long long)p[6] << 48) | ((unsigned long long)p[7] << 56);
+}
+
+static inline unsigned long long xxh64_round(unsigned long long acc,
+                                             unsigned long long input) {
+  acc += input * XXH_PRIME64_2;
+  acc = xxh64_rotl(acc, 31);
+  return acc * XXH_PRIME64_1;
+}
+
+static inline unsigned long long xxh64_merge(unsigned long long acc,
+                                             unsigned long long value) {
+  acc ^= xxh64_round(0, value);
+  return acc * XXH_PRIME64_1 + XXH_PRIME64_4;
+}
+
+static inline void xxh64_init(Xxh64State *state) {
+  memset(state, 0, sizeof(Xxh64State));
+  state->v[0] = XXH_PRIME64_1 + XXH_PRIME64_2;
+  state->v[1] = XXH_PRIME64_2;
+  state->v[2] = 0;
+  state->v[3] = 0 - XXH_PRIME64_1;
+}
+
+static inline void xxh64_update(Xxh64State *state, const BYTE *data,
+                                size_t length) {
+  state->total += length;
+  if (state->pending_size + length < 32) {
+    memcpy(state->pending + state->pending_size, data, length);
+    state->pending_size += (int)length;
+    return;
+  }
+  if (state->pending_size > 0) {
+    size_t fill = 32 - state->pending_size;
+    memcpy(state->pending + state->pending_size, data, fill);
+    for (int i = 0; i < 4; i++) {
+      state->v[i] =
+          xxh64_round(state->v[i], xxh64_read64(state->pending + i * 8));
+    }
+    data += fill;
+    length -= fill;
+    state->pending_size = 0;
+  }
+  unsigned long long v0 = state->v[0], v1 = state->v[1];
+  unsigned long long v2 = state->v[2], v3 = state->v[3];
+  while (length >= 32) {
+    v0 = xxh64_round(v0, xxh64_read64(data));
+    v1 = xxh64_round(v1, xxh64_read64(data + 8));
+    v2 = xxh64_round(v2, xxh64_read64(data + 16));
+    v3 = xxh64_round(v3, xxh64_read64(data + 24));
+    data += 32;
+    length -= 32;
+  }
+  state->v[0] = v0;
+  state->v[1] = v1;
+  state->v[2] = v2;
+  state->v[3] = v3;
+  if (length > 0) {
+    memcpy(state->pending, data, length);
+    state->pending_size = (int)length;
+  }
+}
+
+static inline unsigned long long xxh64_digest(const Xxh64State *state) {
+  unsigned long long hash;
+  if (state->total >= 32) {
+    hash = xxh64_rotl(state->v[0], 1) + xxh64_rotl(state->v[1], 7) +
+           xxh64_rotl(state->v[2], 12) + xxh64_rotl(state->v[3], 18);
+    for (int i = 0; i < 4; i++) {
+      hash = xxh64_merge(hash, state->v[i]);
+    }
+  } else {
+    hash = state->v[2] + XXH_PRIME64_5;
+  }
+  hash += state->total;
+  const BYTE *p = state->pending;
+  int length = state->pending_size;
+  while (length >= 8) {
+    hash ^= xxh64_round(0, xxh64_read64(p));
+    hash = xxh64_rotl(hash, 27) * XXH_PRIME64_1 + XXH_PRIME64_4;
+    p += 8;
+    length -= 8;
+  }
+  if (length >= 4) {
+    unsigned long long word = (unsigned long long)p[0] |
+                              ((unsigned long long)p[1] << 8) |
+                              ((unsigned long long)p[2] << 16) |
+                              ((unsigned long long)p[3] << 24);
+    hash ^= word * XXH_PRIME64_1;
+    hash = xxh64_rotl(hash, 23) * XXH_PRIME64_2 + XXH_PRIME64_3;
+    p += 4;
+    length -= 4;
+  }
+  while (length > 0) {
+    hash ^= *p * XXH_PRIME64_5;
+    hash = xxh64_rotl(hash, 11) * XXH_PRIME64_1;
+    p++;
+    length--;
+  }
+  hash ^= hash >> 33;
+  hash *= XXH_PRIME64_2;
+  hash ^= hash >> 29;
+  hash *= XXH_PRIME64_3;
+  hash ^= hash >> 32;
+  return hash;
+}
+
+static inline unsigned long long
+split_manifest_file_hash(const SplitManifest *manifest) {
+  Xxh64State state;
+  xxh64_init(&state);
+  for (int i = 0; i < manifest->part_count; i++) {
+    BYTE digest[8];
+    for (int b = 0; b < 8; b++) {
+      digest[b] = (BYTE)(manifest->parts[i].hash >> (b * 8));
+    }
+    xxh64_update(&state, digest, sizeof(digest));
+  }
+  return xxh64_digest(&state);
+}
+
+static inline void split_manifest_free(SplitManifest *manifest) {
+  if (manifest->parts) {
+    for (int i = 0; i < manifest->part_count; i++) {
+      free(manifest->parts[i].name);
+    }
+    free(manifest->parts);
+  }
+  memset(manifest, 0, sizeof(SplitManifest));
+}
+
+static inline int split_manifest_parse(FILE *file, SplitManifest *manifest) {
+  memset(manifest, 0, sizeof(SplitManifest));
+  char line[SPLIT_MANIFEST_LINE_SIZE];
+  int version = 0;
+  int ok = fgets(line, sizeof(line), file) &&
+           sscanf(line, "split-manifest %d", &version) == 1 &&
+           version == SPLIT_MANIFEST_VERSION &&
+           fgets(line, sizeof(line), file) &&
+           sscanf(line, "source_size %lld", &manifest->source_size) == 1 &&
+           fgets(line, sizeof(line), file) &&
+           sscanf(line, "source_mtime %llu", &manifest->source_mtime) == 1 &&
+           fgets(line, sizeof(line), file) &&
+           sscanf(line, "file_hash %llx", &manifest->file_hash) == 1 &&
+           fgets(line, sizeof(line), file) &&
+           sscanf(line, "part_count %d", &manifest->part_count) == 1 &&
+           manifest->part_count > 0 &&
+           manifest->part_count <= SPLIT_MAX_PARTS;
+  if (ok) {
+    manifest->parts = (ManifestPart *)calloc(manifest->part_count,
+                                             sizeof(ManifestPart));
+    ok = manifest->parts != NULL;
+  }
+  long long total_size = 0;
+  for (int i = 0; ok && i < manifest->part_count; i++) {
+    ManifestPart *part = &manifest->parts[i];
+    int name_start = 0;
+    if (!fgets(line, sizeof(line), file) ||
+        sscanf(line, "part %lld %llx %n", &part->size, &part->hash,
+               &name_start) < 2 ||
+        name_start == 0 || part->size < 0) {
+      ok = 0;
+      break;
+    }
+    char *name = line + name_start;
+    name[strcspn(name, "\r\n")] = '\0';
+    if (name[0] == '\0' || strchr(name, '\\') || strchr(name, '/')) {
+      ok = 0;
+      break;
+    }
+    size_t name_length = strlen(name);
+    part->name = (char *)malloc(name_length + 1);
+    if (!part->name) {
+      ok = 0;
+      break;
+    }
+    memcpy(part->name, name, name_length + 1);
+    total_size += part->size;
+  }
+  if (ok) {
+    manifest->manifest_size = ftell(file);
+    ok = total_size == manifest->source_size &&
+         split_manifest_file_hash(manifest) == manifest->file_hash;
+  }
+  fclose(file);
+  if (!ok) {
+    split_manifest_free(manifest);
+  }
+  return ok;
+}
+
+#endif
@@ -1,29 +1,218 @@
+#ifndef _WIN32
+#define _GNU_SOURCE
+#endif
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
-#include <windows.h>
+#include "compat.h"
+#include "split-manifest.h"
+#include "parallel-walk.h"
 
 #define MAX_PATH_LENGTH 4096
 #define MAX_GROUP_SIZE (100 * 1024 * 1024LL)
 #define MAX_FILE_SIZE (50 * 1024 * 1024LL)
-#define MAX_ITEMS 100000
-#define MAX_DIRECTORY_QUEUE 10000
+#define MAX_SCAN_DEPTH 100
+#define MAX_SCAN_THREADS 64
+#define MAX_EXACT_PACK_ITEMS 40
+#define MAX_EXACT_PACK_NODES 2000000LL
+#define MAX_DIFFERENCING_ROUNDS 8
+#define MAX_DIFFERENCING_CELLS (2 * 1024 * 1024LL)
+#define ESTIMATE_CACHE_FILE ".git\\split-push-estimate-cache"
+#define ESTIMATE_BLOCK_SIZE (16 * 1024)
+#define ESTIMATE_SAMPLE_BLOCKS 4
+#define ESTIMATE_BLOCK_OVERHEAD 64
+#define ESTIMATE_MIN_FILE_SIZE 4096
+#define DEFAULT_PACK_MARGIN 10
+#define DEDUP_MIN_FILE_SIZE 1024
+#define DEDUP_READ_SIZE (256 * 1024)
+#define SCAN_CACHE_FILE L".git\\split-push-scan-cache"
+#define SCAN_CACHE_MAGIC "SPSCAN02"
+#define SCAN_CACHE_MAX_AGE 48
+#define INDEX_STAT_BLOCK 256
+#define INDEX_FLAG_ASSUME_VALID 0x8000
+#define INDEX_FLAG_STAGE_MASK 0x3000
+#define INDEX_FLAG_SKIP_WORKTREE 0x40000000
+#define UNIX_EPOCH_FILETIME 116444736000000000ULL
+#ifdef _WIN32
+#define DEFAULT_SCAN_BACKEND SCAN_BACKEND_FIND
+#else
+#define DEFAULT_SCAN_BACKEND SCAN_BACKEND_GETDENTS
+#endif
+#define STATUS_READ_CHUNK (1024 * 1024)
+#define PATH_SCRATCH_SLOTS 2
+#define SPLIT_PART_SIZE (50 * 1024 * 1024LL)
+#define SPLIT_COPY_BUFFER_SIZE (4 * 1024 * 1024)
+#define SPLIT_COPY_CHUNK 0x40000000LL
+#define CDC_DEFAULT_MIN (16 * 1024 * 1024LL)
+#define CDC_DEFAULT_AVG (32 * 1024 * 1024LL)
+#define CDC_DEFAULT_MAX (48 * 1024 * 1024LL)
+#define CDC_MIN_CHUNK (64 * 1024LL)
+#define CDC_GEAR_SEED 0x5350434443474541ULL
+#ifdef _MSC_VER
+#define THREAD_LOCAL __declspec(thread)
+#else
+#define THREAD_LOCAL __thread
+#endif
 
 typedef enum { TYPE_FILE, TYPE_DIRECTORY } ItemType;
 
+typedef enum {
+  PACK_BEST_FIT_DECREASING,
+  PACK_FIRST_FIT_DECREASING,
+  PACK_DIFFERENCING,
+  PACK_BRANCH_AND_BOUND,
+  PACK_AUTO
+} PackStrategy;
+
+typedef enum {
+  SCAN_BACKEND_FIND,
+  SCAN_BACKEND_GETDENTS,
+  SCAN_BACKEND_URING
+} ScanBackend;
+
+typedef enum {
+  COPY_METHOD_CLONE,
+  COPY_METHOD_COPY_RANGE,
+  COPY_METHOD_SENDFILE,
+  COPY_METHOD_BUFFER,
+  COPY_METHOD_COUNT
+} CopyMethod;
+
+typedef enum { SPLIT_MODE_FIXED, SPLIT_MODE_CDC } SplitMode;
+
+typedef struct {
+  long long min_size;
+  long long avg_size;
+  long long max_size;
+  unsigned long long mask_small;
+  unsigned long long mask_large;
+} CdcParams;
+
+typedef struct {
+  int disabled[COPY_METHOD_COUNT];
+  long long bytes[COPY_METHOD_COUNT];
+  BYTE *buffer;
+} CopyEngine;
+
 typedef struct {
   char path[MAX_PATH_LENGTH];
+  long long offset;
+  long long size;
+  unsigned long long hash;
+  double seconds;
+  int ok;
+  int hashed;
+  int reused;
+} SplitPart;
+
+typedef struct {
+  long long size;
+  unsigned long long hash;
+  int index;
+  int claimed;
+} SplitReuse;
+
+typedef struct {
+  const char *source_path;
+  SplitPart *parts;
+  int part_count;
+  int incremental;
+  const SplitManifest *previous;
+  volatile LONG next;
+} SplitJob;
+
+typedef struct {
+  SplitJob *job;
+  CopyEngine engine;
+} SplitWorker;
+
+#ifndef _WIN32
+typedef struct StatxRing {
+  int fd;
+  unsigned int capacity;
+  unsigned int *sq_tail;
+  unsigned int *sq_mask;
+  unsigned int *sq_array;
+  unsigned int *cq_head;
+  unsigned int *cq_tail;
+  unsigned int *cq_mask;
+  struct io_uring_sqe *sqes;
+  struct io_uring_cqe *cqes;
+  void *sq_map;
+  size_t sq_map_size;
+  void *cq_map;
+  size_t cq_map_size;
+  size_t sqes_size;
+  const char **names;
+  struct statx *results;
+  unsigned char *done;
+} StatxRing;
+#endif
+
+typedef struct {
+  unsigned int path_offset;
+  unsigned int path_length;
   long long size;
+  long long packed_size;
   ItemType type;
 } FileItem;
 
+typedef struct {
+  FileItem *items;
+  int count;
+  int capacity;
+} ItemList;
+
+typedef struct {
+  char *data;
+  size_t length;
+  size_t capacity;
+  unsigned int *index;
+  size_t index_capacity;
+  size_t index_count;
+} PathArena;
+
+typedef struct {
+  long long *remaining;
+  int *left;
+  int *right;
+  unsigned int *priority;
+  int capacity;
+  int root;
+} CapacityIndex;
+
+typedef struct {
+  int payload;
+} PathTrieNode;
+
+typedef struct {
+  unsigned long long hash;
+  int parent;
+  int child;
+  unsigned int name_offset;
+  unsigned int name_length;
+} PathTrieEdge;
+
+typedef struct {
+  PathTrieNode *nodes;
+  int node_count;
+  int node_capacity;
+  PathTrieEdge *edges;
+  size_t edge_count;
+  size_t edge_capacity;
+  char *names;
+  size_t names_length;
+  size_t names_capacity;
+} PathTrie;
+
 typedef struct {
   FileItem *items;
   int count;
   int capacity;
   long long total_size;
+  long long packed_size;
 } FileGroup;
 
 typedef struct {
@@ -31,6 +220,12 @@ typedef struct {
   long long size;
 } SkippedFile;
 
+typedef struct {
+  long long directories_scanned;
+  long long entries_scanned;
+  double elapsed_seconds;
+} ScanStats;
+
 typedef struct {
   FileGroup *groups;
   int group_count;
@@ -42,42 +237,507 @@ typedef struct {
   SkippedFile *skipped_files;
   int skipped_count;
   int skipped_capacity;
+  ScanStats scan_stats;
+  Arena arena;
 } GroupResult;
 
 typedef struct {
-  wchar_t path[MAX_PATH_LENGTH];
+  GroupResult *result;
+  CapacityIndex index;
+  long long group_capacity;
+} GroupPacker;
+
+typedef struct {
+  long long size;
+  int item;
+} PackCandidate;
+
+typedef struct {
+  long long size;
+  unsigned long long hash;
+  int item;
+  int hashed;
+} DedupEntry;
+
+typedef struct {
+  const FileItem *items;
+  DedupEntry *entries;
+  int *todo;
+  int todo_count;
+  volatile LONG next;
+} DedupHashJob;
+
+typedef struct {
+  int canonical;
+  int owner;
+  int item;
+} DedupOwner;
+
+typedef struct {
+  long long sum;
+  int head;
+  int tail;
+} PackSubset;
+
+typedef struct {
+  const long long *sizes;
+  int count;
+  long long capacity;
+  long long total;
+  long long *remaining;
+  long long *suffix;
+  int *current;
+  int *best;
+  int best_count;
+  long long nodes;
+  int exhausted;
+} ExactPackState;
+
+struct DirNode {
+  const struct DirNode *parent;
+  const char *name;
+  int name_length;
   int depth;
-} DirectoryEntry;
+};
+
+typedef struct {
+  unsigned long long file_id;
+  unsigned int volume_serial;
+  unsigned int used;
+} DirectoryKey;
+
+typedef struct {
+  DirectoryKey *slots;
+  size_t capacity;
+  size_t count;
+  CRITICAL_SECTION lock;
+} VisitedSet;
+
+typedef struct {
+  char magic[8];
+  unsigned int dir_count;
+  unsigned int slot_count;
+  unsigned int entry_count;
+  unsigned int name_count;
+  int estimate_pack;
+  int pack_margin;
+} ScanCacheHeader;
+
+typedef struct {
+  unsigned long long mtime;
+  long long size;
+  long long packed_size;
+  unsigned int files;
+  unsigned int large_files;
+  unsigned int path_offset;
+  unsigned int path_length;
+  unsigned int entry_first;
+  unsigned int entry_count;
+  unsigned int age;
+  unsigned int hash;
+} ScanCacheDir;
+
+typedef struct {
+  unsigned int name_offset;
+  unsigned int name_length;
+  unsigned int attributes;
+} ScanCacheEntry;
 
 typedef struct {
-  char **gitignore_files;
-  int gitignore_count;
-  char **split_files;
-  int split_count;
+  ScanCacheDir *dirs;
+  unsigned int dir_count;
+  unsigned int dir_capacity;
+  ScanCacheEntry *entries;
+  unsigned int entry_count;
+  unsigned int entry_capacity;
+  char *names;
+  unsigned int name_count;
+  unsigned int name_capacity;
+} ScanCacheBuilder;
+
+typedef struct {
+  int enabled;
+  HANDLE file;
+  HANDLE mapping;
+  const unsigned char *view;
+  const ScanCacheHeader *header;
+  const ScanCacheDir *dirs;
+  const unsigned int *slots;
+  const ScanCacheEntry *entries;
+  const char *names;
+  ScanCacheBuilder fresh;
+} ScanCache;
+
+typedef struct {
+  const ScanCache *cache;
+  DirectoryKey *keys;
+  int key_count;
+  int key_capacity;
+  char path[MAX_PATH_LENGTH];
+} ScanCacheCheck;
+
+typedef int (*WalkEntryCallback)(void *context, int worker_index,
+                                 const char *full_path, size_t path_length,
+                                 const WIN32_FIND_DATAW *find_data);
+typedef void (*WalkSubtreeCallback)(void *context, int worker_index,
+                                    const char *path, size_t path_length,
+                                    const ScanCacheDir *dir);
+
+typedef struct {
+  WalkDeque *deques;
+  int thread_count;
+  int max_depth;
+  volatile LONG pending;
+  WalkEntryCallback on_entry;
+  WalkSubtreeCallback on_subtree;
+  void *context;
+  VisitedSet *visited;
+  ScanCache *cache;
+  long long directories_scanned;
+  long long directories_cached;
+  long long subtrees_cached;
+  long long entries_scanned;
+  long long cycles_skipped;
+  size_t node_bytes;
+} ParallelWalker;
+
+typedef struct {
+  ParallelWalker *walker;
+  int index;
+  Arena arena;
+  ScanCacheBuilder cache_builder;
+  int recording;
+  long long directories_scanned;
+  long long directories_cached;
+  long long subtrees_cached;
+  long long entries_scanned;
+  long long cycles_skipped;
+#ifndef _WIN32
+  StatxRing *statx_ring;
+  int statx_ring_failed;
+#endif
+} WalkWorker;
+
+typedef struct {
+  char *path;
+  long long size;
+  long long packed_size;
+  int subtree_files;
+} ScanRecord;
+
+typedef struct {
+  ScanRecord *records;
+  int count;
+  int capacity;
+  long long total_size;
+  Arena arena;
+} ScanBucket;
+
+typedef struct {
+  ScanRecord *records;
+  long long *size_prefix;
+  long long *packed_prefix;
+  int *large_prefix;
+  ItemList *items;
+  GroupResult *result;
+  long long *skipped_files_size;
+  int prune;
+  int directories_emitted;
+  int files_emitted;
+  int files_pruned;
+} ScanEmitter;
+
+typedef struct {
+  char *path;
+  long long size;
+  unsigned long long mtime;
+  int ratio_permille;
+} EstimateCacheEntry;
+
+typedef struct {
+  EstimateCacheEntry *entries;
+  int capacity;
+  int count;
+  int dirty;
+  int initialized;
+  CRITICAL_SECTION lock;
+} EstimateCache;
+
+typedef enum {
+  GIT_CHANGE_NONE,
+  GIT_CHANGE_MODIFIED,
+  GIT_CHANGE_DELETED,
+  GIT_CHANGE_UNTRACKED,
+  GIT_CHANGE_UNTRACKED_DIR
+} GitChangeKind;
+
+typedef struct {
+  const char *path;
+  unsigned int path_length;
+  unsigned int mtime_sec;
+  unsigned int mtime_nsec;
+  unsigned int mode;
+  unsigned int size;
+  unsigned int flags;
+} GitIndexEntry;
+
+typedef struct {
+  GitIndexEntry *entries;
+  int entry_count;
+  unsigned int version;
+  unsigned int mtime_sec;
+  Arena paths;
+} GitIndex;
+
+typedef struct {
+  char *pattern;
+  const char *base;
+  size_t base_length;
+  int negate;
+  int dir_only;
+  int anchored;
+} IgnorePattern;
+
+typedef struct {
+  IgnorePattern *patterns;
+  int count;
+  int capacity;
+  Arena strings;
+} IgnoreList;
+
+typedef struct {
+  char *path;
+  long long size;
+  unsigned long long mtime;
+  GitChangeKind kind;
+} GitChange;
+
+typedef struct {
+  GitChange *changes;
+  int count;
+  int capacity;
+} GitChangeList;
+
+typedef struct {
+  const GitIndex *index;
+  unsigned char *status;
+  long long *sizes;
+  unsigned long long *mtimes;
+  volatile LONG next;
+} IndexStatJob;
+
+typedef struct {
+  const GitIndex *index;
+  GitChangeList *changes;
+  IgnoreList ignores;
+} UntrackedWalk;
+
+typedef struct {
+  char *path;
+  long long size;
+  unsigned long long mtime;
+} PathStatHint;
+
+typedef struct {
+  PathStatHint *slots;
+  int capacity;
+  int count;
+} PathStatHints;
+
+typedef struct {
+  int scan_threads;
+  const char *bench_scan_path;
+  const char *bench_convert_path;
+  PackStrategy pack_strategy;
+  int estimate_pack;
+  int pack_margin;
+  int verify_pack;
+  int dedup;
+  int scan_cache;
+  int native_index;
+  ScanBackend scan_backend;
+  CopyMethod split_copy;
+  int split_jobs;
+  SplitMode split_mode;
+  CdcParams cdc;
+  int verify_split;
+  int split_incremental;
+} RunOptions;
+
+RunOptions g_run_options = {.pack_margin = DEFAULT_PACK_MARGIN,
+                             .scan_backend = DEFAULT_SCAN_BACKEND,
+                             .cdc = {CDC_DEFAULT_MIN, CDC_DEFAULT_AVG,
+                                     CDC_DEFAULT_MAX, 0, 0}};
+unsigned long long g_gear[256];
+unsigned long long g_gear_shifted[256];
+PathArena g_path_arena = {0};
+EstimateCache g_estimate_cache = {0};
+ScanCache g_scan_cache = {0};
+PathStatHints g_path_stat_hints = {0};
+Arena g_status_arena = {NULL, 256 * 1024, 0};
+THREAD_LOCAL wchar_t g_wide_scratch[PATH_SCRATCH_SLOTS][MAX_PATH_LENGTH];
+
+typedef struct {
+  ItemList gitignore_items;
+  ItemList split_items;
 } AdditionalFiles;
 
 void *safe_malloc(size_t size);
 void *safe_realloc(void *ptr, size_t size);
 wchar_t *char_to_wchar(const char *str);
 char *wchar_to_char(const wchar_t *wstr);
+const wchar_t *path_to_wide(const char *path, int slot);
+int path_from_wide(char *buffer, int buffer_size, const wchar_t *wpath);
 int safe_path_join(wchar_t *dest, size_t dest_size, const wchar_t *path1,
                    const wchar_t *path2);
 void normalize_path(char *path);
 void format_size(long long size, char *buffer, size_t buffer_size);
 void draw_progress_bar(int current, int total, const char *prefix);
-long long calculate_directory_size_iterative(const wchar_t *wpath,
-                                             long long *total_scanned_size);
+unsigned int path_arena_intern(const char *path);
+const char *item_path(const FileItem *item);
+void init_file_item(FileItem *item, const char *path, long long size,
+                    ItemType type);
+void item_list_reserve(ItemList *list, int needed);
+FileItem *item_list_add(ItemList *list, const char *path, long long size,
+                        ItemType type);
+void path_arena_free(void);
+double get_time_seconds(void);
+void estimate_cache_load(void);
+void estimate_cache_save(void);
+long long estimate_packed_size(const char *path, long long size,
+                               const FILETIME *mtime);
+long long measure_head_pack_size(void);
+void add_skipped_file(GroupResult *result, const char *path, long long size);
+int get_scan_thread_count(void);
+void visited_set_init(VisitedSet *set, size_t initial_capacity);
+int visited_set_insert(VisitedSet *set, const DirectoryKey *key);
+void visited_set_free(VisitedSet *set);
+int get_directory_key(const char *path, DirectoryKey *key,
+                      unsigned long long *mtime, unsigned int *links);
+void scan_cache_open(ScanCache *cache);
+const ScanCacheDir *scan_cache_lookup(const ScanCache *cache,
+                                      const char *path, unsigned int length,
+                                      unsigned long long mtime);
+int scan_cache_check_subtree(ScanCacheCheck *check, unsigned int length,
+                             unsigned long long mtime, unsigned int links,
+                             const ScanCacheDir **found);
+void scan_cache_fill_totals(ScanCacheBuilder *builder, unsigned int first,
+                            const ScanEmitter *emitter, int record_count);
+void scan_cache_save(ScanCache *cache);
+const char *scan_backend_name(ScanBackend backend);
+double scan_entries_per_second(const ScanStats *stats);
+int parse_scan_backend(const char *name, ScanBackend *backend);
+const char *copy_method_name(CopyMethod method);
+int parse_copy_method(const char *name, CopyMethod *method);
+void copy_engine_init(CopyEngine *engine);
+void copy_engine_free(CopyEngine *engine);
+long long copy_engine_try(CopyEngine *engine, CopyMethod method,
+                          HANDLE source, long long source_offset,
+                          HANDLE target, long long target_offset,
+                          long long length, Xxh64State *hash);
+int copy_engine_copy(CopyEngine *engine, HANDLE source,
+                     long long source_offset, HANDLE target,
+                     long long target_offset, long long length,
+                     Xxh64State *hash);
+void copy_engine_report(const CopyEngine *engine);
+void split_part_positions(OVERLAPPED *overlapped, long long offset);
+int cdc_params_prepare(CdcParams *params);
+long long cdc_next_cut(const BYTE *scan, long long length,
+                       const CdcParams *params);
+long long *plan_split_parts(const char *file_path, long long file_size,
+                            int *part_count);
+int split_part_unchanged(SplitWorker *worker, HANDLE source, int index);
+int compare_split_reuse(const void *a, const void *b);
+int split_reuse_candidate(const SplitJob *job, const char *split_dir,
+                          SplitReuse *reuse, int first, int last,
+                          const SplitPart *part, BYTE *buffer);
+int split_plan_reuse(SplitJob *job, const char *split_dir);
+HANDLE split_open_source(const char *path);
+DWORD WINAPI split_hash_worker(LPVOID param);
+void split_run_workers(SplitWorker *workers, HANDLE *threads, int count,
+                       LPTHREAD_START_ROUTINE routine);
+int prune_split_directory(const char *split_dir, const SplitPart *parts,
+                          int part_count);
+DWORD WINAPI split_part_worker(LPVOID param);
+int hash_file_update(HANDLE file, long long offset, long long length,
+                     BYTE *buffer, Xxh64State *state);
+int hash_file_range(HANDLE file, long long offset, long long length,
+                    BYTE *buffer, unsigned long long *hash);
+int split_manifest_write(const char *split_dir, const SplitManifest *manifest,
+                         long long *written);
+int split_manifest_read(const char *split_dir, SplitManifest *manifest);
+int split_manifest_check(const char *file_path, const char *split_dir,
+                         long long file_size, const SplitManifest *manifest,
+                         ItemList *parts);
+#ifndef _WIN32
+int linux_entry_info(int dir_fd, const char *name, unsigned char type,
+                     WIN32_FIND_DATAW *find_data);
+void linux_fill_find_data(int dir_fd, const char *name, mode_t mode,
+                          long long size, const struct timespec *mtime,
+                          WIN32_FIND_DATAW *find_data);
+void walk_emit_linux_entry(WalkWorker *worker, const DirNode *task,
+                           const char *dir_path, size_t dir_length,
+                           const char *name, WIN32_FIND_DATAW *find_data);
+int walk_open_directory(const char *dir_path, size_t dir_length);
+void walk_read_directory_getdents(WalkWorker *worker, const DirNode *task,
+                                  const char *dir_path, size_t dir_length);
+StatxRing *statx_ring_create(unsigned int entries);
+void statx_ring_destroy(StatxRing *ring);
+void statx_ring_prepare(StatxRing *ring, int dir_fd, unsigned int slot);
+unsigned int statx_ring_submit(StatxRing *ring, unsigned int count);
+int statx_ring_reap(StatxRing *ring, unsigned int *slot, int *result);
+int uring_backend_available(void);
+void walk_reap_statx_batch(WalkWorker *worker, const DirNode *task,
+                           const char *dir_path, size_t dir_length,
+                           int dir_fd, unsigned int count);
+void walk_read_directory_uring(WalkWorker *worker, const DirNode *task,
+                               const char *dir_path, size_t dir_length);
+#endif
+void parallel_walk(ParallelWalker *walker, const char *root);
+void emit_scan_file(ScanEmitter *emitter, const ScanRecord *record);
+void emit_scan_range(ScanEmitter *emitter, int lo, int hi,
+                     size_t prefix_length, const char *directory_path);
+long long scan_directory_tree(const char *path, ItemList *items,
+                              long long *total_scanned_size,
+                              long long *skipped_files_size,
+                              GroupResult *result, int *has_large_files,
+                              long long *packed_size);
 int create_directory_recursive(const wchar_t *wpath);
 int copy_file_with_backup(const char *src_path, const char *backup_base_path);
-void collect_items_iterative(const wchar_t *wpath, FileItem *items,
-                             int *item_count, long long *total_scanned_size,
-                             long long *skipped_files_size,
-                             GroupResult *result);
-void process_input_path(const char *path, FileItem *items, int *item_count,
+void process_input_path(const char *path, ItemList *items,
                         long long *total_input_size,
                         long long *total_scanned_size,
                         long long *skipped_files_size, GroupResult *result);
 int compare_items(const void *a, const void *b);
+void path_trie_init(PathTrie *trie);
+void path_trie_insert(PathTrie *trie, const char *path, int payload);
+int path_trie_find_container(PathTrie *trie, const char *path);
+void path_trie_free(PathTrie *trie);
+void group_packer_init(GroupPacker *packer, GroupResult *result,
+                       long long group_capacity);
+int group_packer_add(GroupPacker *packer, const FileItem *item, int *created);
+void group_packer_free(GroupPacker *packer);
+const char *pack_strategy_name(PackStrategy strategy);
+int parse_pack_strategy(const char *name, PackStrategy *strategy);
+int pack_lower_bound(const long long *sizes, int count, long long capacity);
+int pack_best_fit(const long long *sizes, int count, long long capacity,
+                  int *assignment);
+int pack_first_fit(const long long *sizes, int count, long long capacity,
+                   int *assignment);
+int pack_differencing(const long long *sizes, int count, long long capacity,
+                      int *assignment, int group_limit);
+int pack_branch_and_bound(const long long *sizes, int count,
+                          long long capacity, int *assignment, int *proven);
+int pack_items(const long long *sizes, int count, long long capacity,
+               int *assignment, PackStrategy *used);
+void print_packing_report(const GroupResult *result, PackStrategy strategy,
+                          int lower_bound);
+unsigned long long hash_file_content(const char *path, int *ok);
+int file_contents_equal(const char *path1, const char *path2);
+int find_duplicate_files(const FileItem *items, int item_count,
+                         int *duplicate_of);
+int *resolve_duplicate_files(FileItem *items, int item_count,
+                             PathTrie *placed_dirs);
 GroupResult group_files(FileItem *items, int item_count);
 void print_groups(const GroupResult *result);
 AdditionalFiles print_skipped_files(GroupResult *result);
@@ -90,18 +750,39 @@ void free_group_result(GroupResult *result);
 GroupResult process_input_paths(char *paths[], int path_count,
                                 long long *total_scanned_size,
                                 long long *skipped_files_size);
+int git_run_with_items(const char *command, const FileItem *items,
+                       int count);
 void execute_git_commands(const GroupResult *result,
                           const char *commit_info_file);
 int run_grouping_test_with_git(char *paths[], int path_count,
                                const char *commit_info_file);
 int run_grouping_test(char *paths[], int path_count);
+char *parse_status_record(char *record, int *is_rename,
+                          GitChangeKind *kind);
 char **get_git_status_paths(int *path_count);
 void free_git_status_paths(char **paths, int path_count);
-int update_gitignore_for_skipped_file(const char *skipped_file_path);
-void collect_split_directory_files(const wchar_t *wdir_path, FileItem *items,
-                                   int *item_count);
+int git_index_load(GitIndex *index);
+void git_index_free(GitIndex *index);
+int git_index_contains(const GitIndex *index, const char *path, size_t length,
+                       int as_directory);
+int glob_match(const char *pattern, const char *text);
+void ignore_list_add_file(IgnoreList *list, const char *file_path,
+                          const char *base);
+int ignore_list_match(const IgnoreList *list, const char *relative_path,
+                      int is_directory);
+void collect_tracked_changes(const GitIndex *index, GitChangeList *list);
+void collect_untracked_paths(UntrackedWalk *walk, char *relative,
+                             size_t length);
+void path_stat_hints_add(const char *path, long long size,
+                         unsigned long long mtime);
+int path_stat_hints_get(const char *path, long long *size,
+                        unsigned long long *mtime);
+void path_stat_hints_free(void);
+char **get_git_index_paths(int *path_count);
+int update_gitignore_for_skipped_file(const char *skipped_file_path,
+                                      ItemList *gitignore_items);
 int is_split_complete(const char *file_path, const char *split_dir,
-                      long long file_size);
+                      long long file_size, ItemList *parts);
 void normalize_directory_path(char *path);
 void print_detailed_group_info(const FileGroup *group, int group_index);
 int delete_original_file(const char *file_path);
@@ -156,9 +837,24 @@ char *wchar_to_char(const wchar_t *wstr) {
   return str;
 }
 
+const wchar_t *path_to_wide(const char *path, int slot) {
+  if (!path || MultiByteToWideChar(CP_UTF8, 0, path, -1, g_wide_scratch[slot],
+                                   MAX_PATH_LENGTH) == 0) {
+    return NULL;
+  }
+  return g_wide_scratch[slot];
+}
+
+int path_from_wide(char *buffer, int buffer_size, const wchar_t *wpath) {
+  int len = WideCharToMultiByte(CP_UTF8, 0, wpath, -1, buffer, buffer_size,
+                                NULL, NULL);
+  return len > 0 ? len - 1 : -1;
+}
+
 int safe_path_join(wchar_t *dest, size_t dest_size, const wchar_t *path1,
                    const wchar_t *path2) {
-  if (_snwprintf_s(dest, dest_size, _TRUNCATE, L"%s\\%s", path1, path2) < 0) {
+  if (_snwprintf_s(dest, dest_size, _TRUNCATE, L"%ls\\%ls", path1, path2) <
+      0) {
     dest[dest_size - 1] = L'\0';
     return 0;
   }
@@ -218,2111 +914,6022 @@ void draw_progress_bar(int current, int total, const char *prefix) {
   fflush(stdout);
 }
 
-int directory_contains_large_files(const wchar_t *wpath,
-                                   long long *total_scanned_size) {
-  int has_large_files = 0;
-  DirectoryEntry *queue = (DirectoryEntry *)safe_malloc(sizeof(DirectoryEntry) *
-                                                        MAX_DIRECTORY_QUEUE);
-  int queue_front = 0, queue_rear = 0;
-  wcscpy_s(queue[queue_rear].path, MAX_PATH_LENGTH, wpath);
-  queue[queue_rear].depth = 0;
-  queue_rear = (queue_rear + 1) % MAX_DIRECTORY_QUEUE;
-  while (queue_front != queue_rear && !has_large_files) {
-    DirectoryEntry current = queue[queue_front];
-    queue_front = (queue_front + 1) % MAX_DIRECTORY_QUEUE;
-    if (current.depth > 50) {
+unsigned int hash_path(const char *path, size_t length) {
+  unsigned int h = 2166136261u;
+  for (size_t i = 0; i < length; i++) {
+    h ^= (unsigned char)path[i];
+    h *= 16777619u;
+  }
+  return h;
+}
+
+void path_arena_grow_index(PathArena *arena) {
+  size_t new_capacity =
+      arena->index_capacity == 0 ? 1024 : arena->index_capacity * 2;
+  unsigned int *new_index =
+      (unsigned int *)safe_malloc(sizeof(unsigned int) * new_capacity);
+  memset(new_index, 0, sizeof(unsigned int) * new_capacity);
+  for (size_t i = 0; i < arena->index_capacity; i++) {
+    unsigned int entry = arena->index[i];
+    if (entry == 0) {
       continue;
     }
-    wchar_t search_path[MAX_PATH_LENGTH];
-    if (!safe_path_join(search_path, MAX_PATH_LENGTH, current.path, L"*")) {
-      continue;
+    const char *existing = arena->data + entry - 1;
+    size_t slot = hash_path(existing, strlen(existing)) & (new_capacity - 1);
+    while (new_index[slot] != 0) {
+      slot = (slot + 1) & (new_capacity - 1);
     }
-    WIN32_FIND_DATAW find_data;
-    HANDLE hFind = FindFirstFileW(search_path, &find_data);
-    if (hFind == INVALID_HANDLE_VALUE) {
-      continue;
+    new_index[slot] = entry;
+  }
+  free(arena->index);
+  arena->index = new_index;
+  arena->index_capacity = new_capacity;
+}
+
+unsigned int path_arena_intern(const char *path) {
+  PathArena *arena = &g_path_arena;
+  size_t length = strlen(path);
+  if ((arena->index_count + 1) * 2 > arena->index_capacity) {
+    path_arena_grow_index(arena);
+  }
+  size_t mask = arena->index_capacity - 1;
+  size_t slot = hash_path(path, length) & mask;
+  while (arena->index[slot] != 0) {
+    const char *existing = arena->data + arena->index[slot] - 1;
+    if (strncmp(existing, path, length) == 0 && existing[length] == '\0') {
+      return arena->index[slot] - 1;
     }
-    do {
-      if (wcscmp(find_data.cFileName, L".") == 0 ||
-          wcscmp(find_data.cFileName, L"..") == 0) {
-        continue;
-      }
-      wchar_t full_path[MAX_PATH_LENGTH];
-      if (!safe_path_join(full_path, MAX_PATH_LENGTH, current.path,
-                          find_data.cFileName)) {
-        continue;
-      }
-      if (find_data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) {
-        if ((queue_rear + 1) % MAX_DIRECTORY_QUEUE != queue_front) {
-          wcscpy_s(queue[queue_rear].path, MAX_PATH_LENGTH, full_path);
-          queue[queue_rear].depth = current.depth + 1;
-          queue_rear = (queue_rear + 1) % MAX_DIRECTORY_QUEUE;
-        }
-      } else {
-        ULARGE_INTEGER file_size;
-        file_size.LowPart = find_data.nFileSizeLow;
-        file_size.HighPart = find_data.nFileSizeHigh;
-        *total_scanned_size += file_size.QuadPart;
-        if (file_size.QuadPart > MAX_FILE_SIZE) {
-          has_large_files = 1;
-          char *char_path = wchar_to_char(full_path);
-          if (char_path) {
-            printf("       发现大文件: %s", char_path);
-            char size_str[32];
-            format_size(file_size.QuadPart, size_str, sizeof(size_str));
-            printf(" (%s)\n", size_str);
-            free(char_path);
-          }
-          break;
-        }
+    slot = (slot + 1) & mask;
+  }
+  if (arena->length + length + 1 > arena->capacity) {
+    size_t new_capacity = arena->capacity == 0 ? 64 * 1024 : arena->capacity;
+    while (arena->length + length + 1 > new_capacity) {
+      new_capacity *= 2;
+    }
+    arena->data = (char *)safe_realloc(arena->data, new_capacity);
+    arena->capacity = new_capacity;
+  }
+  unsigned int offset = (unsigned int)arena->length;
+  memcpy(arena->data + offset, path, length + 1);
+  arena->length += length + 1;
+  arena->index[slot] = offset + 1;
+  arena->index_count++;
+  return offset;
+}
+
+const char *item_path(const FileItem *item) {
+  return g_path_arena.data + item->path_offset;
+}
+
+void init_file_item(FileItem *item, const char *path, long long size,
+                    ItemType type) {
+  item->path_offset = path_arena_intern(path);
+  item->path_length = (unsigned int)strlen(path);
+  item->size = size;
+  item->packed_size = size;
+  item->type = type;
+}
+
+void item_list_reserve(ItemList *list, int needed) {
+  if (needed <= list->capacity) {
+    return;
+  }
+  int new_capacity = list->capacity == 0 ? 256 : list->capacity;
+  while (new_capacity < needed) {
+    new_capacity *= 2;
+  }
+  list->items =
+      (FileItem *)safe_realloc(list->items, sizeof(FileItem) * new_capacity);
+  list->capacity = new_capacity;
+}
+
+FileItem *item_list_add(ItemList *list, const char *path, long long size,
+                        ItemType type) {
+  item_list_reserve(list, list->count + 1);
+  FileItem *item = &list->items[list->count++];
+  init_file_item(item, path, size, type);
+  return item;
+}
+
+void path_arena_free(void) {
+  free(g_path_arena.data);
+  free(g_path_arena.index);
+  memset(&g_path_arena, 0, sizeof(g_path_arena));
+}
+
+double get_time_seconds(void) {
+  static LARGE_INTEGER frequency = {0};
+  if (frequency.QuadPart == 0) {
+    QueryPerformanceFrequency(&frequency);
+  }
+  LARGE_INTEGER counter;
+  QueryPerformanceCounter(&counter);
+  return (double)counter.QuadPart / (double)frequency.QuadPart;
+}
+
+unsigned long long filetime_to_u64(const FILETIME *time) {
+  return ((unsigned long long)time->dwHighDateTime << 32) |
+         time->dwLowDateTime;
+}
+
+int estimate_cache_find_slot(const EstimateCacheEntry *entries, int capacity,
+                             const char *path) {
+  int slot = (int)(hash_path(path, strlen(path)) & (capacity - 1));
+  while (entries[slot].path && strcmp(entries[slot].path, path) != 0) {
+    slot = (slot + 1) & (capacity - 1);
+  }
+  return slot;
+}
+
+void estimate_cache_put_locked(const char *path, long long size,
+                               unsigned long long mtime, int ratio_permille) {
+  EstimateCache *cache = &g_estimate_cache;
+  if ((cache->count + 1) * 10 >= cache->capacity * 7) {
+    int new_capacity = cache->capacity == 0 ? 1024 : cache->capacity * 2;
+    EstimateCacheEntry *entries = (EstimateCacheEntry *)safe_malloc(
+        sizeof(EstimateCacheEntry) * new_capacity);
+    memset(entries, 0, sizeof(EstimateCacheEntry) * new_capacity);
+    for (int i = 0; i < cache->capacity; i++) {
+      if (cache->entries[i].path) {
+        int slot = estimate_cache_find_slot(entries, new_capacity,
+                                            cache->entries[i].path);
+        entries[slot] = cache->entries[i];
       }
-    } while (FindNextFileW(hFind, &find_data) && !has_large_files);
-    FindClose(hFind);
+    }
+    free(cache->entries);
+    cache->entries = entries;
+    cache->capacity = new_capacity;
+  }
+  int slot = estimate_cache_find_slot(cache->entries, cache->capacity, path);
+  EstimateCacheEntry *entry = &cache->entries[slot];
+  if (!entry->path) {
+    size_t length = strlen(path);
+    entry->path = (char *)safe_malloc(length + 1);
+    memcpy(entry->path, path, length + 1);
+    cache->count++;
   }
-  free(queue);
-  return has_large_files;
+  entry->size = size;
+  entry->mtime = mtime;
+  entry->ratio_permille = ratio_permille;
+  cache->dirty = 1;
 }
 
-long long calculate_directory_size_iterative(const wchar_t *wpath,
-                                             long long *total_scanned_size) {
-  long long total_size = 0;
-  DirectoryEntry *queue = (DirectoryEntry *)safe_malloc(sizeof(DirectoryEntry) *
-                                                        MAX_DIRECTORY_QUEUE);
-  int queue_front = 0, queue_rear = 0;
-  wchar_t **processed_dirs =
-      (wchar_t **)safe_malloc(sizeof(wchar_t *) * MAX_DIRECTORY_QUEUE);
-  int processed_count = 0;
-  wcscpy_s(queue[queue_rear].path, MAX_PATH_LENGTH, wpath);
-  queue[queue_rear].depth = 0;
-  queue_rear = (queue_rear + 1) % MAX_DIRECTORY_QUEUE;
-  processed_dirs[processed_count] =
-      (wchar_t *)safe_malloc((wcslen(wpath) + 1) * sizeof(wchar_t));
-  wcscpy_s(processed_dirs[processed_count], MAX_PATH_LENGTH, wpath);
-  processed_count++;
-  while (queue_front != queue_rear) {
-    DirectoryEntry current = queue[queue_front];
-    queue_front = (queue_front + 1) % MAX_DIRECTORY_QUEUE;
-    if (current.depth > 100) {
-      continue;
+int estimate_cache_get(const char *path, long long size,
+                       unsigned long long mtime) {
+  EstimateCache *cache = &g_estimate_cache;
+  int ratio_permille = -1;
+  EnterCriticalSection(&cache->lock);
+  if (cache->capacity > 0) {
+    int slot = estimate_cache_find_slot(cache->entries, cache->capacity, path);
+    EstimateCacheEntry *entry = &cache->entries[slot];
+    if (entry->path && entry->size == size && entry->mtime == mtime) {
+      ratio_permille = entry->ratio_permille;
     }
-    wchar_t search_path[MAX_PATH_LENGTH];
-    if (!safe_path_join(search_path, MAX_PATH_LENGTH, current.path, L"*")) {
+  }
+  LeaveCriticalSection(&cache->lock);
+  return ratio_permille;
+}
+
+void estimate_cache_load(void) {
+  EstimateCache *cache = &g_estimate_cache;
+  InitializeCriticalSection(&cache->lock);
+  cache->initialized = 1;
+  FILE *file = compat_fopen(ESTIMATE_CACHE_FILE, "r");
+  if (!file) {
+    return;
+  }
+  char line[MAX_PATH_LENGTH + 128];
+  while (fgets(line, sizeof(line), file)) {
+    unsigned long long mtime;
+    long long size;
+    int ratio_permille, path_start = 0;
+    if (sscanf(line, "%llu %lld %d %n", &mtime, &size, &ratio_permille,
+                 &path_start) < 3 ||
+        path_start == 0) {
       continue;
     }
-    WIN32_FIND_DATAW find_data;
-    HANDLE hFind = FindFirstFileW(search_path, &find_data);
-    if (hFind == INVALID_HANDLE_VALUE) {
-      continue;
+    char *path = line + path_start;
+    path[strcspn(path, "\r\n")] = '\0';
+    if (path[0] != '\0') {
+      estimate_cache_put_locked(path, size, mtime, ratio_permille);
     }
-    do {
-      if (wcscmp(find_data.cFileName, L".") == 0 ||
-          wcscmp(find_data.cFileName, L"..") == 0) {
-        continue;
-      }
-      wchar_t full_path[MAX_PATH_LENGTH];
-      if (!safe_path_join(full_path, MAX_PATH_LENGTH, current.path,
-                          find_data.cFileName)) {
-        continue;
-      }
-      int already_processed = 0;
-      for (int i = 0; i < processed_count; i++) {
-        if (wcscmp(processed_dirs[i], full_path) == 0) {
-          already_processed = 1;
-          break;
-        }
-      }
-      if (already_processed) {
-        continue;
-      }
-      if (find_data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) {
-        if ((queue_rear + 1) % MAX_DIRECTORY_QUEUE != queue_front) {
-          wcscpy_s(queue[queue_rear].path, MAX_PATH_LENGTH, full_path);
-          queue[queue_rear].depth = current.depth + 1;
-          queue_rear = (queue_rear + 1) % MAX_DIRECTORY_QUEUE;
-          if (processed_count < MAX_DIRECTORY_QUEUE) {
-            processed_dirs[processed_count] = (wchar_t *)safe_malloc(
-                (wcslen(full_path) + 1) * sizeof(wchar_t));
-            wcscpy_s(processed_dirs[processed_count], MAX_PATH_LENGTH,
-                     full_path);
-            processed_count++;
-          }
+  }
+  fclose(file);
+  cache->dirty = 0;
+  printf("已加载压缩估算缓存: %d 条\n", cache->count);
+}
+
+void estimate_cache_save(void) {
+  EstimateCache *cache = &g_estimate_cache;
+  if (cache->dirty) {
+    FILE *file = compat_fopen(ESTIMATE_CACHE_FILE, "w");
+    if (file) {
+      for (int i = 0; i < cache->capacity; i++) {
+        const EstimateCacheEntry *entry = &cache->entries[i];
+        if (entry->path) {
+          fprintf(file, "%llu %lld %d %s\n", entry->mtime, entry->size,
+                  entry->ratio_permille, entry->path);
         }
-      } else {
-        ULARGE_INTEGER file_size;
-        file_size.LowPart = find_data.nFileSizeLow;
-        file_size.HighPart = find_data.nFileSizeHigh;
-        total_size += file_size.QuadPart;
-        *total_scanned_size += file_size.QuadPart;
       }
-    } while (FindNextFileW(hFind, &find_data));
-    FindClose(hFind);
+      fclose(file);
+      printf("已保存压缩估算缓存: %d 条\n", cache->count);
+    } else {
+      printf("[警告] 无法写入压缩估算缓存: %s\n", ESTIMATE_CACHE_FILE);
+    }
   }
-  for (int i = 0; i < processed_count; i++) {
-    free(processed_dirs[i]);
+  for (int i = 0; i < cache->capacity; i++) {
+    free(cache->entries[i].path);
   }
-  free(processed_dirs);
-  free(queue);
-  return total_size;
+  free(cache->entries);
+  if (cache->initialized) {
+    DeleteCriticalSection(&cache->lock);
+  }
+  memset(cache, 0, sizeof(EstimateCache));
 }
 
-int create_directory_recursive(const wchar_t *wpath) {
-  wchar_t temp_path[MAX_PATH_LENGTH];
-  wchar_t *p = NULL;
-  size_t len = wcslen(wpath);
-  wcscpy_s(temp_path, MAX_PATH_LENGTH, wpath);
-  for (p = temp_path + 1; *p; p++) {
-    if (*p == L'\\') {
-      *p = L'\0';
-      DWORD attr = GetFileAttributesW(temp_path);
-      if (attr == INVALID_FILE_ATTRIBUTES) {
-        if (!CreateDirectoryW(temp_path, NULL)) {
-          DWORD error = GetLastError();
-          if (error != ERROR_ALREADY_EXISTS) {
-            wprintf(L"[错误] 无法创建目录: %s (错误: %lu)\n", temp_path, error);
-            return 0;
-          }
-        }
-      } else if (!(attr & FILE_ATTRIBUTE_DIRECTORY)) {
-        wprintf(L"[错误] 路径不是目录: %s\n", temp_path);
-        return 0;
-      }
-      *p = L'\\';
+unsigned int log2_fixed(unsigned int value) {
+  int integer = 0;
+  while ((value >> integer) > 1) {
+    integer++;
+  }
+  unsigned long long mantissa = ((unsigned long long)value << 30) >> integer;
+  unsigned int result = (unsigned int)integer << 16;
+  for (int bit = 15; bit >= 0; bit--) {
+    mantissa = (mantissa * mantissa) >> 30;
+    if (mantissa >= (2ULL << 30)) {
+      mantissa >>= 1;
+      result |= 1u << bit;
     }
   }
-  DWORD attr = GetFileAttributesW(temp_path);
-  if (attr == INVALID_FILE_ATTRIBUTES) {
-    if (!CreateDirectoryW(temp_path, NULL)) {
-      DWORD error = GetLastError();
-      if (error != ERROR_ALREADY_EXISTS) {
-        wprintf(L"[错误] 无法创建目录: %s (错误: %lu)\n", temp_path, error);
-        return 0;
-      }
+  return result;
+}
+
+double estimate_block_bits(const unsigned char *data, DWORD length) {
+  unsigned int counts[256] = {0};
+  for (DWORD i = 0; i < length; i++) {
+    counts[data[i]]++;
+  }
+  unsigned int length_log = log2_fixed(length);
+  long long bits = 0;
+  for (int i = 0; i < 256; i++) {
+    if (counts[i] > 0) {
+      bits += (long long)counts[i] * (length_log - log2_fixed(counts[i]));
     }
   }
-  return 1;
+  return bits / 65536.0 + ESTIMATE_BLOCK_OVERHEAD * 8;
 }
 
-int copy_file_with_backup(const char *src_path, const char *backup_base_path) {
-  wchar_t *wsrc_path = char_to_wchar(src_path);
-  if (!wsrc_path) {
-    printf("[错误] 无法转换源路径编码: %s\n", src_path);
-    return 0;
+int sample_compression_ratio(const char *path, long long size) {
+  const wchar_t *wpath = path_to_wide(path, 0);
+  if (!wpath) {
+    return 1000;
   }
-  DWORD src_attr = GetFileAttributesW(wsrc_path);
-  if (src_attr == INVALID_FILE_ATTRIBUTES) {
-    DWORD error = GetLastError();
-    printf("[错误] 源文件无法访问: %s (错误: %lu)\n", src_path, error);
-    free(wsrc_path);
-    return 0;
+  HANDLE file = CreateFileW(wpath, GENERIC_READ, FILE_SHARE_READ, NULL,
+                            OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+  if (file == INVALID_HANDLE_VALUE) {
+    return 1000;
   }
-  if (src_attr & FILE_ATTRIBUTE_DIRECTORY) {
-    printf("[错误] 源路径是目录而不是文件: %s\n", src_path);
-    free(wsrc_path);
-    return 0;
+  unsigned char *block = (unsigned char *)safe_malloc(ESTIMATE_BLOCK_SIZE);
+  long long sampled = 0;
+  double bits = 0;
+  int blocks = size > (long long)ESTIMATE_BLOCK_SIZE * ESTIMATE_SAMPLE_BLOCKS
+                   ? ESTIMATE_SAMPLE_BLOCKS
+                   : 1;
+  long long stride = blocks > 1 ? (size - ESTIMATE_BLOCK_SIZE) / (blocks - 1)
+                                : 0;
+  for (int i = 0; i < blocks; i++) {
+    LARGE_INTEGER offset;
+    offset.QuadPart = stride * i;
+    DWORD bytes_read = 0;
+    if (!SetFilePointerEx(file, offset, NULL, FILE_BEGIN) ||
+        !ReadFile(file, block, ESTIMATE_BLOCK_SIZE, &bytes_read, NULL) ||
+        bytes_read == 0) {
+      break;
+    }
+    bits += estimate_block_bits(block, bytes_read);
+    sampled += bytes_read;
   }
-  char git_repo_path[MAX_PATH_LENGTH];
-  if (!GetCurrentDirectoryA(MAX_PATH_LENGTH, git_repo_path)) {
-    printf("[错误] 无法获取当前工作目录\n");
-    free(wsrc_path);
-    return 0;
+  free(block);
+  CloseHandle(file);
+  if (sampled == 0) {
+    return 1000;
   }
-  normalize_path(git_repo_path);
-  char backup_dir[MAX_PATH_LENGTH];
-  snprintf(backup_dir, MAX_PATH_LENGTH, "%s-backup", git_repo_path);
-  char backup_path[MAX_PATH_LENGTH];
-  if (strstr(src_path, git_repo_path) == src_path) {
-    const char *relative_part = src_path + strlen(git_repo_path);
-    if (*relative_part == '\\' || *relative_part == '/') {
-      relative_part++;
-    }
-    if (strlen(relative_part) > 0) {
-      snprintf(backup_path, MAX_PATH_LENGTH, "%s\\%s", backup_dir,
-               relative_part);
-    } else {
-      const char *filename = strrchr(src_path, '\\');
-      if (!filename) {
-        filename = strrchr(src_path, '/');
-      }
-      if (filename) {
-        filename++;
-      } else {
-        filename = src_path;
-      }
-      snprintf(backup_path, MAX_PATH_LENGTH, "%s\\%s", backup_dir, filename);
+  int ratio_permille = (int)(bits / 8 * 1000 / sampled) + 1;
+  return ratio_permille > 1000 ? 1000 : ratio_permille;
+}
+
+long long estimate_packed_size(const char *path, long long size,
+                               const FILETIME *mtime) {
+  if (!g_run_options.estimate_pack || size < ESTIMATE_MIN_FILE_SIZE) {
+    return size;
+  }
+  unsigned long long mtime_value = filetime_to_u64(mtime);
+  int ratio_permille = estimate_cache_get(path, size, mtime_value);
+  if (ratio_permille < 0) {
+    ratio_permille = sample_compression_ratio(path, size);
+    EnterCriticalSection(&g_estimate_cache.lock);
+    estimate_cache_put_locked(path, size, mtime_value, ratio_permille);
+    LeaveCriticalSection(&g_estimate_cache.lock);
+  }
+  long long estimate = size / 1000 * ratio_permille +
+                       size % 1000 * ratio_permille / 1000;
+  estimate += estimate / 100 * g_run_options.pack_margin;
+  return estimate < size ? estimate : size;
+}
+
+long long measure_head_pack_size(void) {
+  const char *command =
+      _wsystem(L"git rev-parse -q --verify HEAD~1 >nul 2>&1") == 0
+          ? "git rev-list --objects HEAD --not HEAD~1 | "
+            "git pack-objects --stdout -q"
+          : "git rev-list --objects HEAD | git pack-objects --stdout -q";
+  FILE *pipe = _popen(command, "rb");
+  if (!pipe) {
+    return -1;
+  }
+  char buffer[65536];
+  long long total = 0;
+  size_t bytes_read;
+  while ((bytes_read = fread(buffer, 1, sizeof(buffer), pipe)) > 0) {
+    total += bytes_read;
+  }
+  if (_pclose(pipe) != 0) {
+    return -1;
+  }
+  return total;
+}
+
+void add_skipped_file(GroupResult *result, const char *path, long long size) {
+  if (result->skipped_count >= result->skipped_capacity) {
+    int new_capacity =
+        result->skipped_capacity == 0 ? 10 : result->skipped_capacity * 2;
+    SkippedFile *new_skipped = (SkippedFile *)safe_realloc(
+        result->skipped_files, sizeof(SkippedFile) * new_capacity);
+    result->skipped_files = new_skipped;
+    result->skipped_capacity = new_capacity;
+  }
+  strcpy_s(result->skipped_files[result->skipped_count].path, MAX_PATH_LENGTH,
+           path);
+  result->skipped_files[result->skipped_count].size = size;
+  result->skipped_count++;
+}
+
+int get_scan_thread_count(void) {
+  int thread_count = g_run_options.scan_threads;
+  if (thread_count <= 0) {
+    SYSTEM_INFO system_info;
+    GetSystemInfo(&system_info);
+    thread_count = (int)system_info.dwNumberOfProcessors;
+  }
+  if (thread_count < 1) {
+    thread_count = 1;
+  }
+  if (thread_count > MAX_SCAN_THREADS) {
+    thread_count = MAX_SCAN_THREADS;
+  }
+  return thread_count;
+}
+
+void visited_set_init(VisitedSet *set, size_t initial_capacity) {
+  size_t capacity = 64;
+  while (capacity < initial_capacity * 2) {
+    capacity *= 2;
+  }
+  set->slots = (DirectoryKey *)safe_malloc(sizeof(DirectoryKey) * capacity);
+  memset(set->slots, 0, sizeof(DirectoryKey) * capacity);
+  set->capacity = capacity;
+  set->count = 0;
+  InitializeCriticalSection(&set->lock);
+}
+
+size_t hash_directory_key(const DirectoryKey *key) {
+  unsigned long long h =
+      key->file_id ^ ((unsigned long long)key->volume_serial << 32);
+  h ^= h >> 33;
+  h *= 0xff51afd7ed558ccdULL;
+  h ^= h >> 33;
+  h *= 0xc4ceb9fe1a85ec53ULL;
+  h ^= h >> 33;
+  return (size_t)h;
+}
+
+int visited_set_insert_slot(DirectoryKey *slots, size_t capacity,
+                            const DirectoryKey *key) {
+  size_t mask = capacity - 1;
+  size_t index = hash_directory_key(key) & mask;
+  while (slots[index].used) {
+    if (slots[index].file_id == key->file_id &&
+        slots[index].volume_serial == key->volume_serial) {
+      return 0;
     }
-  } else {
-    char safe_path[MAX_PATH_LENGTH];
-    strcpy_s(safe_path, MAX_PATH_LENGTH, src_path);
-    for (char *p = safe_path; *p; p++) {
-      if (*p == ':') {
-        *p = '_';
-      }
-      if (*p == '/') {
-        *p = '\\';
+    index = (index + 1) & mask;
+  }
+  slots[index] = *key;
+  slots[index].used = 1;
+  return 1;
+}
+
+int visited_set_insert(VisitedSet *set, const DirectoryKey *key) {
+  EnterCriticalSection(&set->lock);
+  if ((set->count + 1) * 2 > set->capacity) {
+    size_t new_capacity = set->capacity * 2;
+    DirectoryKey *new_slots =
+        (DirectoryKey *)safe_malloc(sizeof(DirectoryKey) * new_capacity);
+    memset(new_slots, 0, sizeof(DirectoryKey) * new_capacity);
+    for (size_t i = 0; i < set->capacity; i++) {
+      if (set->slots[i].used) {
+        visited_set_insert_slot(new_slots, new_capacity, &set->slots[i]);
       }
     }
-    if (safe_path[0] == '\\') {
-      snprintf(backup_path, MAX_PATH_LENGTH, "%s\\%s", backup_dir,
-               safe_path + 1);
-    } else {
-      snprintf(backup_path, MAX_PATH_LENGTH, "%s\\%s", backup_dir, safe_path);
-    }
+    free(set->slots);
+    set->slots = new_slots;
+    set->capacity = new_capacity;
   }
-  normalize_path(backup_path);
-  wchar_t *wbackup_path = char_to_wchar(backup_path);
-  if (!wbackup_path) {
-    printf("[错误] 无法转换备份路径编码: %s\n", backup_path);
-    free(wsrc_path);
+  int inserted = visited_set_insert_slot(set->slots, set->capacity, key);
+  if (inserted) {
+    set->count++;
+  }
+  LeaveCriticalSection(&set->lock);
+  return inserted;
+}
+
+void visited_set_free(VisitedSet *set) {
+  free(set->slots);
+  set->slots = NULL;
+  set->capacity = 0;
+  set->count = 0;
+  DeleteCriticalSection(&set->lock);
+}
+
+int get_directory_key(const char *path, DirectoryKey *key,
+                      unsigned long long *mtime, unsigned int *links) {
+  const wchar_t *wpath = path_to_wide(path, 0);
+  if (!wpath) {
     return 0;
   }
-  wchar_t backup_dir_wide[MAX_PATH_LENGTH];
-  wcscpy_s(backup_dir_wide, MAX_PATH_LENGTH, wbackup_path);
-  wchar_t *last_slash = wcsrchr(backup_dir_wide, L'\\');
-  if (last_slash) {
-    *last_slash = L'\0';
-    if (!create_directory_recursive(backup_dir_wide)) {
-      printf("[错误] 无法创建备份目录结构\n");
-      free(wsrc_path);
-      free(wbackup_path);
-      return 0;
-    }
+  HANDLE hDir = CreateFileW(
+      wpath, FILE_READ_ATTRIBUTES,
+      FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, NULL,
+      OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS, NULL);
+  if (hDir == INVALID_HANDLE_VALUE) {
+    return 0;
   }
-  printf("    备份到: %s\n", backup_path);
-  if (CopyFileW(wsrc_path, wbackup_path, FALSE)) {
-    printf("    [成功] 文件备份完成\n");
-    free(wsrc_path);
-    free(wbackup_path);
-    return 1;
-  } else {
-    DWORD error = GetLastError();
-    printf("    [失败] 文件备份失败 (错误: %lu)\n", error);
-    free(wsrc_path);
-    free(wbackup_path);
+  BY_HANDLE_FILE_INFORMATION info;
+  int ok = GetFileInformationByHandle(hDir, &info);
+  CloseHandle(hDir);
+  if (!ok) {
     return 0;
   }
+  key->file_id = ((unsigned long long)info.nFileIndexHigh << 32) |
+                 info.nFileIndexLow;
+  key->volume_serial = info.dwVolumeSerialNumber;
+  key->used = 1;
+  if (mtime) {
+    *mtime = filetime_to_u64(&info.ftLastWriteTime);
+  }
+  if (links) {
+    *links = (unsigned int)info.nNumberOfLinks;
+  }
+  return 1;
 }
 
-void collect_items_iterative(const wchar_t *wpath, FileItem *items,
-                             int *item_count, long long *total_scanned_size,
-                             long long *skipped_files_size,
-                             GroupResult *result) {
-  DirectoryEntry *queue = (DirectoryEntry *)safe_malloc(sizeof(DirectoryEntry) *
-                                                        MAX_DIRECTORY_QUEUE);
-  int queue_front = 0, queue_rear = 0;
-  char **processed_dirs = (char **)safe_malloc(sizeof(char *) * MAX_ITEMS);
-  int processed_count = 0;
-  wcscpy_s(queue[queue_rear].path, MAX_PATH_LENGTH, wpath);
-  queue[queue_rear].depth = 0;
-  queue_rear = (queue_rear + 1) % MAX_DIRECTORY_QUEUE;
-  while (queue_front != queue_rear && *item_count < MAX_ITEMS) {
-    DirectoryEntry current = queue[queue_front];
-    queue_front = (queue_front + 1) % MAX_DIRECTORY_QUEUE;
-    if (current.depth > 50) {
-      continue;
-    }
-    wchar_t search_path[MAX_PATH_LENGTH];
-    if (!safe_path_join(search_path, MAX_PATH_LENGTH, current.path, L"*")) {
-      continue;
-    }
-    WIN32_FIND_DATAW find_data;
-    HANDLE hFind = FindFirstFileW(search_path, &find_data);
-    if (hFind == INVALID_HANDLE_VALUE) {
-      continue;
-    }
-    do {
-      if (wcscmp(find_data.cFileName, L".") == 0 ||
-          wcscmp(find_data.cFileName, L"..") == 0) {
-        continue;
-      }
-      wchar_t full_path[MAX_PATH_LENGTH];
-      if (!safe_path_join(full_path, MAX_PATH_LENGTH, current.path,
-                          find_data.cFileName)) {
-        continue;
-      }
-      if (find_data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) {
-        if ((queue_rear + 1) % MAX_DIRECTORY_QUEUE != queue_front) {
-          wcscpy_s(queue[queue_rear].path, MAX_PATH_LENGTH, full_path);
-          queue[queue_rear].depth = current.depth + 1;
-          queue_rear = (queue_rear + 1) % MAX_DIRECTORY_QUEUE;
-        }
-      } else {
-        ULARGE_INTEGER file_size;
-        file_size.LowPart = find_data.nFileSizeLow;
-        file_size.HighPart = find_data.nFileSizeHigh;
-        *total_scanned_size += file_size.QuadPart;
-        if (file_size.QuadPart > MAX_FILE_SIZE) {
-          char *char_path = wchar_to_char(full_path);
-          if (char_path) {
-            printf("[跳过] 大文件: %s", char_path);
-            char size_str[32];
-            format_size(file_size.QuadPart, size_str, sizeof(size_str));
-            printf(" (%s)\n", size_str);
-            free(char_path);
-          }
-          *skipped_files_size += file_size.QuadPart;
-          if (result->skipped_count < MAX_ITEMS) {
-            if (result->skipped_count >= result->skipped_capacity) {
-              int new_capacity = result->skipped_capacity == 0
-                                     ? 10
-                                     : result->skipped_capacity * 2;
-              SkippedFile *new_skipped = (SkippedFile *)safe_realloc(
-                  result->skipped_files, sizeof(SkippedFile) * new_capacity);
-              result->skipped_files = new_skipped;
-              result->skipped_capacity = new_capacity;
-            }
-            char *char_path = wchar_to_char(full_path);
-            if (char_path) {
-              normalize_path(char_path);
-              if (strlen(char_path) < MAX_PATH_LENGTH - 1) {
-                strcpy_s(result->skipped_files[result->skipped_count].path,
-                         MAX_PATH_LENGTH, char_path);
-                result->skipped_files[result->skipped_count].size =
-                    file_size.QuadPart;
-                result->skipped_count++;
-              }
-              free(char_path);
-            }
-          }
-        } else {
-          char *char_path = wchar_to_char(full_path);
-          if (char_path) {
-            if (strlen(char_path) < MAX_PATH_LENGTH - 1) {
-              normalize_path(char_path);
-              strcpy_s(items[*item_count].path, MAX_PATH_LENGTH, char_path);
-              items[*item_count].size = file_size.QuadPart;
-              items[*item_count].type = TYPE_FILE;
-              (*item_count)++;
-            }
-            free(char_path);
-          }
-        }
-      }
-    } while (FindNextFileW(hFind, &find_data) && *item_count < MAX_ITEMS);
-    FindClose(hFind);
+void scan_cache_builder_reserve(void **data, unsigned int *capacity,
+                                unsigned int needed, size_t element_size) {
+  if (needed <= *capacity) {
+    return;
   }
-  for (int i = 0; i < processed_count; i++) {
-    free(processed_dirs[i]);
+  unsigned int new_capacity = *capacity == 0 ? 256 : *capacity;
+  while (new_capacity < needed) {
+    new_capacity *= 2;
   }
-  free(processed_dirs);
-  free(queue);
+  *data = safe_realloc(*data, element_size * new_capacity);
+  *capacity = new_capacity;
 }
 
-void process_input_path(const char *path, FileItem *items, int *item_count,
-                        long long *total_input_size,
-                        long long *total_scanned_size,
-                        long long *skipped_files_size, GroupResult *result) {
-  char normalized_path[MAX_PATH_LENGTH];
-  strcpy_s(normalized_path, MAX_PATH_LENGTH, path);
-  normalize_path(normalized_path);
-  printf("[处理] 正在处理路径: %s\n", normalized_path);
-  int is_directory_path = 0;
-  size_t path_len = strlen(normalized_path);
-  if (path[path_len > 0 ? path_len - 1 : 0] == '\\' ||
-      path[path_len > 0 ? path_len - 1 : 0] == '/') {
-    is_directory_path = 1;
-    printf("  [信息] 识别为目录路径\n");
+unsigned int scan_cache_builder_add_name(ScanCacheBuilder *builder,
+                                         const char *name,
+                                         unsigned int length) {
+  scan_cache_builder_reserve((void **)&builder->names,
+                             &builder->name_capacity,
+                             builder->name_count + length, sizeof(char));
+  unsigned int offset = builder->name_count;
+  memcpy(builder->names + offset, name, length);
+  builder->name_count += length;
+  return offset;
+}
+
+ScanCacheDir *scan_cache_builder_add_dir(ScanCacheBuilder *builder,
+                                        const char *path, unsigned int length,
+                                        unsigned long long mtime,
+                                        unsigned int age) {
+  scan_cache_builder_reserve((void **)&builder->dirs, &builder->dir_capacity,
+                             builder->dir_count + 1, sizeof(ScanCacheDir));
+  ScanCacheDir *dir = &builder->dirs[builder->dir_count++];
+  memset(dir, 0, sizeof(ScanCacheDir));
+  dir->mtime = mtime;
+  dir->path_offset = scan_cache_builder_add_name(builder, path, length);
+  dir->path_length = length;
+  dir->entry_first = builder->entry_count;
+  dir->age = age;
+  dir->hash = hash_path(path, length);
+  return dir;
+}
+
+void scan_cache_builder_add_entry(ScanCacheBuilder *builder,
+                                  const char *name, unsigned int length,
+                                  unsigned int attributes) {
+  scan_cache_builder_reserve(
+      (void **)&builder->entries, &builder->entry_capacity,
+      builder->entry_count + 1, sizeof(ScanCacheEntry));
+  ScanCacheEntry *entry = &builder->entries[builder->entry_count++];
+  entry->name_offset = scan_cache_builder_add_name(builder, name, length);
+  entry->name_length = length;
+  entry->attributes = attributes;
+  builder->dirs[builder->dir_count - 1].entry_count++;
+}
+
+void scan_cache_builder_copy_dir(ScanCacheBuilder *builder,
+                                 const ScanCacheDir *dir,
+                                 const ScanCacheEntry *entries,
+                                 const char *names, unsigned int age) {
+  ScanCacheDir *copy = scan_cache_builder_add_dir(
+      builder, names + dir->path_offset, dir->path_length, dir->mtime, age);
+  copy->size = dir->size;
+  copy->packed_size = dir->packed_size;
+  copy->files = dir->files;
+  copy->large_files = dir->large_files;
+  for (unsigned int i = 0; i < dir->entry_count; i++) {
+    const ScanCacheEntry *entry = &entries[dir->entry_first + i];
+    scan_cache_builder_add_entry(builder, names + entry->name_offset,
+                                 entry->name_length, entry->attributes);
   }
-  wchar_t *wpath = char_to_wchar(normalized_path);
-  if (!wpath) {
-    printf("[警告] 无法转换路径编码: %s\n", normalized_path);
-    return;
+}
+
+void scan_cache_builder_free(ScanCacheBuilder *builder) {
+  free(builder->dirs);
+  free(builder->entries);
+  free(builder->names);
+  memset(builder, 0, sizeof(ScanCacheBuilder));
+}
+
+int scan_cache_find_slot(const unsigned int *slots, unsigned int slot_count,
+                         const ScanCacheDir *dirs, const char *names,
+                         const char *path, unsigned int length,
+                         unsigned int hash) {
+  unsigned int slot = hash & (slot_count - 1);
+  while (slots[slot]) {
+    const ScanCacheDir *dir = &dirs[slots[slot] - 1];
+    if (dir->hash == hash && dir->path_length == length &&
+        memcmp(names + dir->path_offset, path, length) == 0) {
+      return (int)slot;
+    }
+    slot = (slot + 1) & (slot_count - 1);
   }
-  DWORD attr = GetFileAttributesW(wpath);
-  if (attr == INVALID_FILE_ATTRIBUTES) {
-    if (is_directory_path) {
-      printf("  [警告] 无法访问目录，但根据路径特征识别为目录: %s\n",
-             normalized_path);
-      if (*item_count < MAX_ITEMS) {
-        strcpy_s(items[*item_count].path, MAX_PATH_LENGTH, normalized_path);
-        items[*item_count].size = 0;
-        items[*item_count].type = TYPE_DIRECTORY;
-        (*item_count)++;
-        printf("  [信息] 已添加目录到处理列表（大小未知）\n");
-      }
-    } else {
-      printf("  [信息] 路径可能为新文件: %s\n", normalized_path);
-      if (*item_count < MAX_ITEMS) {
-        strcpy_s(items[*item_count].path, MAX_PATH_LENGTH, normalized_path);
-        items[*item_count].size = 0;
-        items[*item_count].type = TYPE_FILE;
-        (*item_count)++;
-        printf("  [信息] 已添加文件到处理列表（新文件）\n");
-      }
+  return (int)slot;
+}
+
+const ScanCacheDir *scan_cache_lookup(const ScanCache *cache,
+                                      const char *path, unsigned int length,
+                                      unsigned long long mtime) {
+  if (!cache->header) {
+    return NULL;
+  }
+  unsigned int hash = hash_path(path, length);
+  int slot = scan_cache_find_slot(cache->slots, cache->header->slot_count,
+                                  cache->dirs, cache->names, path, length,
+                                  hash);
+  if (!cache->slots[slot]) {
+    return NULL;
+  }
+  const ScanCacheDir *dir = &cache->dirs[cache->slots[slot] - 1];
+  if (dir->mtime != mtime ||
+      dir->entry_first + dir->entry_count > cache->header->entry_count) {
+    return NULL;
+  }
+  return dir;
+}
+
+int scan_cache_check_subtree(ScanCacheCheck *check, unsigned int length,
+                             unsigned long long mtime, unsigned int links,
+                             const ScanCacheDir **found) {
+  const ScanCacheDir *dir =
+      scan_cache_lookup(check->cache, check->path, length, mtime);
+  if (!dir) {
+    return 0;
+  }
+  const ScanCacheEntry *entries = check->cache->entries + dir->entry_first;
+  unsigned int subdirs = 0;
+  for (unsigned int i = 0; i < dir->entry_count; i++) {
+    if (!(entries[i].attributes & FILE_ATTRIBUTE_REPARSE_POINT)) {
+      subdirs++;
     }
-    free(wpath);
-    return;
   }
-  if (attr & FILE_ATTRIBUTE_DIRECTORY) {
-    printf("  [扫描] 文件夹: %s\n", normalized_path);
-    long long dir_size =
-        calculate_directory_size_iterative(wpath, total_scanned_size);
-    *total_input_size += dir_size;
-    char size_str[32];
-    format_size(dir_size, size_str, sizeof(size_str));
-    printf("       文件夹大小: %s\n", size_str);
-    printf("       检查文件夹是否包含大文件...\n");
-    long long temp_scanned_size = 0;
-    int has_large_files =
-        directory_contains_large_files(wpath, &temp_scanned_size);
-    if (dir_size <= MAX_GROUP_SIZE && !has_large_files) {
-      printf("       文件夹大小合适且不包含大文件，直接添加...\n");
-      if (*item_count < MAX_ITEMS) {
-        strcpy_s(items[*item_count].path, MAX_PATH_LENGTH, normalized_path);
-        items[*item_count].size = dir_size;
-        items[*item_count].type = TYPE_DIRECTORY;
-        (*item_count)++;
-        printf("       已添加目录: %s\n", normalized_path);
-      }
-    } else {
-      if (dir_size > MAX_GROUP_SIZE) {
-        printf("       文件夹太大 (%s > %lld MB)，递归处理子项...\n", size_str,
-               MAX_GROUP_SIZE / (1024 * 1024));
-      }
-      if (has_large_files) {
-        printf("       文件夹包含大文件，递归处理子项...\n");
-      }
+  if (links >= 2 && links - 2 != subdirs) {
+    return 0;
+  }
+  for (unsigned int i = 0; i < dir->entry_count; i++) {
+    unsigned int child_length = length + 1 + entries[i].name_length;
+    if (child_length >= MAX_PATH_LENGTH) {
+      return 0;
     }
-    collect_items_iterative(wpath, items, item_count, total_scanned_size,
-                            skipped_files_size, result);
-  } else {
-    printf("  [扫描] 文件: %s\n", normalized_path);
-    HANDLE hFile = CreateFileW(wpath, GENERIC_READ, FILE_SHARE_READ, NULL,
-                               OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
-    if (hFile != INVALID_HANDLE_VALUE) {
-      DWORD sizeLow, sizeHigh;
-      sizeLow = GetFileSize(hFile, &sizeHigh);
-      CloseHandle(hFile);
-      ULARGE_INTEGER file_size;
-      file_size.LowPart = sizeLow;
-      file_size.HighPart = sizeHigh;
-      *total_input_size += file_size.QuadPart;
-      *total_scanned_size += file_size.QuadPart;
-      if (file_size.QuadPart > MAX_FILE_SIZE) {
-        printf("       跳过] 大文件: %s", normalized_path);
-        char size_str[32];
-        format_size(file_size.QuadPart, size_str, sizeof(size_str));
-        printf(" (%s)\n", size_str);
-        *skipped_files_size += file_size.QuadPart;
-        if (result->skipped_count < MAX_ITEMS) {
-          if (result->skipped_count >= result->skipped_capacity) {
-            int new_capacity = result->skipped_capacity == 0
-                                   ? 10
-                                   : result->skipped_capacity * 2;
-            SkippedFile *new_skipped = (SkippedFile *)safe_realloc(
-                result->skipped_files, sizeof(SkippedFile) * new_capacity);
-            result->skipped_files = new_skipped;
-            result->skipped_capacity = new_capacity;
-          }
-          strcpy_s(result->skipped_files[result->skipped_count].path,
-                   MAX_PATH_LENGTH, normalized_path);
-          result->skipped_files[result->skipped_count].size =
-              file_size.QuadPart;
-          result->skipped_count++;
-        }
-      } else {
-        if (*item_count < MAX_ITEMS) {
-          strcpy_s(items[*item_count].path, MAX_PATH_LENGTH, normalized_path);
-          items[*item_count].size = file_size.QuadPart;
-          items[*item_count].type = TYPE_FILE;
-          (*item_count)++;
-        }
-      }
-    } else {
-      printf("  [警告] 无法打开文件 %s (错误: %lu)\n", normalized_path,
-             GetLastError());
-      if (*item_count < MAX_ITEMS) {
-        strcpy_s(items[*item_count].path, MAX_PATH_LENGTH, normalized_path);
-        items[*item_count].size = 0;
-        items[*item_count].type = TYPE_FILE;
-        (*item_count)++;
-      }
+    check->path[length] = '\\';
+    memcpy(check->path + length + 1,
+           check->cache->names + entries[i].name_offset,
+           entries[i].name_length);
+    check->path[child_length] = '\0';
+    if (check->key_count >= check->key_capacity) {
+      check->key_capacity =
+          check->key_capacity == 0 ? 64 : check->key_capacity * 2;
+      check->keys = (DirectoryKey *)safe_realloc(
+          check->keys, sizeof(DirectoryKey) * check->key_capacity);
+    }
+    unsigned long long child_mtime;
+    unsigned int child_links;
+    if (!get_directory_key(check->path, &check->keys[check->key_count],
+                           &child_mtime, &child_links)) {
+      return 0;
+    }
+    check->key_count++;
+    if (!scan_cache_check_subtree(check, child_length, child_mtime,
+                                  child_links, NULL)) {
+      return 0;
     }
   }
-  free(wpath);
+  check->path[length] = '\0';
+  if (found) {
+    *found = dir;
+  }
+  return 1;
 }
 
-int compare_items(const void *a, const void *b) {
-  const FileItem *item1 = (const FileItem *)a;
-  const FileItem *item2 = (const FileItem *)b;
-  if (item1->type != item2->type) {
-    return item2->type - item1->type;
+void scan_cache_fill_totals(ScanCacheBuilder *builder, unsigned int first,
+                            const ScanEmitter *emitter, int record_count) {
+  const ScanRecord *records = emitter->records;
+  int *file_prefix = (int *)safe_malloc(sizeof(int) * (record_count + 1));
+  file_prefix[0] = 0;
+  for (int i = 0; i < record_count; i++) {
+    file_prefix[i + 1] =
+        file_prefix[i] +
+        (records[i].subtree_files ? records[i].subtree_files : 1);
   }
-  if (item1->size > item2->size)
-    return -1;
-  if (item1->size < item2->size)
-    return 1;
-  return strcmp(item1->path, item2->path);
-}
-
-int is_path_contained(const char *child_path, const char *parent_path) {
-  if (!child_path || !parent_path)
-    return 0;
-  char normalized_child[MAX_PATH_LENGTH];
-  char normalized_parent[MAX_PATH_LENGTH];
-  char parent_with_slash[MAX_PATH_LENGTH];
-  strcpy_s(normalized_child, MAX_PATH_LENGTH, child_path);
-  strcpy_s(normalized_parent, MAX_PATH_LENGTH, parent_path);
-  strcpy_s(parent_with_slash, MAX_PATH_LENGTH, parent_path);
-  normalize_path(normalized_child);
-  normalize_path(normalized_parent);
-  normalize_path(parent_with_slash);
-  size_t parent_len = strlen(parent_with_slash);
-  if (parent_len > 0 && parent_with_slash[parent_len - 1] != '\\' &&
-      parent_len < MAX_PATH_LENGTH - 1) {
-    strcat_s(parent_with_slash, MAX_PATH_LENGTH, "\\");
-  }
-  return (strcmp(normalized_child, normalized_parent) == 0) ||
-         (strstr(normalized_child, parent_with_slash) == normalized_child);
-}
-
-int is_item_contained_by_any_group(const FileItem *item,
-                                   const FileGroup *groups, int group_count) {
-  if (item->type == TYPE_FILE) {
-    for (int i = 0; i < group_count; i++) {
-      for (int j = 0; j < groups[i].count; j++) {
-        if (groups[i].items[j].type == TYPE_DIRECTORY) {
-          if (is_path_contained(item->path, groups[i].items[j].path)) {
-            return 1;
-          }
+  char prefix[MAX_PATH_LENGTH + 1];
+  for (unsigned int d = first; d < builder->dir_count; d++) {
+    ScanCacheDir *dir = &builder->dirs[d];
+    memcpy(prefix, builder->names + dir->path_offset, dir->path_length);
+    prefix[dir->path_length] = '\\';
+    prefix[dir->path_length + 1] = '\0';
+    int bounds[2];
+    for (int b = 0; b < 2; b++) {
+      int lo = 0, hi = record_count;
+      while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        if (strcmp(records[mid].path, prefix) < 0) {
+          lo = mid + 1;
+        } else {
+          hi = mid;
         }
       }
+      bounds[b] = lo;
+      prefix[dir->path_length] = '\\' + 1;
     }
+    int lo = bounds[0], hi = bounds[1];
+    dir->files = (unsigned int)(file_prefix[hi] - file_prefix[lo]);
+    dir->size = emitter->size_prefix[hi] - emitter->size_prefix[lo];
+    dir->packed_size = emitter->packed_prefix[hi] - emitter->packed_prefix[lo];
+    dir->large_files =
+        (unsigned int)(emitter->large_prefix[hi] - emitter->large_prefix[lo]);
   }
-  return 0;
+  free(file_prefix);
 }
 
-GroupResult group_files(FileItem *items, int item_count) {
-  GroupResult result = {0};
-  int initial_group_count = (item_count > 100) ? (item_count / 100) + 1 : 10;
-  result.groups =
-      (FileGroup *)safe_malloc(sizeof(FileGroup) * initial_group_count);
-  result.group_count = 0;
-  result.groups_capacity = initial_group_count;
-  printf("[处理] 正在排序 %d 个项...\n", item_count);
-  qsort(items, item_count, sizeof(FileItem), compare_items);
-  for (int i = 0; i < initial_group_count; i++) {
-    result.groups[i].items = (FileItem *)safe_malloc(sizeof(FileItem) * 10);
-    result.groups[i].count = 0;
-    result.groups[i].capacity = 10;
-    result.groups[i].total_size = 0;
+void scan_cache_open(ScanCache *cache) {
+  memset(cache, 0, sizeof(ScanCache));
+  cache->file = INVALID_HANDLE_VALUE;
+  cache->enabled = 1;
+  HANDLE file = CreateFileW(SCAN_CACHE_FILE, GENERIC_READ, FILE_SHARE_READ,
+                            NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+  if (file == INVALID_HANDLE_VALUE) {
+    return;
   }
-  printf("[处理] 开始分组处理...\n");
-  for (int i = 0; i < item_count; i++) {
-    if (items[i].type == TYPE_DIRECTORY && items[i].size <= MAX_GROUP_SIZE) {
-      int best_group = -1;
-      long long best_remaining = MAX_GROUP_SIZE;
-      for (int j = 0; j < result.group_count; j++) {
-        long long remaining = MAX_GROUP_SIZE - result.groups[j].total_size;
-        if (remaining >= items[i].size && remaining < best_remaining) {
-          best_remaining = remaining;
-          best_group = j;
-        }
-      }
-      if (best_group != -1) {
-        FileGroup *group = &result.groups[best_group];
-        if (group->count >= group->capacity) {
-          int new_capacity = group->capacity * 2;
-          FileItem *new_items = (FileItem *)safe_realloc(
-              group->items, sizeof(FileItem) * new_capacity);
-          group->items = new_items;
-          group->capacity = new_capacity;
-        }
-        group->items[group->count++] = items[i];
-        group->total_size += items[i].size;
-        printf("  添加文件夹到分组 %d: %s (%lld bytes)\n", best_group + 1,
-               items[i].path, items[i].size);
-      } else {
-        if (result.group_count >= result.groups_capacity) {
-          int new_capacity = result.groups_capacity * 2;
-          FileGroup *new_groups = (FileGroup *)safe_realloc(
-              result.groups, sizeof(FileGroup) * new_capacity);
-          for (int k = result.group_count; k < new_capacity; k++) {
-            new_groups[k].items =
-                (FileItem *)safe_malloc(sizeof(FileItem) * 10);
-            new_groups[k].count = 0;
-            new_groups[k].capacity = 10;
-            new_groups[k].total_size = 0;
-          }
-          result.groups = new_groups;
-          result.groups_capacity = new_capacity;
-        }
-        FileGroup *new_group = &result.groups[result.group_count];
-        if (new_group->count >= new_group->capacity) {
-          int new_capacity = new_group->capacity * 2;
-          FileItem *new_items = (FileItem *)safe_realloc(
-              new_group->items, sizeof(FileItem) * new_capacity);
-          new_group->items = new_items;
-          new_group->capacity = new_capacity;
-        }
-        new_group->items[new_group->count++] = items[i];
-        new_group->total_size += items[i].size;
-        result.group_count++;
-        printf("  创建新分组 %d 并添加文件夹: %s (%lld bytes)\n",
-               result.group_count, items[i].path, items[i].size);
-      }
-    }
+  LARGE_INTEGER file_size;
+  if (!GetFileSizeEx(file, &file_size) ||
+      file_size.QuadPart < (LONGLONG)sizeof(ScanCacheHeader)) {
+    CloseHandle(file);
+    return;
   }
-  for (int i = 0; i < item_count; i++) {
-    if (i % 1000 == 0 || i == item_count - 1) {
-      draw_progress_bar(i + 1, item_count, "分组进度");
-    }
-    if (items[i].type == TYPE_DIRECTORY) {
-      continue;
-    }
-    if (is_item_contained_by_any_group(&items[i], result.groups,
-                                       result.group_count)) {
-      printf("  跳过已被包含的文件: %s\n", items[i].path);
-      continue;
-    }
-    int best_group = -1;
-    long long best_remaining = MAX_GROUP_SIZE;
-    for (int j = 0; j < result.group_count; j++) {
-      long long remaining = MAX_GROUP_SIZE - result.groups[j].total_size;
-      if (remaining >= items[i].size && remaining < best_remaining) {
-        best_remaining = remaining;
-        best_group = j;
-      }
-    }
-    if (best_group != -1) {
-      FileGroup *group = &result.groups[best_group];
-      if (group->count >= group->capacity) {
-        int new_capacity = group->capacity * 2;
-        FileItem *new_items = (FileItem *)safe_realloc(
-            group->items, sizeof(FileItem) * new_capacity);
-        group->items = new_items;
-        group->capacity = new_capacity;
-      }
-      group->items[group->count++] = items[i];
-      group->total_size += items[i].size;
-    } else {
-      if (result.group_count >= result.groups_capacity) {
-        int new_capacity = result.groups_capacity * 2;
-        FileGroup *new_groups = (FileGroup *)safe_realloc(
-            result.groups, sizeof(FileGroup) * new_capacity);
-        for (int k = result.group_count; k < new_capacity; k++) {
-          new_groups[k].items = (FileItem *)safe_malloc(sizeof(FileItem) * 10);
-          new_groups[k].count = 0;
-          new_groups[k].capacity = 10;
-          new_groups[k].total_size = 0;
-        }
-        result.groups = new_groups;
-        result.groups_capacity = new_capacity;
-      }
-      FileGroup *new_group = &result.groups[result.group_count];
-      if (new_group->count >= new_group->capacity) {
-        int new_capacity = new_group->capacity * 2;
-        FileItem *new_items = (FileItem *)safe_realloc(
-            new_group->items, sizeof(FileItem) * new_capacity);
-        new_group->items = new_items;
-        new_group->capacity = new_capacity;
-      }
-      new_group->items[new_group->count++] = items[i];
-      new_group->total_size += items[i].size;
-      result.group_count++;
+  HANDLE mapping = CreateFileMappingW(file, NULL, PAGE_READONLY, 0, 0, NULL);
+  const unsigned char *view =
+      mapping ? (const unsigned char *)MapViewOfFile(mapping, FILE_MAP_READ, 0,
+                                                     0, 0)
+              : NULL;
+  if (!view) {
+    if (mapping) {
+      CloseHandle(mapping);
     }
+    CloseHandle(file);
+    return;
   }
-  printf("\n[完成] 分组完成，共 %d 个分组\n", result.group_count);
-  if (result.group_count < result.groups_capacity) {
-    result.groups = (FileGroup *)safe_realloc(
-        result.groups, sizeof(FileGroup) * result.group_count);
-    result.groups_capacity = result.group_count;
+  const ScanCacheHeader *header = (const ScanCacheHeader *)view;
+  unsigned long long expected =
+      sizeof(ScanCacheHeader) +
+      (unsigned long long)header->dir_count * sizeof(ScanCacheDir) +
+      (unsigned long long)header->slot_count * sizeof(unsigned int) +
+      (unsigned long long)header->entry_count * sizeof(ScanCacheEntry) +
+      (unsigned long long)header->name_count;
+  if (memcmp(header->magic, SCAN_CACHE_MAGIC, 8) != 0 ||
+      header->slot_count == 0 ||
+      (header->slot_count & (header->slot_count - 1)) != 0 ||
+      expected != (unsigned long long)file_size.QuadPart) {
+    printf("[警告] 扫描缓存格式无效，将重新扫描\n");
+    UnmapViewOfFile(view);
+    CloseHandle(mapping);
+    CloseHandle(file);
+    return;
   }
-  printf("[统计] 分组详情:\n");
-  for (int i = 0; i < result.group_count; i++) {
-    int file_count = 0, dir_count = 0;
-    for (int j = 0; j < result.groups[i].count; j++) {
-      if (result.groups[i].items[j].type == TYPE_FILE) {
-        file_count++;
-      } else {
-        dir_count++;
-      }
-    }
-    char size_str[32];
-    format_size(result.groups[i].total_size, size_str, sizeof(size_str));
-    printf("  分组 %d: %s (%d文件, %d文件夹)\n", i + 1, size_str, file_count,
-           dir_count);
+  if (header->estimate_pack != g_run_options.estimate_pack ||
+      header->pack_margin != g_run_options.pack_margin) {
+    printf("扫描缓存使用了不同的压缩估算设置，将重新扫描\n");
+    UnmapViewOfFile(view);
+    CloseHandle(mapping);
+    CloseHandle(file);
+    return;
   }
-  return result;
+  cache->file = file;
+  cache->mapping = mapping;
+  cache->view = view;
+  cache->header = header;
+  cache->dirs = (const ScanCacheDir *)(header + 1);
+  cache->slots = (const unsigned int *)(cache->dirs + header->dir_count);
+  cache->entries =
+      (const ScanCacheEntry *)(cache->slots + header->slot_count);
+  cache->names = (const char *)(cache->entries + header->entry_count);
+  printf("已映射扫描缓存: %u 个目录, %u 个条目\n", header->dir_count,
+         header->entry_count);
 }
 
-void print_groups(const GroupResult *result) {
-  printf("\n========================================\n");
-  printf("              分组结果\n");
-  printf("========================================\n\n");
-  int max_groups_to_show = 10;
-  int groups_to_show = result->group_count < max_groups_to_show
-                           ? result->group_count
-                           : max_groups_to_show;
-  for (int i = 0; i < groups_to_show; i++) {
-    print_detailed_group_info(&result->groups[i], i);
+void scan_cache_close_view(ScanCache *cache) {
+  if (cache->view) {
+    UnmapViewOfFile(cache->view);
+    CloseHandle(cache->mapping);
+    CloseHandle(cache->file);
   }
-  if (result->group_count > max_groups_to_show) {
-    printf("[信息] 还有 %d 个分组未显示\n\n",
-           result->group_count - max_groups_to_show);
+  cache->view = NULL;
+  cache->mapping = NULL;
+  cache->file = INVALID_HANDLE_VALUE;
+  cache->header = NULL;
+}
+
+void scan_cache_add_unique(ScanCacheBuilder *output, unsigned int *slots,
+                           unsigned int slot_count, const ScanCacheDir *dir,
+                           const ScanCacheEntry *entries,
+                           const char *names, unsigned int age) {
+  int slot = scan_cache_find_slot(slots, slot_count, output->dirs,
+                                  output->names, names + dir->path_offset,
+                                  dir->path_length, dir->hash);
+  if (slots[slot]) {
+    return;
   }
+  scan_cache_builder_copy_dir(output, dir, entries, names, age);
+  slots[slot] = output->dir_count;
 }
 
-int clear_directory(const wchar_t *wdir_path) {
-  printf("    正在清空目录内容...\n");
-  wchar_t search_path[MAX_PATH_LENGTH];
-  if (!safe_path_join(search_path, MAX_PATH_LENGTH, wdir_path, L"*")) {
-    printf("    [错误] 无法构造搜索路径\n");
-    return 0;
+void scan_cache_save(ScanCache *cache) {
+  if (!cache->enabled) {
+    return;
   }
-  WIN32_FIND_DATAW find_data;
-  HANDLE hFind = FindFirstFileW(search_path, &find_data);
-  if (hFind == INVALID_HANDLE_VALUE) {
-    return 1;
+  unsigned int old_count = cache->header ? cache->header->dir_count : 0;
+  unsigned int slot_count = 64;
+  while (slot_count < (cache->fresh.dir_count + old_count) * 2) {
+    slot_count *= 2;
   }
-  int success = 1;
-  do {
-    if (wcscmp(find_data.cFileName, L".") == 0 ||
-        wcscmp(find_data.cFileName, L"..") == 0) {
+  unsigned int *slots =
+      (unsigned int *)safe_malloc(sizeof(unsigned int) * slot_count);
+  memset(slots, 0, sizeof(unsigned int) * slot_count);
+  ScanCacheBuilder output = {0};
+  for (unsigned int i = 0; i < cache->fresh.dir_count; i++) {
+    scan_cache_add_unique(&output, slots, slot_count, &cache->fresh.dirs[i],
+                          cache->fresh.entries, cache->fresh.names, 0);
+  }
+  int carried = 0;
+  for (unsigned int i = 0; i < old_count; i++) {
+    const ScanCacheDir *dir = &cache->dirs[i];
+    if (dir->age + 1 >= SCAN_CACHE_MAX_AGE ||
+        dir->entry_first + dir->entry_count > cache->header->entry_count) {
       continue;
     }
-    wchar_t full_path[MAX_PATH_LENGTH];
-    if (!safe_path_join(full_path, MAX_PATH_LENGTH, wdir_path,
-                        find_data.cFileName)) {
-      success = 0;
-      continue;
+    unsigned int before = output.dir_count;
+    scan_cache_add_unique(&output, slots, slot_count, dir, cache->entries,
+                          cache->names, dir->age + 1);
+    carried += output.dir_count - before;
+  }
+  scan_cache_close_view(cache);
+  ScanCacheHeader header = {0};
+  memcpy(header.magic, SCAN_CACHE_MAGIC, 8);
+  header.dir_count = output.dir_count;
+  header.slot_count = slot_count;
+  header.entry_count = output.entry_count;
+  header.name_count = output.name_count;
+  header.estimate_pack = g_run_options.estimate_pack;
+  header.pack_margin = g_run_options.pack_margin;
+  wchar_t temp_path[MAX_PATH_LENGTH];
+  _snwprintf_s(temp_path, _countof(temp_path), _TRUNCATE, L"%ls.tmp",
+               SCAN_CACHE_FILE);
+  FILE *file = _wfopen(temp_path, L"wb");
+  int ok = file != NULL;
+  if (file) {
+    ok = fwrite(&header, sizeof(header), 1, file) == 1;
+    ok = ok && fwrite(output.dirs, sizeof(ScanCacheDir), output.dir_count,
+                      file) == output.dir_count;
+    ok = ok && fwrite(slots, sizeof(unsigned int), slot_count, file) ==
+                   slot_count;
+    ok = ok && fwrite(output.entries, sizeof(ScanCacheEntry),
+                      output.entry_count, file) == output.entry_count;
+    ok = ok && fwrite(output.names, sizeof(char), output.name_count,
+                      file) == output.name_count;
+    ok = fclose(file) == 0 && ok;
+  }
+  if (ok && MoveFileExW(temp_path, SCAN_CACHE_FILE,
+                        MOVEFILE_REPLACE_EXISTING)) {
+    printf("已保存扫描缓存: %u 个目录 (沿用未访问目录 %d 个)\n",
+           output.dir_count, carried);
+  } else {
+    printf("[警告] 无法写入扫描缓存\n");
+    _wremove(temp_path);
+  }
+  free(slots);
+  scan_cache_builder_free(&output);
+  scan_cache_builder_free(&cache->fresh);
+  cache->enabled = 0;
+}
+
+size_t build_node_path(const DirNode *node, char *buffer, size_t buffer_size) {
+  size_t length = 0;
+  for (const DirNode *n = node; n; n = n->parent) {
+    length += n->name_length + (n->parent ? 1 : 0);
+  }
+  if (length + 1 > buffer_size) {
+    return 0;
+  }
+  size_t pos = length;
+  buffer[pos] = '\0';
+  for (const DirNode *n = node; n; n = n->parent) {
+    pos -= n->name_length;
+    memcpy(buffer + pos, n->name, n->name_length);
+    if (n->parent) {
+      buffer[--pos] = '\\';
     }
-    if (find_data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) {
-      if (!clear_directory(full_path)) {
-        success = 0;
-      }
-      if (!RemoveDirectoryW(full_path)) {
-        DWORD error = GetLastError();
-        printf("    [警告] 无法删除目录 %ls (错误: %lu)\n", find_data.cFileName,
-               error);
-        success = 0;
-      }
-    } else {
-      if (!DeleteFileW(full_path)) {
-        DWORD error = GetLastError();
-        printf("    [警告] 无法删除文件 %ls (错误: %lu)\n", find_data.cFileName,
-               error);
-        success = 0;
-      }
+  }
+  return length;
+}
+
+void walk_push_task(ParallelWalker *walker, WalkWorker *worker,
+                    const DirNode *parent, const char *name,
+                    int name_length) {
+  DirNode *node = (DirNode *)arena_alloc(&worker->arena, sizeof(DirNode));
+  char *name_copy = (char *)arena_alloc(&worker->arena, name_length + 1);
+  memcpy(name_copy, name, name_length);
+  name_copy[name_length] = '\0';
+  node->parent = parent;
+  node->name = name_copy;
+  node->name_length = name_length;
+  node->depth = parent ? parent->depth + 1 : 0;
+  InterlockedIncrement(&walker->pending);
+  walk_deque_push(&walker->deques[worker->index], node);
+}
+
+void walk_visit_entry(WalkWorker *worker, const DirNode *task,
+                      const char *dir_path, size_t dir_length,
+                      const char *name, size_t name_length,
+                      const WIN32_FIND_DATAW *find_data) {
+  ParallelWalker *walker = worker->walker;
+  worker->entries_scanned++;
+  size_t length = dir_length + 1 + name_length;
+  if (length >= MAX_PATH_LENGTH) {
+    return;
+  }
+  char full_path[MAX_PATH_LENGTH];
+  memcpy(full_path, dir_path, dir_length);
+  full_path[dir_length] = '\\';
+  memcpy(full_path + dir_length + 1, name, name_length);
+  full_path[length] = '\0';
+  int descend = walker->on_entry(walker->context, worker->index, full_path,
+                                 length, find_data);
+  if ((find_data->dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) && descend &&
+      task->depth < walker->max_depth) {
+    if (worker->recording) {
+      scan_cache_builder_add_entry(&worker->cache_builder, name,
+                                   (unsigned int)name_length,
+                                   find_data->dwFileAttributes);
     }
-  } while (FindNextFileW(hFind, &find_data));
-  FindClose(hFind);
-  return success;
+    walk_push_task(walker, worker, task, name, (int)name_length);
+  }
 }
 
-int split_large_file(const char *file_path, const char *split_dir,
-                     long long file_size) {
-  printf("    正在处理大文件拆分...\n");
-  if (is_split_complete(file_path, split_dir, file_size)) {
-    printf("    [信息] 拆分目录已存在且完整，跳过拆分步骤\n");
+int walk_skip_cached_subtree(WalkWorker *worker, const char *path,
+                             unsigned int length, unsigned long long mtime,
+                             unsigned int links) {
+  ParallelWalker *walker = worker->walker;
+  const ScanCacheDir *dir = scan_cache_lookup(walker->cache, path, length,
+                                              mtime);
+  if (!walker->on_subtree || !dir || dir->large_files > 0 ||
+      dir->packed_size > MAX_GROUP_SIZE) {
+    return 0;
+  }
+  ScanCacheCheck check;
+  check.cache = walker->cache;
+  check.keys = NULL;
+  check.key_count = 0;
+  check.key_capacity = 0;
+  memcpy(check.path, path, length + 1);
+  int valid = scan_cache_check_subtree(&check, length, mtime, links, &dir);
+  if (valid) {
+    for (int i = 0; i < check.key_count; i++) {
+      visited_set_insert(walker->visited, &check.keys[i]);
+    }
+    walker->on_subtree(walker->context, worker->index, path, length, dir);
+    worker->subtrees_cached++;
+    worker->directories_cached += 1 + check.key_count;
+  }
+  free(check.keys);
+  return valid;
+}
+
+const char *scan_backend_name(ScanBackend backend) {
+  switch (backend) {
+  case SCAN_BACKEND_GETDENTS:
+    return "getdents";
+  case SCAN_BACKEND_URING:
+    return "uring";
+  default:
+    return "find";
+  }
+}
+
+double scan_entries_per_second(const ScanStats *stats) {
+  return stats->elapsed_seconds > 0
+             ? stats->entries_scanned / stats->elapsed_seconds
+             : 0.0;
+}
+
+int parse_scan_backend(const char *name, ScanBackend *backend) {
+  if (strcmp(name, "find") == 0) {
+    *backend = SCAN_BACKEND_FIND;
     return 1;
   }
-  wchar_t *wfile_path = char_to_wchar(file_path);
-  wchar_t *wsplit_dir = char_to_wchar(split_dir);
-  if (!wfile_path || !wsplit_dir) {
-    printf("    [错误] 无法转换路径编码\n");
-    if (wfile_path)
-      free(wfile_path);
-    if (wsplit_dir)
-      free(wsplit_dir);
-    return 0;
+#ifndef _WIN32
+  if (strcmp(name, "getdents") == 0) {
+    *backend = SCAN_BACKEND_GETDENTS;
+    return 1;
   }
-  DWORD source_attr = GetFileAttributesW(wfile_path);
-  if (source_attr == INVALID_FILE_ATTRIBUTES) {
-    DWORD error = GetLastError();
-    printf("    [错误] 源文件无法访问: %s (错误: %lu)\n", file_path, error);
-    free(wfile_path);
-    free(wsplit_dir);
+  if (strcmp(name, "uring") == 0) {
+    *backend = SCAN_BACKEND_URING;
+    return 1;
+  }
+#endif
+  return 0;
+}
+
+#ifndef _WIN32
+int linux_entry_info(int dir_fd, const char *name, unsigned char type,
+                     WIN32_FIND_DATAW *find_data) {
+  memset(&find_data->ftLastWriteTime, 0, sizeof(FILETIME));
+  find_data->nFileSizeLow = 0;
+  find_data->nFileSizeHigh = 0;
+  if (type == DT_DIR) {
+    find_data->dwFileAttributes = FILE_ATTRIBUTE_DIRECTORY;
+    return 1;
+  }
+  struct timespec mtime;
+  mode_t mode;
+  long long size;
+#ifdef STATX_BASIC_STATS
+  struct statx stx;
+  if (statx(dir_fd, name, AT_SYMLINK_NOFOLLOW | AT_NO_AUTOMOUNT,
+            STATX_TYPE | STATX_SIZE | STATX_MTIME, &stx) != 0) {
     return 0;
   }
-  if (source_attr & FILE_ATTRIBUTE_DIRECTORY) {
-    printf("    [错误] 源路径是目录而不是文件: %s\n", file_path);
-    free(wfile_path);
-    free(wsplit_dir);
+  mode = stx.stx_mode;
+  size = (long long)stx.stx_size;
+  mtime.tv_sec = stx.stx_mtime.tv_sec;
+  mtime.tv_nsec = stx.stx_mtime.tv_nsec;
+#else
+  struct stat st;
+  if (fstatat(dir_fd, name, &st, AT_SYMLINK_NOFOLLOW) != 0) {
     return 0;
   }
-  DWORD dir_attr = GetFileAttributesW(wsplit_dir);
-  if (dir_attr != INVALID_FILE_ATTRIBUTES &&
-      (dir_attr & FILE_ATTRIBUTE_DIRECTORY)) {
-    printf("    拆分目录已存在但不完整，正在清空...\n");
-    if (!clear_directory(wsplit_dir)) {
-      printf("    [警告] 清空拆分目录失败，继续尝试拆分...\n");
-    } else {
-      printf("    [成功] 拆分目录已清空\n");
-    }
+  mode = st.st_mode;
+  size = (long long)st.st_size;
+  mtime = st.st_mtim;
+#endif
+  linux_fill_find_data(dir_fd, name, mode, size, &mtime, find_data);
+  return 1;
+}
+
+void linux_fill_find_data(int dir_fd, const char *name, mode_t mode,
+                          long long size, const struct timespec *mtime,
+                          WIN32_FIND_DATAW *find_data) {
+  struct stat target;
+  if (S_ISLNK(mode) && fstatat(dir_fd, name, &target, 0) == 0 &&
+      S_ISDIR(target.st_mode)) {
+    find_data->dwFileAttributes =
+        FILE_ATTRIBUTE_DIRECTORY | FILE_ATTRIBUTE_REPARSE_POINT;
+    size = 0;
+  } else if (S_ISLNK(mode)) {
+    find_data->dwFileAttributes =
+        FILE_ATTRIBUTE_NORMAL | FILE_ATTRIBUTE_REPARSE_POINT;
+  } else if (S_ISDIR(mode)) {
+    find_data->dwFileAttributes = FILE_ATTRIBUTE_DIRECTORY;
+    size = 0;
   } else {
-    if (!create_directory_recursive(wsplit_dir)) {
-      printf("    [错误] 无法创建拆分目录\n");
-      free(wfile_path);
-      free(wsplit_dir);
-      return 0;
-    }
+    find_data->dwFileAttributes = FILE_ATTRIBUTE_NORMAL;
   }
-  HANDLE hSource = CreateFileW(wfile_path, GENERIC_READ, FILE_SHARE_READ, NULL,
-                               OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
-  if (hSource == INVALID_HANDLE_VALUE) {
-    DWORD error = GetLastError();
-    printf("    [错误] 无法打开源文件 (错误: %lu)\n", error);
-    free(wfile_path);
-    free(wsplit_dir);
-    return 0;
+  find_data->nFileSizeLow = (DWORD)(size & 0xFFFFFFFF);
+  find_data->nFileSizeHigh = (DWORD)(size >> 32);
+  compat_filetime(mtime, &find_data->ftLastWriteTime);
+}
+
+void walk_emit_linux_entry(WalkWorker *worker, const DirNode *task,
+                           const char *dir_path, size_t dir_length,
+                           const char *name, WIN32_FIND_DATAW *find_data) {
+  walk_visit_entry(worker, task, dir_path, dir_length, name, strlen(name),
+                   find_data);
+}
+
+int walk_open_directory(const char *dir_path, size_t dir_length) {
+  char path[MAX_PATH_LENGTH];
+  for (size_t i = 0; i <= dir_length; i++) {
+    path[i] = dir_path[i] == '\\' ? '/' : dir_path[i];
   }
-  const long long PART_SIZE = 50 * 1024 * 1024;
-  int total_parts = (int)((file_size + PART_SIZE - 1) / PART_SIZE);
-  printf("    文件大小: %lld bytes, 需要拆分成 %d 个部分\n", file_size,
-         total_parts);
-  int success_parts = 0;
-  BYTE *buffer = (BYTE *)safe_malloc((size_t)PART_SIZE);
-  for (int part_num = 1; part_num <= total_parts; part_num++) {
-    long long part_size = PART_SIZE;
-    if (part_num == total_parts) {
-      part_size = file_size - (PART_SIZE * (total_parts - 1));
-    }
-    char part_filename[MAX_PATH_LENGTH];
-    const char *filename = strrchr(file_path, '\\');
-    if (!filename) {
-      filename = strrchr(file_path, '/');
-    }
-    if (filename) {
-      filename++;
-    } else {
-      filename = file_path;
-    }
-    char file_base[MAX_PATH_LENGTH] = {0};
-    char file_ext[MAX_PATH_LENGTH] = {0};
-    char *dot_pos = strrchr(filename, '.');
-    if (dot_pos && dot_pos != filename) {
-      size_t base_len = dot_pos - filename;
-      strncpy_s(file_base, MAX_PATH_LENGTH, filename, base_len);
-      file_base[base_len] = '\0';
-      strcpy_s(file_ext, MAX_PATH_LENGTH, dot_pos);
-    } else {
-      strcpy_s(file_base, MAX_PATH_LENGTH, filename);
-      file_ext[0] = '\0';
-    }
-    snprintf(part_filename, MAX_PATH_LENGTH, "%s\\%s-part%04d%s", split_dir,
-             file_base, part_num, file_ext);
-    wchar_t *wpart_filename = char_to_wchar(part_filename);
-    if (!wpart_filename) {
-      printf("    [错误] 无法转换部分文件路径编码: %s\n", part_filename);
-      continue;
-    }
-    HANDLE hTarget = CreateFileW(wpart_filename, GENERIC_WRITE, 0, NULL,
-                                 CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
-    if (hTarget == INVALID_HANDLE_VALUE) {
-      DWORD error = GetLastError();
-      printf("    [错误] 无法创建部分文件 %s (错误: %lu)\n", part_filename,
-             error);
-      free(wpart_filename);
-      continue;
-    }
-    DWORD bytes_read, bytes_written;
-    long long remaining = part_size;
-    int write_success = 1;
-    while (remaining > 0) {
-      DWORD to_read = (DWORD)((remaining > PART_SIZE) ? PART_SIZE : remaining);
-      if (!ReadFile(hSource, buffer, to_read, &bytes_read, NULL) ||
-          bytes_read == 0) {
-        printf("    [错误] 读取源文件失败\n");
-        write_success = 0;
-        break;
+  return open(path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+}
+
+void walk_read_directory_getdents(WalkWorker *worker, const DirNode *task,
+                                  const char *dir_path, size_t dir_length) {
+  int dir_fd = walk_open_directory(dir_path, dir_length);
+  if (dir_fd < 0) {
+    return;
+  }
+  worker->directories_scanned++;
+  unsigned long long buffer[GETDENTS_BUFFER_SIZE / sizeof(unsigned long long)];
+  WIN32_FIND_DATAW find_data;
+  long bytes;
+  while ((bytes = syscall(SYS_getdents64, dir_fd, buffer, sizeof(buffer))) >
+         0) {
+    for (long offset = 0; offset < bytes;) {
+      const LinuxDirent64 *entry =
+          (const LinuxDirent64 *)((const char *)buffer + offset);
+      offset += entry->d_reclen;
+      if (strcmp(entry->d_name, ".") == 0 ||
+          strcmp(entry->d_name, "..") == 0) {
+        continue;
       }
-      if (!WriteFile(hTarget, buffer, bytes_read, &bytes_written, NULL) ||
-          bytes_written != bytes_read) {
-        printf("    [错误] 写入部分文件失败\n");
-        write_success = 0;
-        break;
+      if (linux_entry_info(dir_fd, entry->d_name, entry->d_type,
+                           &find_data)) {
+        walk_emit_linux_entry(worker, task, dir_path, dir_length,
+                              entry->d_name, &find_data);
       }
-      remaining -= bytes_read;
     }
-    CloseHandle(hTarget);
-    free(wpart_filename);
-    if (write_success) {
-      success_parts++;
-      printf("    [成功] 创建部分文件: %s (%lld bytes)\n", part_filename,
-             part_size);
-    } else {
-      printf("    [失败] 创建部分文件失败: %s\n", part_filename);
+  }
+  close(dir_fd);
+}
+
+StatxRing *statx_ring_create(unsigned int entries) {
+  struct io_uring_params params;
+  memset(&params, 0, sizeof(params));
+  int fd = (int)syscall(__NR_io_uring_setup, entries, &params);
+  if (fd < 0) {
+    return NULL;
+  }
+  StatxRing *ring = (StatxRing *)safe_malloc(sizeof(StatxRing));
+  memset(ring, 0, sizeof(StatxRing));
+  ring->fd = fd;
+  ring->capacity = params.sq_entries;
+  ring->sq_map_size =
+      params.sq_off.array + params.sq_entries * sizeof(unsigned int);
+  ring->cq_map_size =
+      params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+  ring->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+  ring->sq_map = mmap(NULL, ring->sq_map_size, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+  ring->cq_map = mmap(NULL, ring->cq_map_size, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+  ring->sqes = (struct io_uring_sqe *)mmap(NULL, ring->sqes_size,
+                                           PROT_READ | PROT_WRITE,
+                                           MAP_SHARED | MAP_POPULATE, fd,
+                                           IORING_OFF_SQES);
+  if (ring->sq_map == MAP_FAILED || ring->cq_map == MAP_FAILED ||
+      ring->sqes == MAP_FAILED) {
+    statx_ring_destroy(ring);
+    return NULL;
+  }
+  char *sq = (char *)ring->sq_map;
+  char *cq = (char *)ring->cq_map;
+  ring->sq_tail = (unsigned int *)(sq + params.sq_off.tail);
+  ring->sq_mask = (unsigned int *)(sq + params.sq_off.ring_mask);
+  ring->sq_array = (unsigned int *)(sq + params.sq_off.array);
+  ring->cq_head = (unsigned int *)(cq + params.cq_off.head);
+  ring->cq_tail = (unsigned int *)(cq + params.cq_off.tail);
+  ring->cq_mask = (unsigned int *)(cq + params.cq_off.ring_mask);
+  ring->cqes = (struct io_uring_cqe *)(cq + params.cq_off.cqes);
+  ring->names = (const char **)safe_malloc(sizeof(char *) * ring->capacity);
+  ring->results =
+      (struct statx *)safe_malloc(sizeof(struct statx) * ring->capacity);
+  ring->done = (unsigned char *)safe_malloc(ring->capacity);
+  return ring;
+}
+
+void statx_ring_destroy(StatxRing *ring) {
+  if (!ring) {
+    return;
+  }
+  if (ring->sqes && ring->sqes != MAP_FAILED) {
+    munmap(ring->sqes, ring->sqes_size);
+  }
+  if (ring->cq_map && ring->cq_map != MAP_FAILED) {
+    munmap(ring->cq_map, ring->cq_map_size);
+  }
+  if (ring->sq_map && ring->sq_map != MAP_FAILED) {
+    munmap(ring->sq_map, ring->sq_map_size);
+  }
+  close(ring->fd);
+  free(ring->names);
+  free(ring->results);
+  free(ring->done);
+  free(ring);
+}
+
+void statx_ring_prepare(StatxRing *ring, int dir_fd, unsigned int slot) {
+  unsigned int tail = *ring->sq_tail;
+  unsigned int index = tail & *ring->sq_mask;
+  struct io_uring_sqe *sqe = &ring->sqes[index];
+  memset(sqe, 0, sizeof(*sqe));
+  sqe->opcode = IORING_OP_STATX;
+  sqe->fd = dir_fd;
+  sqe->addr = (unsigned long long)(uintptr_t)ring->names[slot];
+  sqe->len = STATX_TYPE | STATX_SIZE | STATX_MTIME;
+  sqe->off = (unsigned long long)(uintptr_t)&ring->results[slot];
+  sqe->statx_flags = AT_SYMLINK_NOFOLLOW | AT_NO_AUTOMOUNT;
+  sqe->user_data = slot;
+  ring->sq_array[index] = index;
+  ring->done[slot] = 0;
+  __atomic_store_n(ring->sq_tail, tail + 1, __ATOMIC_RELEASE);
+}
+
+unsigned int statx_ring_submit(StatxRing *ring, unsigned int count) {
+  unsigned int submitted = 0;
+  while (submitted < count) {
+    long result = syscall(__NR_io_uring_enter, ring->fd, count - submitted,
+                          0, 0, NULL, 0);
+    if (result < 0 && errno == EINTR) {
+      continue;
     }
+    if (result <= 0) {
+      break;
+    }
+    submitted += (unsigned int)result;
   }
-  free(buffer);
-  CloseHandle(hSource);
-  if (success_parts == total_parts) {
-    printf("    [成功] 文件拆分完成，共 %d 个部分\n", total_parts);
-    if (is_split_complete(file_path, split_dir, file_size)) {
-      printf("    [验证] 拆分完整性验证通过\n");
-      printf("    [信息] 拆分完成，原文件将在备份后被删除\n");
-      free(wfile_path);
-      free(wsplit_dir);
+  return submitted;
+}
+
+int statx_ring_reap(StatxRing *ring, unsigned int *slot, int *result) {
+  for (;;) {
+    unsigned int head = *ring->cq_head;
+    if (head != __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE)) {
+      const struct io_uring_cqe *cqe = &ring->cqes[head & *ring->cq_mask];
+      *slot = (unsigned int)cqe->user_data;
+      *result = cqe->res;
+      __atomic_store_n(ring->cq_head, head + 1, __ATOMIC_RELEASE);
       return 1;
-    } else {
-      printf("    [警告] 拆分完整性验证失败\n");
-      free(wfile_path);
-      free(wsplit_dir);
+    }
+    if (syscall(__NR_io_uring_enter, ring->fd, 0, 1, IORING_ENTER_GETEVENTS,
+                NULL, 0) < 0 &&
+        errno != EINTR) {
       return 0;
     }
-  } else {
-    printf("    [警告] 文件拆分部分成功: %d/%d 个部分\n", success_parts,
-           total_parts);
-    free(wfile_path);
-    free(wsplit_dir);
-    return 0;
   }
 }
 
-int is_split_complete(const char *file_path, const char *split_dir,
-                      long long file_size) {
-  wchar_t *wsplit_dir = char_to_wchar(split_dir);
-  if (!wsplit_dir)
-    return 0;
-  DWORD attr = GetFileAttributesW(wsplit_dir);
-  if (attr == INVALID_FILE_ATTRIBUTES || !(attr & FILE_ATTRIBUTE_DIRECTORY)) {
-    printf("    拆分目录不存在: %s\n", split_dir);
-    free(wsplit_dir);
+int uring_backend_available(void) {
+  StatxRing *ring = statx_ring_create(1);
+  if (!ring) {
     return 0;
   }
-  long long split_total_size = 0;
-  int part_count = 0;
-  wchar_t search_path[MAX_PATH_LENGTH];
-  if (!safe_path_join(search_path, MAX_PATH_LENGTH, wsplit_dir, L"*")) {
-    free(wsplit_dir);
-    return 0;
+  unsigned int slot;
+  int result = -1;
+  ring->names[0] = ".";
+  statx_ring_prepare(ring, AT_FDCWD, 0);
+  int available = statx_ring_submit(ring, 1) == 1 &&
+                  statx_ring_reap(ring, &slot, &result) && result == 0;
+  statx_ring_destroy(ring);
+  return available;
+}
+
+void walk_reap_statx_batch(WalkWorker *worker, const DirNode *task,
+                           const char *dir_path, size_t dir_length,
+                           int dir_fd, unsigned int count) {
+  StatxRing *ring = worker->statx_ring;
+  WIN32_FIND_DATAW find_data;
+  unsigned int submitted = statx_ring_submit(ring, count);
+  unsigned int reaped = 0, slot;
+  int result;
+  while (reaped < submitted && statx_ring_reap(ring, &slot, &result)) {
+    reaped++;
+    ring->done[slot] = 1;
+    if (result < 0) {
+      continue;
+    }
+    const struct statx *stx = &ring->results[slot];
+    struct timespec mtime = {(time_t)stx->stx_mtime.tv_sec,
+                             (long)stx->stx_mtime.tv_nsec};
+    linux_fill_find_data(dir_fd, ring->names[slot], stx->stx_mode,
+                         (long long)stx->stx_size, &mtime, &find_data);
+    walk_emit_linux_entry(worker, task, dir_path, dir_length,
+                          ring->names[slot], &find_data);
+  }
+  if (reaped == count) {
+    return;
+  }
+  worker->statx_ring_failed = 1;
+  for (slot = 0; slot < count; slot++) {
+    if (!ring->done[slot] &&
+        linux_entry_info(dir_fd, ring->names[slot], DT_UNKNOWN, &find_data)) {
+      walk_emit_linux_entry(worker, task, dir_path, dir_length,
+                            ring->names[slot], &find_data);
+    }
+  }
+}
+
+void walk_read_directory_uring(WalkWorker *worker, const DirNode *task,
+                               const char *dir_path, size_t dir_length) {
+  if (!worker->statx_ring && !worker->statx_ring_failed) {
+    worker->statx_ring = statx_ring_create(STATX_RING_ENTRIES);
+    worker->statx_ring_failed = worker->statx_ring == NULL;
   }
+  if (worker->statx_ring_failed) {
+    walk_read_directory_getdents(worker, task, dir_path, dir_length);
+    return;
+  }
+  StatxRing *ring = worker->statx_ring;
+  int dir_fd = walk_open_directory(dir_path, dir_length);
+  if (dir_fd < 0) {
+    return;
+  }
+  worker->directories_scanned++;
+  unsigned long long buffer[GETDENTS_BUFFER_SIZE / sizeof(unsigned long long)];
   WIN32_FIND_DATAW find_data;
-  HANDLE hFind = FindFirstFileW(search_path, &find_data);
-  if (hFind != INVALID_HANDLE_VALUE) {
-    do {
-      if (wcscmp(find_data.cFileName, L".") == 0 ||
-          wcscmp(find_data.cFileName, L"..") == 0) {
+  long bytes;
+  while ((bytes = syscall(SYS_getdents64, dir_fd, buffer, sizeof(buffer))) >
+         0) {
+    unsigned int pending = 0;
+    for (long offset = 0; offset < bytes;) {
+      const LinuxDirent64 *entry =
+          (const LinuxDirent64 *)((const char *)buffer + offset);
+      offset += entry->d_reclen;
+      if (strcmp(entry->d_name, ".") == 0 ||
+          strcmp(entry->d_name, "..") == 0) {
         continue;
       }
-      if (!(find_data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)) {
-        ULARGE_INTEGER part_size;
-        part_size.LowPart = find_data.nFileSizeLow;
-        part_size.HighPart = find_data.nFileSizeHigh;
-        split_total_size += part_size.QuadPart;
-        part_count++;
-        char *part_filename = wchar_to_char(find_data.cFileName);
-        if (part_filename) {
-          printf("      找到拆分文件: %s (%llu bytes)\n", part_filename,
-                 part_size.QuadPart);
-          free(part_filename);
+      if (entry->d_type == DT_DIR || worker->statx_ring_failed) {
+        if (linux_entry_info(dir_fd, entry->d_name, entry->d_type,
+                             &find_data)) {
+          walk_emit_linux_entry(worker, task, dir_path, dir_length,
+                                entry->d_name, &find_data);
         }
+        continue;
       }
-    } while (FindNextFileW(hFind, &find_data));
-    FindClose(hFind);
-  }
-  free(wsplit_dir);
-  if (part_count == 0) {
-    printf("    拆分目录为空: %s\n", split_dir);
-    return 0;
-  }
-  long long size_difference = llabs(split_total_size - file_size);
-  double difference_ratio = (double)size_difference / file_size;
-  printf("    拆分检查: 原文件 %lld bytes, 拆分文件 %lld bytes (共%d个文件), "
-         "差异 %.4f%%\n",
-         file_size, split_total_size, part_count, difference_ratio * 100);
-  if (size_difference > 1024) {
-    printf("    文件大小不匹配，需要重新拆分\n");
-    return 0;
+      ring->names[pending] = entry->d_name;
+      statx_ring_prepare(ring, dir_fd, pending);
+      if (++pending == ring->capacity) {
+        walk_reap_statx_batch(worker, task, dir_path, dir_length, dir_fd,
+                              pending);
+        pending = 0;
+      }
+    }
+    if (pending > 0) {
+      walk_reap_statx_batch(worker, task, dir_path, dir_length, dir_fd,
+                            pending);
+    }
   }
-  printf("    拆分目录完整，跳过拆分步骤\n");
-  return 1;
+  close(dir_fd);
 }
+#endif
 
-int delete_original_file(const char *file_path) {
-  if (!file_path || strlen(file_path) == 0) {
-    printf("    [错误] 文件路径为空\n");
-    return 0;
+void walk_process_directory(WalkWorker *worker, const DirNode *task) {
+  ParallelWalker *walker = worker->walker;
+  char dir_path[MAX_PATH_LENGTH];
+  size_t dir_length = build_node_path(task, dir_path, MAX_PATH_LENGTH - 2);
+  if (dir_length == 0) {
+    return;
   }
-  printf("    [调试] 准备删除文件: %s\n", file_path);
-  wchar_t *wfile_path = char_to_wchar(file_path);
-  if (!wfile_path) {
-    printf("    [错误] 无法转换文件路径编码: %s\n", file_path);
-    return 0;
+  unsigned long long mtime = 0;
+  unsigned int links = 0;
+  int has_mtime = 0;
+  if (walker->visited) {
+    DirectoryKey key;
+    if (get_directory_key(dir_path, &key, &mtime, &links)) {
+      has_mtime = 1;
+      if (!visited_set_insert(walker->visited, &key)) {
+        worker->cycles_skipped++;
+        return;
+      }
+    }
   }
-  DWORD attr = GetFileAttributesW(wfile_path);
-  if (attr == INVALID_FILE_ATTRIBUTES) {
-    DWORD error = GetLastError();
-    if (error == ERROR_FILE_NOT_FOUND || error == ERROR_PATH_NOT_FOUND) {
-      printf("    [信息] 文件已不存在: %s\n", file_path);
-      free(wfile_path);
-      return 1;
-    } else {
-      printf("    [错误] 无法访问文件 %s (错误: %lu)\n", file_path, error);
-      free(wfile_path);
-      return 0;
+  worker->recording = 0;
+  if (walker->cache && has_mtime) {
+    char cache_path[MAX_PATH_LENGTH];
+    memcpy(cache_path, dir_path, dir_length + 1);
+    normalize_path(cache_path);
+    unsigned int cache_length = (unsigned int)strlen(cache_path);
+    if (walk_skip_cached_subtree(worker, cache_path, cache_length, mtime,
+                                 links)) {
+      return;
     }
+    scan_cache_builder_add_dir(&worker->cache_builder, cache_path,
+                               cache_length, mtime, 0);
+    worker->recording = 1;
   }
-  if (attr & FILE_ATTRIBUTE_DIRECTORY) {
-    printf("    [错误] 路径是目录而不是文件: %s\n", file_path);
-    free(wfile_path);
-    return 0;
+#ifndef _WIN32
+  if (g_run_options.scan_backend == SCAN_BACKEND_GETDENTS) {
+    walk_read_directory_getdents(worker, task, dir_path, dir_length);
+    return;
   }
-  if (DeleteFileW(wfile_path)) {
-    printf("    [成功] 文件删除成功: %s\n", file_path);
-    free(wfile_path);
-    return 1;
-  } else {
-    DWORD error = GetLastError();
-    printf("    [错误] 无法删除文件 %s (错误: %lu)\n", file_path, error);
-    switch (error) {
-    case ERROR_FILE_NOT_FOUND:
-      printf("        文件不存在\n");
-      break;
-    case ERROR_ACCESS_DENIED:
-      printf("        访问被拒绝，文件可能正在被使用或没有权限\n");
-      break;
-    case ERROR_SHARING_VIOLATION:
-      printf("        文件正在被其他进程使用\n");
-      break;
-    default:
-      printf("        未知错误\n");
+  if (g_run_options.scan_backend == SCAN_BACKEND_URING) {
+    walk_read_directory_uring(worker, task, dir_path, dir_length);
+    return;
+  }
+#endif
+  memcpy(dir_path + dir_length, "\\*", 3);
+  const wchar_t *search_path = path_to_wide(dir_path, 0);
+  dir_path[dir_length] = '\0';
+  if (!search_path) {
+    return;
+  }
+  WIN32_FIND_DATAW find_data;
+  HANDLE hFind =
+      FindFirstFileExW(search_path, FindExInfoBasic, &find_data,
+                       FindExSearchNameMatch, NULL, FIND_FIRST_EX_LARGE_FETCH);
+  if (hFind == INVALID_HANDLE_VALUE) {
+    return;
+  }
+  worker->directories_scanned++;
+  char name[MAX_PATH * 3];
+  do {
+    if (wcscmp(find_data.cFileName, L".") == 0 ||
+        wcscmp(find_data.cFileName, L"..") == 0) {
+      continue;
+    }
+    int name_length = path_from_wide(name, sizeof(name), find_data.cFileName);
+    if (name_length <= 0) {
+      continue;
+    }
+    walk_visit_entry(worker, task, dir_path, dir_length, name, name_length,
+                     &find_data);
+  } while (FindNextFileW(hFind, &find_data));
+  FindClose(hFind);
+}
+
+DWORD WINAPI walk_worker_main(LPVOID param) {
+  WalkWorker *worker = (WalkWorker *)param;
+  ParallelWalker *walker = worker->walker;
+  int idle_rounds = 0;
+  DirNode *task;
+  for (;;) {
+    int found = walk_deque_pop(&walker->deques[worker->index], &task);
+    for (int i = 1; !found && i < walker->thread_count; i++) {
+      int victim = (worker->index + i) % walker->thread_count;
+      found = walk_deque_steal(&walker->deques[victim], &task);
+    }
+    if (found) {
+      idle_rounds = 0;
+      walk_process_directory(worker, task);
+      InterlockedDecrement(&walker->pending);
+      continue;
+    }
+    if (InterlockedCompareExchange(&walker->pending, 0, 0) == 0) {
       break;
     }
-    free(wfile_path);
-    return 0;
+    if (++idle_rounds < 64) {
+      SwitchToThread();
+    } else {
+      Sleep(1);
+    }
   }
+  return 0;
 }
 
-AdditionalFiles print_skipped_files(GroupResult *result) {
-  AdditionalFiles additional = {0};
-  additional.gitignore_files = (char **)safe_malloc(sizeof(char *) * MAX_ITEMS);
-  additional.split_files = (char **)safe_malloc(sizeof(char *) * MAX_ITEMS);
-  if (result->skipped_count == 0) {
-    printf("\n[信息] 没有跳过的大文件\n");
-    return additional;
+void parallel_walk(ParallelWalker *walker, const char *root) {
+  int thread_count = walker->thread_count;
+  walker->deques = (WalkDeque *)safe_malloc(sizeof(WalkDeque) * thread_count);
+  WalkWorker *workers =
+      (WalkWorker *)safe_malloc(sizeof(WalkWorker) * thread_count);
+  for (int i = 0; i < thread_count; i++) {
+    walker->deques[i].tasks = NULL;
+    walker->deques[i].head = 0;
+    walker->deques[i].tail = 0;
+    walker->deques[i].capacity = 0;
+    InitializeCriticalSection(&walker->deques[i].lock);
+    workers[i].walker = walker;
+    workers[i].index = i;
+    arena_init(&workers[i].arena, 64 * 1024);
+    memset(&workers[i].cache_builder, 0, sizeof(ScanCacheBuilder));
+    workers[i].directories_scanned = 0;
+    workers[i].recording = 0;
+    workers[i].directories_cached = 0;
+    workers[i].subtrees_cached = 0;
+    workers[i].entries_scanned = 0;
+    workers[i].cycles_skipped = 0;
+#ifndef _WIN32
+    workers[i].statx_ring = NULL;
+    workers[i].statx_ring_failed = 0;
+#endif
   }
-  printf("\n========================================\n");
-  printf("          跳过的大文件列表\n");
-  printf("========================================\n\n");
-  printf("共跳过 %d 个大文件 (超过 %lld MB):\n\n", result->skipped_count,
-         MAX_FILE_SIZE / (1024 * 1024));
-  long long total_skipped_size = 0;
-  int backup_success_count = 0;
-  int gitignore_update_count = 0;
-  int split_success_count = 0;
-  int backup_attempt_count = 0;
-  int gitignore_attempt_count = 0;
-  int delete_success_count = 0;
-  char git_repo_path[MAX_PATH_LENGTH];
-  if (!GetCurrentDirectoryA(MAX_PATH_LENGTH, git_repo_path)) {
-    printf("[错误] 无法获取当前工作目录\n");
-    return additional;
+  walker->pending = 0;
+  walk_push_task(walker, &workers[0], NULL, root, (int)strlen(root));
+  HANDLE *threads = (HANDLE *)safe_malloc(sizeof(HANDLE) * thread_count);
+  for (int i = 1; i < thread_count; i++) {
+    threads[i] = CreateThread(NULL, 0, walk_worker_main, &workers[i], 0, NULL);
   }
-  normalize_path(git_repo_path);
-  printf("Git仓库路径: %s\n", git_repo_path);
-  char backup_base_dir[MAX_PATH_LENGTH];
-  snprintf(backup_base_dir, MAX_PATH_LENGTH, "%s-backup", git_repo_path);
-  printf("备份基础路径: %s\n\n", backup_base_dir);
-  for (int i = 0; i < result->skipped_count; i++) {
-    total_skipped_size += result->skipped_files[i].size;
+  walk_worker_main(&workers[0]);
+  for (int i = 1; i < thread_count; i++) {
+    if (threads[i]) {
+      WaitForSingleObject(threads[i], INFINITE);
+      CloseHandle(threads[i]);
+    }
+  }
+  walker->directories_scanned = 0;
+  walker->directories_cached = 0;
+  walker->subtrees_cached = 0;
+  walker->entries_scanned = 0;
+  walker->cycles_skipped = 0;
+  walker->node_bytes = 0;
+  for (int i = 0; i < thread_count; i++) {
+    walker->node_bytes += workers[i].arena.bytes_used;
+    arena_free_all(&workers[i].arena);
+    ScanCacheBuilder *builder = &workers[i].cache_builder;
+    for (unsigned int d = 0; walker->cache && d < builder->dir_count; d++) {
+      scan_cache_builder_copy_dir(&walker->cache->fresh, &builder->dirs[d],
+                                  builder->entries, builder->names, 0);
+    }
+    scan_cache_builder_free(builder);
+    walker->directories_scanned += workers[i].directories_scanned;
+    walker->directories_cached += workers[i].directories_cached;
+    walker->subtrees_cached += workers[i].subtrees_cached;
+    walker->entries_scanned += workers[i].entries_scanned;
+    walker->cycles_skipped += workers[i].cycles_skipped;
+#ifndef _WIN32
+    statx_ring_destroy(workers[i].statx_ring);
+#endif
+    free(walker->deques[i].tasks);
+    DeleteCriticalSection(&walker->deques[i].lock);
+  }
+  free(threads);
+  free(workers);
+  free(walker->deques);
+  walker->deques = NULL;
+}
+
+int compare_scan_records(const void *a, const void *b) {
+  const ScanRecord *record1 = (const ScanRecord *)a;
+  const ScanRecord *record2 = (const ScanRecord *)b;
+  return strcmp(record1->path, record2->path);
+}
+
+ScanRecord *scan_bucket_add(ScanBucket *bucket) {
+  if (bucket->count >= bucket->capacity) {
+    int new_capacity = bucket->capacity == 0 ? 256 : bucket->capacity * 2;
+    bucket->records = (ScanRecord *)safe_realloc(
+        bucket->records, sizeof(ScanRecord) * new_capacity);
+    bucket->capacity = new_capacity;
+  }
+  return &bucket->records[bucket->count++];
+}
+
+int scan_tree_visit_entry(void *context, int worker_index,
+                          const char *full_path, size_t path_length,
+                          const WIN32_FIND_DATAW *find_data) {
+  if (find_data->dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) {
+    return 1;
+  }
+  ScanBucket *bucket = &((ScanBucket *)context)[worker_index];
+  ULARGE_INTEGER file_size;
+  file_size.LowPart = find_data->nFileSizeLow;
+  file_size.HighPart = find_data->nFileSizeHigh;
+  bucket->total_size += file_size.QuadPart;
+  char *char_path = (char *)arena_alloc(&bucket->arena, path_length + 1);
+  memcpy(char_path, full_path, path_length + 1);
+  normalize_path(char_path);
+  ScanRecord *record = scan_bucket_add(bucket);
+  record->path = char_path;
+  record->size = file_size.QuadPart;
+  record->packed_size = estimate_packed_size(char_path, file_size.QuadPart,
+                                             &find_data->ftLastWriteTime);
+  record->subtree_files = 0;
+  return 0;
+}
+
+void scan_tree_visit_subtree(void *context, int worker_index,
+                             const char *path, size_t path_length,
+                             const ScanCacheDir *dir) {
+  if (dir->files == 0) {
+    return;
+  }
+  ScanBucket *bucket = &((ScanBucket *)context)[worker_index];
+  bucket->total_size += dir->size;
+  ScanRecord *record = scan_bucket_add(bucket);
+  record->path = (char *)arena_alloc(&bucket->arena, path_length + 1);
+  memcpy(record->path, path, path_length + 1);
+  record->size = dir->size;
+  record->packed_size = dir->packed_size;
+  record->subtree_files = (int)dir->files;
+}
+
+void emit_scan_file(ScanEmitter *emitter, const ScanRecord *record) {
+  if (record->subtree_files) {
+    FileItem *item = item_list_add(emitter->items, record->path, record->size,
+                                   TYPE_DIRECTORY);
+    item->packed_size = record->packed_size;
+    emitter->directories_emitted++;
+    emitter->files_pruned += record->subtree_files;
+  } else if (record->size > MAX_FILE_SIZE) {
+    *emitter->skipped_files_size += record->size;
     char size_str[32];
-    format_size(result->skipped_files[i].size, size_str, sizeof(size_str));
-    printf("%3d. %s\n", i + 1, result->skipped_files[i].path);
-    printf("     大小: %s\n", size_str);
-    char split_dir[MAX_PATH_LENGTH];
-    snprintf(split_dir, MAX_PATH_LENGTH, "%s-split",
-             result->skipped_files[i].path);
-    int needs_split =
-        !is_split_complete(result->skipped_files[i].path, split_dir,
-                           result->skipped_files[i].size);
-    if (needs_split) {
-      printf("    需要拆分大文件...\n");
-      if (split_large_file(result->skipped_files[i].path, split_dir,
-                           result->skipped_files[i].size)) {
-        split_success_count++;
-        printf("    [成功] 大文件拆分完成\n");
-        printf("    正在备份原文件...\n");
-        backup_attempt_count++;
-        if (copy_file_with_backup(result->skipped_files[i].path,
-                                  backup_base_dir)) {
-          backup_success_count++;
-          printf("    [成功] 原文件备份完成\n");
-          printf("    正在删除原文件...\n");
-          if (delete_original_file(result->skipped_files[i].path)) {
-            delete_success_count++;
-            printf("    [成功] 原文件已删除\n");
-          } else {
-            printf("    [警告] 原文件删除失败\n");
-          }
-        } else {
-          printf("    [警告] 原文件备份失败，跳过删除步骤\n");
-        }
-        if (additional.split_count < MAX_ITEMS) {
-          additional.split_files[additional.split_count] =
-              (char *)safe_malloc(strlen(split_dir) + 1);
-          strcpy(additional.split_files[additional.split_count], split_dir);
-          additional.split_count++;
-        }
-        gitignore_attempt_count++;
-        if (update_gitignore_for_skipped_file(result->skipped_files[i].path)) {
-          gitignore_update_count++;
-          char gitignore_path[MAX_PATH_LENGTH];
-          char dir_path[MAX_PATH_LENGTH];
-          strcpy_s(dir_path, MAX_PATH_LENGTH, result->skipped_files[i].path);
-          char *last_slash = strrchr(dir_path, '\\');
-          if (!last_slash) {
-            last_slash = strrchr(dir_path, '/');
-          }
-          if (last_slash) {
-            *last_slash = '\0';
-            snprintf(gitignore_path, MAX_PATH_LENGTH, "%s\\.gitignore",
-                     dir_path);
-            if (additional.gitignore_count < MAX_ITEMS) {
-              additional.gitignore_files[additional.gitignore_count] =
-                  (char *)safe_malloc(strlen(gitignore_path) + 1);
-              strcpy(additional.gitignore_files[additional.gitignore_count],
-                     gitignore_path);
-              additional.gitignore_count++;
-            }
-          }
-        }
-      } else {
-        printf("    [失败] 大文件拆分失败，跳过备份和.gitignore更新\n");
+    format_size(record->size, size_str, sizeof(size_str));
+    printf("[跳过] 大文件: %s (%s)\n", record->path, size_str);
+    add_skipped_file(emitter->result, record->path, record->size);
+  } else {
+    FileItem *item =
+        item_list_add(emitter->items, record->path, record->size, TYPE_FILE);
+    item->packed_size = record->packed_size;
+    emitter->files_emitted++;
+  }
+}
+
+void emit_scan_range(ScanEmitter *emitter, int lo, int hi,
+                     size_t prefix_length, const char *directory_path) {
+  long long packed_size =
+      emitter->packed_prefix[hi] - emitter->packed_prefix[lo];
+  int large_files = emitter->large_prefix[hi] - emitter->large_prefix[lo];
+  if (packed_size <= MAX_GROUP_SIZE && large_files == 0) {
+    FileItem *item = item_list_add(
+        emitter->items, directory_path,
+        emitter->size_prefix[hi] - emitter->size_prefix[lo], TYPE_DIRECTORY);
+    item->packed_size = packed_size;
+    emitter->directories_emitted++;
+    if (emitter->prune) {
+      for (int i = lo; i < hi; i++) {
+        emitter->files_pruned += emitter->records[i].subtree_files
+                                     ? emitter->records[i].subtree_files
+                                     : 1;
       }
     } else {
-      printf("    [信息] 大文件已拆分且完整，跳过拆分步骤\n");
-      split_success_count++;
-      if (additional.split_count < MAX_ITEMS) {
-        additional.split_files[additional.split_count] =
-            (char *)safe_malloc(strlen(split_dir) + 1);
-        strcpy(additional.split_files[additional.split_count], split_dir);
-        additional.split_count++;
-      }
-      DWORD attr = GetFileAttributesA(result->skipped_files[i].path);
-      if (attr != INVALID_FILE_ATTRIBUTES &&
-          !(attr & FILE_ATTRIBUTE_DIRECTORY)) {
-        printf("    原文件仍然存在，进行备份...\n");
-        backup_attempt_count++;
-        if (copy_file_with_backup(result->skipped_files[i].path,
-                                  backup_base_dir)) {
-          backup_success_count++;
-          printf("    [成功] 原文件备份完成\n");
-          printf("    正在删除原文件...\n");
-          if (delete_original_file(result->skipped_files[i].path)) {
-            delete_success_count++;
-            printf("    [成功] 原文件已删除\n");
-          } else {
-            printf("    [警告] 原文件删除失败\n");
-          }
-          gitignore_attempt_count++;
-          if (update_gitignore_for_skipped_file(
-                  result->skipped_files[i].path)) {
-            gitignore_update_count++;
-          }
-        } else {
-          printf("    [警告] 原文件备份失败，跳过删除步骤\n");
-        }
-      } else {
-        printf("    [信息] 原文件已不存在，无需备份和删除\n");
+      for (int i = lo; i < hi; i++) {
+        emit_scan_file(emitter, &emitter->records[i]);
       }
     }
-    if (i != result->skipped_count - 1) {
-      printf("\n");
+    return;
+  }
+  char child_path[MAX_PATH_LENGTH];
+  int i = lo;
+  while (i < hi) {
+    const char *path = emitter->records[i].path;
+    const char *separator = strchr(path + prefix_length, '\\');
+    if (!separator) {
+      emit_scan_file(emitter, &emitter->records[i]);
+      i++;
+      continue;
+    }
+    size_t child_length = (size_t)(separator - path);
+    int j = i + 1;
+    while (j < hi &&
+           strncmp(emitter->records[j].path, path, child_length + 1) == 0) {
+      j++;
     }
+    memcpy(child_path, path, child_length);
+    child_path[child_length] = '\0';
+    emit_scan_range(emitter, i, j, child_length + 1, child_path);
+    i = j;
   }
-  char total_skipped_str[32];
-  format_size(total_skipped_size, total_skipped_str, sizeof(total_skipped_str));
-  printf("\n跳过大文件总大小: %s\n", total_skipped_str);
-  printf("需要拆分的文件: %d/%d 个\n", split_success_count,
-         result->skipped_count);
-  if (backup_attempt_count > 0) {
-    printf("备份成功: %d/%d 个文件\n", backup_success_count,
-           backup_attempt_count);
-  } else {
-    printf("备份成功: 0/0 个文件 (无需备份)\n");
+}
+
+long long scan_directory_tree(const char *path, ItemList *items,
+                              long long *total_scanned_size,
+                              long long *skipped_files_size,
+                              GroupResult *result, int *has_large_files,
+                              long long *packed_size) {
+  double start_time = get_time_seconds();
+  *has_large_files = 0;
+  *packed_size = 0;
+  int thread_count = get_scan_thread_count();
+  ScanBucket *buckets =
+      (ScanBucket *)safe_malloc(sizeof(ScanBucket) * thread_count);
+  memset(buckets, 0, sizeof(ScanBucket) * thread_count);
+  for (int i = 0; i < thread_count; i++) {
+    arena_init(&buckets[i].arena, 256 * 1024);
   }
-  printf("删除成功: %d/%d 个文件\n", delete_success_count,
-         backup_success_count);
-  if (gitignore_attempt_count > 0) {
-    printf(".gitignore更新: %d/%d 个目录\n", gitignore_update_count,
-           gitignore_attempt_count);
+  VisitedSet visited;
+  visited_set_init(&visited, 1024);
+  ParallelWalker walker = {0};
+  walker.thread_count = thread_count;
+  walker.max_depth = MAX_SCAN_DEPTH;
+  walker.on_entry = scan_tree_visit_entry;
+  walker.context = buckets;
+  walker.visited = &visited;
+  walker.cache = g_scan_cache.enabled ? &g_scan_cache : NULL;
+  if (!g_run_options.dedup) {
+    walker.on_subtree = scan_tree_visit_subtree;
+  }
+  unsigned int fresh_first = g_scan_cache.fresh.dir_count;
+  parallel_walk(&walker, path);
+  visited_set_free(&visited);
+  if (walker.cycles_skipped > 0) {
+    printf("       [信息] 跳过 %lld 个重复访问的目录 (符号链接/联接点循环)\n",
+           walker.cycles_skipped);
+  }
+  long long total_size = 0;
+  int record_count = 0;
+  for (int i = 0; i < thread_count; i++) {
+    total_size += buckets[i].total_size;
+    record_count += buckets[i].count;
+  }
+  ScanRecord *records =
+      (ScanRecord *)safe_malloc(sizeof(ScanRecord) * (record_count + 1));
+  int offset = 0;
+  for (int i = 0; i < thread_count; i++) {
+    if (buckets[i].count > 0) {
+      memcpy(records + offset, buckets[i].records,
+             sizeof(ScanRecord) * buckets[i].count);
+      offset += buckets[i].count;
+    }
+    free(buckets[i].records);
+  }
+  qsort(records, record_count, sizeof(ScanRecord), compare_scan_records);
+  *total_scanned_size += total_size;
+  ScanEmitter emitter = {0};
+  emitter.records = records;
+  emitter.size_prefix =
+      (long long *)safe_malloc(sizeof(long long) * (record_count + 1));
+  emitter.packed_prefix =
+      (long long *)safe_malloc(sizeof(long long) * (record_count + 1));
+  emitter.large_prefix = (int *)safe_malloc(sizeof(int) * (record_count + 1));
+  emitter.size_prefix[0] = 0;
+  emitter.packed_prefix[0] = 0;
+  emitter.large_prefix[0] = 0;
+  for (int i = 0; i < record_count; i++) {
+    emitter.size_prefix[i + 1] = emitter.size_prefix[i] + records[i].size;
+    emitter.packed_prefix[i + 1] =
+        emitter.packed_prefix[i] + records[i].packed_size;
+    emitter.large_prefix[i + 1] =
+        emitter.large_prefix[i] +
+        (!records[i].subtree_files && records[i].size > MAX_FILE_SIZE);
+  }
+  if (walker.cache) {
+    scan_cache_fill_totals(&walker.cache->fresh, fresh_first, &emitter,
+                           record_count);
+  }
+  *packed_size = emitter.packed_prefix[record_count];
+  *has_large_files = emitter.large_prefix[record_count] > 0;
+  emitter.items = items;
+  emitter.result = result;
+  emitter.skipped_files_size = skipped_files_size;
+  emitter.prune = !g_run_options.dedup;
+  char root_path[MAX_PATH_LENGTH];
+  strcpy_s(root_path, MAX_PATH_LENGTH, path);
+  normalize_path(root_path);
+  size_t root_length = strlen(root_path);
+  if (root_length > 0 && root_path[root_length - 1] != '\\') {
+    root_length++;
+  }
+  emit_scan_range(&emitter, 0, record_count, root_length, root_path);
+  for (int i = 0; i < thread_count; i++) {
+    arena_free_all(&buckets[i].arena);
+  }
+  free(buckets);
+  free(records);
+  free(emitter.size_prefix);
+  free(emitter.packed_prefix);
+  free(emitter.large_prefix);
+  double elapsed = get_time_seconds() - start_time;
+  result->scan_stats.directories_scanned += walker.directories_scanned;
+  result->scan_stats.entries_scanned += walker.entries_scanned;
+  result->scan_stats.elapsed_seconds += elapsed;
+  char node_bytes_str[32];
+  format_size((long long)walker.node_bytes, node_bytes_str,
+              sizeof(node_bytes_str));
+  printf("       扫描耗时: %.3f 秒 (%d 线程, %lld 个目录, %lld 个条目, "
+         "目录节点占用 %s)\n",
+         elapsed, thread_count, walker.directories_scanned,
+         walker.entries_scanned, node_bytes_str);
+  if (walker.cache && walker.on_subtree) {
+    printf("       扫描缓存跳过 %lld 个未变化的子树 (共 %lld 个目录)\n",
+           walker.subtrees_cached, walker.directories_cached);
+  }
+  printf("       生成 %d 个目录项, %d 个文件项 (整体接受的目录内跳过 %d "
+         "个文件)\n",
+         emitter.directories_emitted, emitter.files_emitted,
+         emitter.files_pruned);
+  return total_size;
+}
+
+int create_directory_recursive(const wchar_t *wpath) {
+  wchar_t temp_path[MAX_PATH_LENGTH];
+  wchar_t *p = NULL;
+  size_t len = wcslen(wpath);
+  wcscpy_s(temp_path, MAX_PATH_LENGTH, wpath);
+  for (p = temp_path + 1; *p; p++) {
+    if (*p == L'\\') {
+      *p = L'\0';
+      DWORD attr = GetFileAttributesW(temp_path);
+      if (attr == INVALID_FILE_ATTRIBUTES) {
+        if (!CreateDirectoryW(temp_path, NULL)) {
+          DWORD error = GetLastError();
+          if (error != ERROR_ALREADY_EXISTS) {
+            printf("[错误] 无法创建目录: %ls (错误: %lu)\n", temp_path, error);
+            return 0;
+          }
+        }
+      } else if (!(attr & FILE_ATTRIBUTE_DIRECTORY)) {
+        printf("[错误] 路径不是目录: %ls\n", temp_path);
+        return 0;
+      }
+      *p = L'\\';
+    }
+  }
+  DWORD attr = GetFileAttributesW(temp_path);
+  if (attr == INVALID_FILE_ATTRIBUTES) {
+    if (!CreateDirectoryW(temp_path, NULL)) {
+      DWORD error = GetLastError();
+      if (error != ERROR_ALREADY_EXISTS) {
+        printf("[错误] 无法创建目录: %ls (错误: %lu)\n", temp_path, error);
+        return 0;
+      }
+    }
+  }
+  return 1;
+}
+
+int copy_file_with_backup(const char *src_path, const char *backup_base_path) {
+  wchar_t *wsrc_path = char_to_wchar(src_path);
+  if (!wsrc_path) {
+    printf("[错误] 无法转换源路径编码: %s\n", src_path);
+    return 0;
+  }
+  DWORD src_attr = GetFileAttributesW(wsrc_path);
+  if (src_attr == INVALID_FILE_ATTRIBUTES) {
+    DWORD error = GetLastError();
+    printf("[错误] 源文件无法访问: %s (错误: %lu)\n", src_path, error);
+    free(wsrc_path);
+    return 0;
+  }
+  if (src_attr & FILE_ATTRIBUTE_DIRECTORY) {
+    printf("[错误] 源路径是目录而不是文件: %s\n", src_path);
+    free(wsrc_path);
+    return 0;
+  }
+  char git_repo_path[MAX_PATH_LENGTH];
+  if (!GetCurrentDirectoryA(MAX_PATH_LENGTH, git_repo_path)) {
+    printf("[错误] 无法获取当前工作目录\n");
+    free(wsrc_path);
+    return 0;
+  }
+  normalize_path(git_repo_path);
+  char backup_dir[MAX_PATH_LENGTH];
+  snprintf(backup_dir, MAX_PATH_LENGTH, "%s-backup", git_repo_path);
+  char backup_path[MAX_PATH_LENGTH];
+  if (strstr(src_path, git_repo_path) == src_path) {
+    const char *relative_part = src_path + strlen(git_repo_path);
+    if (*relative_part == '\\' || *relative_part == '/') {
+      relative_part++;
+    }
+    if (strlen(relative_part) > 0) {
+      snprintf(backup_path, MAX_PATH_LENGTH, "%s\\%s", backup_dir,
+               relative_part);
+    } else {
+      const char *filename = strrchr(src_path, '\\');
+      if (!filename) {
+        filename = strrchr(src_path, '/');
+      }
+      if (filename) {
+        filename++;
+      } else {
+        filename = src_path;
+      }
+      snprintf(backup_path, MAX_PATH_LENGTH, "%s\\%s", backup_dir, filename);
+    }
   } else {
-    printf(".gitignore更新: 0/0 个目录 (无需更新)\n");
+    char safe_path[MAX_PATH_LENGTH];
+    strcpy_s(safe_path, MAX_PATH_LENGTH, src_path);
+    for (char *p = safe_path; *p; p++) {
+      if (*p == ':') {
+        *p = '_';
+      }
+      if (*p == '/') {
+        *p = '\\';
+      }
+    }
+    if (safe_path[0] == '\\') {
+      snprintf(backup_path, MAX_PATH_LENGTH, "%s\\%s", backup_dir,
+               safe_path + 1);
+    } else {
+      snprintf(backup_path, MAX_PATH_LENGTH, "%s\\%s", backup_dir, safe_path);
+    }
   }
-  if (backup_attempt_count > 0 && backup_success_count < backup_attempt_count) {
-    printf("[警告] 部分文件备份失败，请检查权限和磁盘空间\n");
-  } else if (backup_success_count > 0) {
-    printf("[成功] 所有需要备份的大文件已备份到: %s-backup\n", git_repo_path);
+  normalize_path(backup_path);
+  wchar_t *wbackup_path = char_to_wchar(backup_path);
+  if (!wbackup_path) {
+    printf("[错误] 无法转换备份路径编码: %s\n", backup_path);
+    free(wsrc_path);
+    return 0;
+  }
+  wchar_t backup_dir_wide[MAX_PATH_LENGTH];
+  wcscpy_s(backup_dir_wide, MAX_PATH_LENGTH, wbackup_path);
+  wchar_t *last_slash = wcsrchr(backup_dir_wide, L'\\');
+  if (last_slash) {
+    *last_slash = L'\0';
+    if (!create_directory_recursive(backup_dir_wide)) {
+      printf("[错误] 无法创建备份目录结构\n");
+      free(wsrc_path);
+      free(wbackup_path);
+      return 0;
+    }
+  }
+  printf("    备份到: %s\n", backup_path);
+  if (CopyFileW(wsrc_path, wbackup_path, FALSE)) {
+    printf("    [成功] 文件备份完成\n");
+    free(wsrc_path);
+    free(wbackup_path);
+    return 1;
   } else {
-    printf("[信息] 没有需要备份的文件\n");
+    DWORD error = GetLastError();
+    printf("    [失败] 文件备份失败 (错误: %lu)\n", error);
+    free(wsrc_path);
+    free(wbackup_path);
+    return 0;
   }
-  if (delete_success_count > 0) {
-    printf("[成功] %d 个原文件已删除\n", delete_success_count);
+}
+
+void process_input_path(const char *path, ItemList *items,
+                        long long *total_input_size,
+                        long long *total_scanned_size,
+                        long long *skipped_files_size, GroupResult *result) {
+  char normalized_path[MAX_PATH_LENGTH];
+  strcpy_s(normalized_path, MAX_PATH_LENGTH, path);
+  normalize_path(normalized_path);
+  printf("[处理] 正在处理路径: %s\n", normalized_path);
+  int is_directory_path = 0;
+  size_t path_len = strlen(normalized_path);
+  if (path[path_len > 0 ? path_len - 1 : 0] == '\\' ||
+      path[path_len > 0 ? path_len - 1 : 0] == '/') {
+    is_directory_path = 1;
+    printf("  [信息] 识别为目录路径\n");
   }
-  if (backup_success_count > 0 && delete_success_count < backup_success_count) {
-    printf("[警告] 部分文件备份成功但删除失败\n");
+  const wchar_t *wpath = path_to_wide(normalized_path, 1);
+  if (!wpath) {
+    printf("[警告] 无法转换路径编码: %s\n", normalized_path);
+    return;
   }
-  if (split_success_count < result->skipped_count) {
-    printf("[警告] 部分大文件拆分失败\n");
+  long long hinted_size = 0;
+  unsigned long long hinted_mtime = 0;
+  int has_hint =
+      !is_directory_path &&
+      path_stat_hints_get(normalized_path, &hinted_size, &hinted_mtime);
+  DWORD attr = has_hint ? FILE_ATTRIBUTE_NORMAL : GetFileAttributesW(wpath);
+  if (attr == INVALID_FILE_ATTRIBUTES) {
+    if (is_directory_path) {
+      printf("  [警告] 无法访问目录，但根据路径特征识别为目录: %s\n",
+             normalized_path);
+      item_list_add(items, normalized_path, 0, TYPE_DIRECTORY);
+      printf("  [信息] 已添加目录到处理列表（大小未知）\n");
+    } else {
+      printf("  [信息] 路径可能为新文件: %s\n", normalized_path);
+      item_list_add(items, normalized_path, 0, TYPE_FILE);
+      printf("  [信息] 已添加文件到处理列表（新文件）\n");
+    }
+    return;
+  }
+  if (attr & FILE_ATTRIBUTE_DIRECTORY) {
+    printf("  [扫描] 文件夹: %s\n", normalized_path);
+    int has_large_files = 0;
+    long long dir_packed_size = 0;
+    long long dir_size = scan_directory_tree(
+        normalized_path, items, total_scanned_size, skipped_files_size, result,
+        &has_large_files, &dir_packed_size);
+    *total_input_size += dir_size;
+    char size_str[32];
+    format_size(dir_size, size_str, sizeof(size_str));
+    printf("       文件夹大小: %s\n", size_str);
+    if (g_run_options.estimate_pack) {
+      char packed_str[32];
+      format_size(dir_packed_size, packed_str, sizeof(packed_str));
+      printf("       估算打包大小: %s\n", packed_str);
+    }
+    if (dir_packed_size <= MAX_GROUP_SIZE && !has_large_files) {
+      printf("       文件夹大小合适且不包含大文件，已整体添加: %s\n",
+             normalized_path);
+    } else {
+      if (dir_packed_size > MAX_GROUP_SIZE) {
+        printf("       文件夹太大 (%s > %lld MB)，已拆分为可容纳的子目录...\n",
+               size_str, MAX_GROUP_SIZE / (1024 * 1024));
+      }
+      if (has_large_files) {
+        printf("       文件夹包含大文件，已拆分为不含大文件的子目录...\n");
+      }
+    }
   } else {
-    printf("[成功] 所有大文件拆分处理完成\n");
+    printf("  [扫描] 文件: %s\n", normalized_path);
+    HANDLE hFile = INVALID_HANDLE_VALUE;
+    if (!has_hint) {
+      hFile = CreateFileW(wpath, GENERIC_READ, FILE_SHARE_READ, NULL,
+                          OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    }
+    if (has_hint || hFile != INVALID_HANDLE_VALUE) {
+      ULARGE_INTEGER file_size;
+      FILETIME mtime = {0};
+      if (has_hint) {
+        file_size.QuadPart = (unsigned long long)hinted_size;
+        mtime.dwLowDateTime = (DWORD)hinted_mtime;
+        mtime.dwHighDateTime = (DWORD)(hinted_mtime >> 32);
+      } else {
+        DWORD sizeHigh;
+        file_size.LowPart = GetFileSize(hFile, &sizeHigh);
+        file_size.HighPart = sizeHigh;
+        GetFileTime(hFile, NULL, NULL, &mtime);
+        CloseHandle(hFile);
+      }
+      *total_input_size += file_size.QuadPart;
+      *total_scanned_size += file_size.QuadPart;
+      if (file_size.QuadPart > MAX_FILE_SIZE) {
+        printf("       跳过] 大文件: %s", normalized_path);
+        char size_str[32];
+        format_size(file_size.QuadPart, size_str, sizeof(size_str));
+        printf(" (%s)\n", size_str);
+        *skipped_files_size += file_size.QuadPart;
+        add_skipped_file(result, normalized_path, file_size.QuadPart);
+      } else {
+        FileItem *item = item_list_add(items, normalized_path,
+                                       file_size.QuadPart, TYPE_FILE);
+        item->packed_size = estimate_packed_size(normalized_path,
+                                                 file_size.QuadPart, &mtime);
+      }
+    } else {
+      printf("  [警告] 无法打开文件 %s (错误: %lu)\n", normalized_path,
+             GetLastError());
+      item_list_add(items, normalized_path, 0, TYPE_FILE);
+    }
+  }
+}
+
+int compare_items(const void *a, const void *b) {
+  const FileItem *item1 = (const FileItem *)a;
+  const FileItem *item2 = (const FileItem *)b;
+  if (item1->type != item2->type) {
+    return item2->type - item1->type;
+  }
+  if (item1->size > item2->size)
+    return -1;
+  if (item1->size < item2->size)
+    return 1;
+  return strcmp(item_path(item1), item_path(item2));
+}
+
+void path_trie_init(PathTrie *trie) {
+  memset(trie, 0, sizeof(PathTrie));
+  trie->node_capacity = 64;
+  trie->nodes =
+      (PathTrieNode *)safe_malloc(sizeof(PathTrieNode) * trie->node_capacity);
+  trie->nodes[0].payload = -1;
+  trie->node_count = 1;
+  trie->edge_capacity = 128;
+  trie->edges =
+      (PathTrieEdge *)safe_malloc(sizeof(PathTrieEdge) * trie->edge_capacity);
+  memset(trie->edges, 0, sizeof(PathTrieEdge) * trie->edge_capacity);
+}
+
+void path_trie_free(PathTrie *trie) {
+  free(trie->nodes);
+  free(trie->edges);
+  free(trie->names);
+  memset(trie, 0, sizeof(PathTrie));
+}
+
+unsigned long long hash_trie_edge(int parent, const char *name,
+                                  size_t length) {
+  unsigned long long h = 1469598103934665603ULL ^ (unsigned int)parent;
+  for (size_t i = 0; i < length; i++) {
+    h ^= (unsigned char)name[i];
+    h *= 1099511628211ULL;
+  }
+  return h ? h : 1;
+}
+
+size_t path_trie_find_slot(const PathTrie *trie, unsigned long long hash,
+                           int parent, const char *name, size_t length) {
+  size_t mask = trie->edge_capacity - 1;
+  size_t slot = (size_t)hash & mask;
+  while (trie->edges[slot].hash != 0) {
+    const PathTrieEdge *edge = &trie->edges[slot];
+    if (edge->hash == hash && edge->parent == parent &&
+        edge->name_length == length &&
+        memcmp(trie->names + edge->name_offset, name, length) == 0) {
+      return slot;
+    }
+    slot = (slot + 1) & mask;
+  }
+  return slot;
+}
+
+void path_trie_grow_edges(PathTrie *trie) {
+  size_t old_capacity = trie->edge_capacity;
+  PathTrieEdge *old_edges = trie->edges;
+  trie->edge_capacity = old_capacity * 2;
+  trie->edges =
+      (PathTrieEdge *)safe_malloc(sizeof(PathTrieEdge) * trie->edge_capacity);
+  memset(trie->edges, 0, sizeof(PathTrieEdge) * trie->edge_capacity);
+  for (size_t i = 0; i < old_capacity; i++) {
+    if (old_edges[i].hash != 0) {
+      size_t mask = trie->edge_capacity - 1;
+      size_t slot = (size_t)old_edges[i].hash & mask;
+      while (trie->edges[slot].hash != 0) {
+        slot = (slot + 1) & mask;
+      }
+      trie->edges[slot] = old_edges[i];
+    }
+  }
+  free(old_edges);
+}
+
+int path_trie_child(PathTrie *trie, int parent, const char *name,
+                    size_t length, int create) {
+  unsigned long long hash = hash_trie_edge(parent, name, length);
+  size_t slot = path_trie_find_slot(trie, hash, parent, name, length);
+  if (trie->edges[slot].hash != 0) {
+    return trie->edges[slot].child;
+  }
+  if (!create) {
+    return -1;
+  }
+  if ((trie->edge_count + 1) * 2 > trie->edge_capacity) {
+    path_trie_grow_edges(trie);
+    slot = path_trie_find_slot(trie, hash, parent, name, length);
+  }
+  if (trie->names_length + length > trie->names_capacity) {
+    size_t new_capacity =
+        trie->names_capacity == 0 ? 4096 : trie->names_capacity * 2;
+    while (trie->names_length + length > new_capacity) {
+      new_capacity *= 2;
+    }
+    trie->names = (char *)safe_realloc(trie->names, new_capacity);
+    trie->names_capacity = new_capacity;
+  }
+  if (trie->node_count >= trie->node_capacity) {
+    trie->node_capacity *= 2;
+    trie->nodes = (PathTrieNode *)safe_realloc(
+        trie->nodes, sizeof(PathTrieNode) * trie->node_capacity);
+  }
+  int child = trie->node_count++;
+  trie->nodes[child].payload = -1;
+  memcpy(trie->names + trie->names_length, name, length);
+  PathTrieEdge *edge = &trie->edges[slot];
+  edge->hash = hash;
+  edge->parent = parent;
+  edge->child = child;
+  edge->name_offset = (unsigned int)trie->names_length;
+  edge->name_length = (unsigned int)length;
+  trie->names_length += length;
+  trie->edge_count++;
+  return child;
+}
+
+const char *next_path_component(const char *p, size_t *length) {
+  while (*p == '\\' || *p == '/') {
+    p++;
+  }
+  const char *end = p;
+  while (*end && *end != '\\' && *end != '/') {
+    end++;
+  }
+  *length = (size_t)(end - p);
+  return p;
+}
+
+void path_trie_insert(PathTrie *trie, const char *path, int payload) {
+  int node = 0;
+  size_t length;
+  const char *component = next_path_component(path, &length);
+  while (length > 0) {
+    node = path_trie_child(trie, node, component, length, 1);
+    component = next_path_component(component + length, &length);
+  }
+  if (node != 0 && trie->nodes[node].payload < 0) {
+    trie->nodes[node].payload = payload;
+  }
+}
+
+int path_trie_find_container(PathTrie *trie, const char *path) {
+  int node = 0;
+  int found = -1;
+  size_t length;
+  const char *component = next_path_component(path, &length);
+  while (length > 0) {
+    node = path_trie_child(trie, node, component, length, 0);
+    if (node < 0) {
+      break;
+    }
+    if (trie->nodes[node].payload >= 0) {
+      found = trie->nodes[node].payload;
+    }
+    component = next_path_component(component + length, &length);
+  }
+  return found;
+}
+
+void capacity_index_init(CapacityIndex *index) {
+  memset(index, 0, sizeof(CapacityIndex));
+  index->root = -1;
+}
+
+void capacity_index_reserve(CapacityIndex *index, int capacity) {
+  if (capacity <= index->capacity) {
+    return;
+  }
+  int new_capacity = index->capacity == 0 ? 16 : index->capacity;
+  while (new_capacity < capacity) {
+    new_capacity *= 2;
+  }
+  index->remaining = (long long *)safe_realloc(
+      index->remaining, sizeof(long long) * new_capacity);
+  index->left = (int *)safe_realloc(index->left, sizeof(int) * new_capacity);
+  index->right = (int *)safe_realloc(index->right, sizeof(int) * new_capacity);
+  index->priority = (unsigned int *)safe_realloc(
+      index->priority, sizeof(unsigned int) * new_capacity);
+  index->capacity = new_capacity;
+}
+
+int capacity_key_less(const CapacityIndex *index, int a, int b) {
+  if (index->remaining[a] != index->remaining[b]) {
+    return index->remaining[a] < index->remaining[b];
+  }
+  return a < b;
+}
+
+int capacity_index_merge(CapacityIndex *index, int a, int b) {
+  if (a < 0) {
+    return b;
+  }
+  if (b < 0) {
+    return a;
+  }
+  if (index->priority[a] > index->priority[b]) {
+    index->right[a] = capacity_index_merge(index, index->right[a], b);
+    return a;
+  }
+  index->left[b] = capacity_index_merge(index, a, index->left[b]);
+  return b;
+}
+
+void capacity_index_split(CapacityIndex *index, int node, int key, int *less,
+                          int *not_less) {
+  if (node < 0) {
+    *less = -1;
+    *not_less = -1;
+    return;
+  }
+  if (capacity_key_less(index, node, key)) {
+    capacity_index_split(index, index->right[node], key, &index->right[node],
+                         not_less);
+    *less = node;
+  } else {
+    capacity_index_split(index, index->left[node], key, less,
+                         &index->left[node]);
+    *not_less = node;
+  }
+}
+
+void capacity_index_insert(CapacityIndex *index, int group,
+                           long long remaining) {
+  capacity_index_reserve(index, group + 1);
+  unsigned int h = (unsigned int)group * 2654435761u;
+  h ^= h >> 16;
+  index->remaining[group] = remaining;
+  index->left[group] = -1;
+  index->right[group] = -1;
+  index->priority[group] = h * 0x45d9f3bu;
+  int less, not_less;
+  capacity_index_split(index, index->root, group, &less, &not_less);
+  index->root = capacity_index_merge(
+      index, capacity_index_merge(index, less, group), not_less);
+}
+
+int capacity_index_remove_node(CapacityIndex *index, int node, int group) {
+  if (node < 0) {
+    return -1;
+  }
+  if (node == group) {
+    return capacity_index_merge(index, index->left[node], index->right[node]);
+  }
+  if (capacity_key_less(index, group, node)) {
+    index->left[node] = capacity_index_remove_node(index, index->left[node],
+                                                   group);
+  } else {
+    index->right[node] = capacity_index_remove_node(index, index->right[node],
+                                                    group);
+  }
+  return node;
+}
+
+void capacity_index_remove(CapacityIndex *index, int group) {
+  index->root = capacity_index_remove_node(index, index->root, group);
+}
+
+int capacity_index_best_fit(const CapacityIndex *index, long long size) {
+  int best = -1;
+  int node = index->root;
+  while (node >= 0) {
+    if (index->remaining[node] >= size) {
+      best = node;
+      node = index->left[node];
+    } else {
+      node = index->right[node];
+    }
+  }
+  return best;
+}
+
+int capacity_index_place(CapacityIndex *index, long long size,
+                         long long capacity, int *group_count) {
+  int group = capacity_index_best_fit(index, size);
+  long long remaining;
+  if (group < 0) {
+    group = (*group_count)++;
+    remaining = capacity;
+  } else {
+    remaining = index->remaining[group];
+    capacity_index_remove(index, group);
+  }
+  capacity_index_insert(index, group, remaining - size);
+  return group;
+}
+
+void capacity_index_free(CapacityIndex *index) {
+  free(index->remaining);
+  free(index->left);
+  free(index->right);
+  free(index->priority);
+  memset(index, 0, sizeof(CapacityIndex));
+  index->root = -1;
+}
+
+void group_append_item(Arena *arena, FileGroup *group, const FileItem *item) {
+  if (group->count >= group->capacity) {
+    int new_capacity = group->capacity == 0 ? 10 : group->capacity * 2;
+    FileItem *items =
+        (FileItem *)arena_alloc(arena, sizeof(FileItem) * new_capacity);
+    if (group->count > 0) {
+      memcpy(items, group->items, sizeof(FileItem) * group->count);
+    }
+    group->items = items;
+    group->capacity = new_capacity;
+  }
+  group->items[group->count++] = *item;
+  group->total_size += item->size;
+  group->packed_size += item->packed_size;
+}
+
+int append_empty_group(GroupResult *result) {
+  if (result->group_count >= result->groups_capacity) {
+    int new_capacity =
+        result->groups_capacity == 0 ? 10 : result->groups_capacity * 2;
+    result->groups = (FileGroup *)safe_realloc(
+        result->groups, sizeof(FileGroup) * new_capacity);
+    for (int k = result->groups_capacity; k < new_capacity; k++) {
+      result->groups[k].items = NULL;
+      result->groups[k].count = 0;
+      result->groups[k].capacity = 0;
+      result->groups[k].total_size = 0;
+      result->groups[k].packed_size = 0;
+    }
+    result->groups_capacity = new_capacity;
+  }
+  return result->group_count++;
+}
+
+void group_packer_init(GroupPacker *packer, GroupResult *result,
+                       long long group_capacity) {
+  packer->result = result;
+  packer->group_capacity = group_capacity;
+  capacity_index_init(&packer->index);
+  capacity_index_reserve(&packer->index, result->group_count + 1);
+  for (int i = 0; i < result->group_count; i++) {
+    capacity_index_insert(&packer->index, i,
+                          group_capacity - result->groups[i].packed_size);
+  }
+}
+
+int group_packer_add(GroupPacker *packer, const FileItem *item, int *created) {
+  GroupResult *result = packer->result;
+  int group_count = result->group_count;
+  int group = capacity_index_place(&packer->index, item->packed_size,
+                                   packer->group_capacity, &group_count);
+  *created = group_count > result->group_count;
+  if (*created) {
+    append_empty_group(result);
+  }
+  group_append_item(&result->arena, &result->groups[group], item);
+  return group;
+}
+
+void group_packer_free(GroupPacker *packer) {
+  capacity_index_free(&packer->index);
+}
+
+const char *pack_strategy_name(PackStrategy strategy) {
+  switch (strategy) {
+  case PACK_FIRST_FIT_DECREASING:
+    return "ffd";
+  case PACK_DIFFERENCING:
+    return "kk";
+  case PACK_BRANCH_AND_BOUND:
+    return "bnb";
+  case PACK_AUTO:
+    return "auto";
+  default:
+    return "bfd";
+  }
+}
+
+int parse_pack_strategy(const char *name, PackStrategy *strategy) {
+  const char *names[] = {"bfd", "ffd", "kk", "bnb", "auto"};
+  for (int i = 0; i < 5; i++) {
+    if (strcmp(name, names[i]) == 0) {
+      *strategy = (PackStrategy)i;
+      return 1;
+    }
+  }
+  return 0;
+}
+
+int pack_lower_bound(const long long *sizes, int count, long long capacity) {
+  long long total = 0;
+  for (int i = 0; i < count; i++) {
+    total += sizes[i];
+  }
+  return (int)((total + capacity - 1) / capacity);
+}
+
+int pack_best_fit(const long long *sizes, int count, long long capacity,
+                  int *assignment) {
+  CapacityIndex index;
+  capacity_index_init(&index);
+  int group_count = 0;
+  for (int i = 0; i < count; i++) {
+    assignment[i] =
+        capacity_index_place(&index, sizes[i], capacity, &group_count);
+  }
+  capacity_index_free(&index);
+  return group_count;
+}
+
+void fit_tree_update(long long *tree, int leaves, int slot, long long value) {
+  int node = slot + leaves;
+  tree[node] = value;
+  for (node /= 2; node > 0; node /= 2) {
+    long long left = tree[node * 2], right = tree[node * 2 + 1];
+    tree[node] = left > right ? left : right;
+  }
+}
+
+int fit_tree_first(const long long *tree, int leaves, long long size) {
+  if (tree[1] < size) {
+    return -1;
+  }
+  int node = 1;
+  while (node < leaves) {
+    node = tree[node * 2] >= size ? node * 2 : node * 2 + 1;
+  }
+  return node - leaves;
+}
+
+int pack_first_fit(const long long *sizes, int count, long long capacity,
+                   int *assignment) {
+  int leaves = 16;
+  long long *tree = (long long *)safe_malloc(sizeof(long long) * leaves * 2);
+  for (int i = 0; i < leaves * 2; i++) {
+    tree[i] = capacity;
+  }
+  int group_count = 0;
+  for (int i = 0; i < count; i++) {
+    if (group_count >= leaves) {
+      long long *grown =
+          (long long *)safe_malloc(sizeof(long long) * leaves * 4);
+      for (int k = 0; k < leaves * 2; k++) {
+        grown[leaves * 2 + k] = k < leaves ? tree[leaves + k] : capacity;
+      }
+      leaves *= 2;
+      for (int k = leaves - 1; k > 0; k--) {
+        long long left = grown[k * 2], right = grown[k * 2 + 1];
+        grown[k] = left > right ? left : right;
+      }
+      free(tree);
+      tree = grown;
+    }
+    int group = fit_tree_first(tree, leaves, sizes[i]);
+    if (group < 0 || group > group_count) {
+      group = group_count;
+    }
+    if (group == group_count) {
+      group_count++;
+    }
+    fit_tree_update(tree, leaves, group, tree[leaves + group] - sizes[i]);
+    assignment[i] = group;
+  }
+  free(tree);
+  return group_count;
+}
+
+int compare_pack_subsets(const void *a, const void *b) {
+  const PackSubset *subset1 = (const PackSubset *)a;
+  const PackSubset *subset2 = (const PackSubset *)b;
+  if (subset1->sum > subset2->sum)
+    return -1;
+  if (subset1->sum < subset2->sum)
+    return 1;
+  return 0;
+}
+
+long long differencing_key(const PackSubset *subsets, int partial, int k) {
+  return subsets[(size_t)partial * k].sum -
+         subsets[(size_t)partial * k + k - 1].sum;
+}
+
+void differencing_heap_push(int *heap, int *heap_count,
+                            const PackSubset *subsets, int k, int partial) {
+  int i = (*heap_count)++;
+  heap[i] = partial;
+  while (i > 0) {
+    int parent = (i - 1) / 2;
+    if (differencing_key(subsets, heap[parent], k) >=
+        differencing_key(subsets, heap[i], k)) {
+      break;
+    }
+    int swap = heap[parent];
+    heap[parent] = heap[i];
+    heap[i] = swap;
+    i = parent;
+  }
+}
+
+int differencing_heap_pop(int *heap, int *heap_count,
+                          const PackSubset *subsets, int k) {
+  int top = heap[0];
+  heap[0] = heap[--(*heap_count)];
+  int i = 0;
+  while (1) {
+    int largest = i;
+    int left = i * 2 + 1, right = i * 2 + 2;
+    if (left < *heap_count && differencing_key(subsets, heap[left], k) >
+                                  differencing_key(subsets, heap[largest], k)) {
+      largest = left;
+    }
+    if (right < *heap_count &&
+        differencing_key(subsets, heap[right], k) >
+            differencing_key(subsets, heap[largest], k)) {
+      largest = right;
+    }
+    if (largest == i) {
+      break;
+    }
+    int swap = heap[largest];
+    heap[largest] = heap[i];
+    heap[i] = swap;
+    i = largest;
+  }
+  return top;
+}
+
+int pack_differencing_k(const long long *sizes, int count, long long capacity,
+                        int k, int *assignment) {
+  PackSubset *subsets =
+      (PackSubset *)safe_malloc(sizeof(PackSubset) * (size_t)count * k);
+  PackSubset *merged = (PackSubset *)safe_malloc(sizeof(PackSubset) * k);
+  int *next = (int *)safe_malloc(sizeof(int) * count);
+  int *heap = (int *)safe_malloc(sizeof(int) * count);
+  int heap_count = 0;
+  for (int i = 0; i < count; i++) {
+    PackSubset *partial = &subsets[(size_t)i * k];
+    for (int j = 0; j < k; j++) {
+      partial[j].sum = 0;
+      partial[j].head = -1;
+      partial[j].tail = -1;
+    }
+    partial[0].sum = sizes[i];
+    partial[0].head = i;
+    partial[0].tail = i;
+    next[i] = -1;
+    differencing_heap_push(heap, &heap_count, subsets, k, i);
+  }
+  while (heap_count > 1) {
+    int a = differencing_heap_pop(heap, &heap_count, subsets, k);
+    int b = differencing_heap_pop(heap, &heap_count, subsets, k);
+    PackSubset *first = &subsets[(size_t)a * k];
+    PackSubset *second = &subsets[(size_t)b * k];
+    for (int j = 0; j < k; j++) {
+      PackSubset *x = &first[j];
+      PackSubset *y = &second[k - 1 - j];
+      merged[j].sum = x->sum + y->sum;
+      if (x->head < 0) {
+        merged[j].head = y->head;
+        merged[j].tail = y->tail;
+      } else {
+        merged[j].head = x->head;
+        merged[j].tail = x->tail;
+        if (y->head >= 0) {
+          next[x->tail] = y->head;
+          merged[j].tail = y->tail;
+        }
+      }
+    }
+    qsort(merged, k, sizeof(PackSubset), compare_pack_subsets);
+    memcpy(first, merged, sizeof(PackSubset) * k);
+    differencing_heap_push(heap, &heap_count, subsets, k, a);
+  }
+  int group_count = -1;
+  if (heap_count == 1 && subsets[(size_t)heap[0] * k].sum <= capacity) {
+    PackSubset *final_partial = &subsets[(size_t)heap[0] * k];
+    group_count = 0;
+    for (int j = 0; j < k; j++) {
+      if (final_partial[j].head < 0) {
+        continue;
+      }
+      for (int item = final_partial[j].head; item >= 0; item = next[item]) {
+        assignment[item] = group_count;
+      }
+      group_count++;
+    }
+  }
+  free(heap);
+  free(next);
+  free(merged);
+  free(subsets);
+  return group_count;
+}
+
+int pack_differencing(const long long *sizes, int count, long long capacity,
+                      int *assignment, int group_limit) {
+  int k = pack_lower_bound(sizes, count, capacity);
+  if (k < 1) {
+    k = 1;
+  }
+  for (int round = 0; round < MAX_DIFFERENCING_ROUNDS && k <= group_limit &&
+                      k <= count;
+       round++, k++) {
+    if ((long long)count * k > MAX_DIFFERENCING_CELLS) {
+      printf("  [信息] 差分法规模过大 (%d 项 x %d 组)，跳过\n", count, k);
+      return -1;
+    }
+    int group_count =
+        pack_differencing_k(sizes, count, capacity, k, assignment);
+    if (group_count > 0) {
+      return group_count;
+    }
+  }
+  return -1;
+}
+
+void exact_pack_search(ExactPackState *state, int index, int group_count) {
+  if (state->nodes++ >= MAX_EXACT_PACK_NODES) {
+    state->exhausted = 1;
+    return;
+  }
+  if (index == state->count) {
+    if (group_count < state->best_count) {
+      state->best_count = group_count;
+      memcpy(state->best, state->current, sizeof(int) * state->count);
+    }
+    return;
+  }
+  long long placed = state->total - state->suffix[index];
+  long long free_space = (long long)group_count * state->capacity - placed;
+  long long overflow = state->suffix[index] - free_space;
+  int needed = group_count;
+  if (overflow > 0) {
+    needed += (int)((overflow + state->capacity - 1) / state->capacity);
+  }
+  if (needed >= state->best_count) {
+    return;
+  }
+  long long size = state->sizes[index];
+  for (int g = 0; g < group_count && !state->exhausted; g++) {
+    if (state->remaining[g] < size) {
+      continue;
+    }
+    int duplicate = 0;
+    for (int h = 0; h < g; h++) {
+      if (state->remaining[h] == state->remaining[g]) {
+        duplicate = 1;
+        break;
+      }
+    }
+    if (duplicate) {
+      continue;
+    }
+    state->remaining[g] -= size;
+    state->current[index] = g;
+    exact_pack_search(state, index + 1, group_count);
+    state->remaining[g] += size;
+  }
+  if (!state->exhausted && group_count + 1 < state->best_count) {
+    state->remaining[group_count] = state->capacity - size;
+    state->current[index] = group_count;
+    exact_pack_search(state, index + 1, group_count + 1);
+  }
+}
+
+int pack_branch_and_bound(const long long *sizes, int count,
+                          long long capacity, int *assignment, int *proven) {
+  int group_count = pack_first_fit(sizes, count, capacity, assignment);
+  *proven = 0;
+  if (count > MAX_EXACT_PACK_ITEMS) {
+    printf("  [信息] 项数 %d 超过精确搜索上限 %d，使用 ffd 结果\n", count,
+           MAX_EXACT_PACK_ITEMS);
+    return group_count;
+  }
+  ExactPackState state = {0};
+  state.sizes = sizes;
+  state.count = count;
+  state.capacity = capacity;
+  state.remaining = (long long *)safe_malloc(sizeof(long long) * (count + 1));
+  state.suffix = (long long *)safe_malloc(sizeof(long long) * (count + 1));
+  state.current = (int *)safe_malloc(sizeof(int) * (count + 1));
+  state.best = assignment;
+  state.best_count = group_count;
+  state.suffix[count] = 0;
+  for (int i = count - 1; i >= 0; i--) {
+    state.suffix[i] = state.suffix[i + 1] + sizes[i];
+  }
+  state.total = state.suffix[0];
+  exact_pack_search(&state, 0, 0);
+  *proven = !state.exhausted;
+  free(state.remaining);
+  free(state.suffix);
+  free(state.current);
+  return state.best_count;
+}
+
+int pack_with_strategy(PackStrategy strategy, const long long *sizes,
+                       int count, long long capacity, int *assignment) {
+  if (strategy == PACK_FIRST_FIT_DECREASING) {
+    return pack_first_fit(sizes, count, capacity, assignment);
+  }
+  if (strategy == PACK_DIFFERENCING) {
+    int bfd_count = pack_best_fit(sizes, count, capacity, assignment);
+    int *candidate = (int *)safe_malloc(sizeof(int) * (count + 1));
+    int group_count =
+        pack_differencing(sizes, count, capacity, candidate, bfd_count);
+    if (group_count > 0) {
+      memcpy(assignment, candidate, sizeof(int) * count);
+    } else {
+      printf("  [信息] 差分法未找到不多于 bfd 的可行分组，使用 bfd 结果\n");
+      group_count = bfd_count;
+    }
+    free(candidate);
+    return group_count;
+  }
+  if (strategy == PACK_BRANCH_AND_BOUND) {
+    int proven;
+    int group_count =
+        pack_branch_and_bound(sizes, count, capacity, assignment, &proven);
+    if (count <= MAX_EXACT_PACK_ITEMS) {
+      printf("  [信息] 精确搜索%s\n",
+             proven ? "完成，结果为最优" : "达到节点上限，结果未必最优");
+    }
+    return group_count;
+  }
+  return pack_best_fit(sizes, count, capacity, assignment);
+}
+
+int pack_items(const long long *sizes, int count, long long capacity,
+               int *assignment, PackStrategy *used) {
+  if (g_run_options.pack_strategy != PACK_AUTO) {
+    *used = g_run_options.pack_strategy;
+    return pack_with_strategy(*used, sizes, count, capacity, assignment);
+  }
+  int lower_bound = pack_lower_bound(sizes, count, capacity);
+  int *candidate = (int *)safe_malloc(sizeof(int) * (count + 1));
+  int best_count = -1;
+  printf("[处理] 比较装箱策略 (下界 %d 个分组):\n", lower_bound);
+  for (int s = PACK_BEST_FIT_DECREASING; s < PACK_AUTO; s++) {
+    double start = get_time_seconds();
+    int group_count =
+        pack_with_strategy((PackStrategy)s, sizes, count, capacity, candidate);
+    printf("  %-4s %d 个分组 (%.3f 秒)\n", pack_strategy_name((PackStrategy)s),
+           group_count, get_time_seconds() - start);
+    if (best_count < 0 || group_count < best_count) {
+      best_count = group_count;
+      *used = (PackStrategy)s;
+      memcpy(assignment, candidate, sizeof(int) * count);
+    }
+  }
+  free(candidate);
+  return best_count;
+}
+
+int compare_pack_candidates(const void *a, const void *b) {
+  const PackCandidate *candidate1 = (const PackCandidate *)a;
+  const PackCandidate *candidate2 = (const PackCandidate *)b;
+  if (candidate1->size > candidate2->size)
+    return -1;
+  if (candidate1->size < candidate2->size)
+    return 1;
+  return candidate1->item - candidate2->item;
+}
+
+void print_packing_report(const GroupResult *result, PackStrategy strategy,
+                          int lower_bound) {
+  double fill_total = 0, fill_min = 0;
+  for (int i = 0; i < result->group_count; i++) {
+    double fill = (double)result->groups[i].packed_size / MAX_GROUP_SIZE * 100;
+    fill_total += fill;
+    if (i == 0 || fill < fill_min) {
+      fill_min = fill;
+    }
+  }
+  printf("[统计] 装箱策略: %s, 分组数 %d, 下界 %d, 平均填充率 %.1f%%, "
+         "最低填充率 %.1f%%\n",
+         pack_strategy_name(strategy), result->group_count, lower_bound,
+         result->group_count > 0 ? fill_total / result->group_count : 0.0,
+         fill_min);
+}
+
+unsigned long long hash_file_content(const char *path, int *ok) {
+  *ok = 0;
+  const wchar_t *wpath = path_to_wide(path, 0);
+  if (!wpath) {
+    return 0;
+  }
+  HANDLE file = CreateFileW(wpath, GENERIC_READ, FILE_SHARE_READ, NULL,
+                            OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+  if (file == INVALID_HANDLE_VALUE) {
+    return 0;
+  }
+  BYTE *buffer = (BYTE *)safe_malloc(DEDUP_READ_SIZE);
+  Xxh64State state;
+  xxh64_init(&state);
+  DWORD bytes_read = 0;
+  int failed = 0;
+  while (1) {
+    if (!ReadFile(file, buffer, DEDUP_READ_SIZE, &bytes_read, NULL)) {
+      failed = 1;
+      break;
+    }
+    if (bytes_read == 0) {
+      break;
+    }
+    xxh64_update(&state, buffer, bytes_read);
+  }
+  free(buffer);
+  CloseHandle(file);
+  if (failed) {
+    return 0;
+  }
+  *ok = 1;
+  return xxh64_digest(&state);
+}
+
+int file_contents_equal(const char *path1, const char *path2) {
+  const wchar_t *wpath1 = path_to_wide(path1, 0);
+  const wchar_t *wpath2 = path_to_wide(path2, 1);
+  if (!wpath1 || !wpath2) {
+    return 0;
+  }
+  HANDLE file1 = CreateFileW(wpath1, GENERIC_READ, FILE_SHARE_READ, NULL,
+                             OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+  if (file1 == INVALID_HANDLE_VALUE) {
+    return 0;
+  }
+  HANDLE file2 = CreateFileW(wpath2, GENERIC_READ, FILE_SHARE_READ, NULL,
+                             OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+  if (file2 == INVALID_HANDLE_VALUE) {
+    CloseHandle(file1);
+    return 0;
+  }
+  BYTE *buffer1 = (BYTE *)safe_malloc(DEDUP_READ_SIZE);
+  BYTE *buffer2 = (BYTE *)safe_malloc(DEDUP_READ_SIZE);
+  int equal = 1;
+  while (equal) {
+    DWORD read1 = 0, read2 = 0;
+    if (!ReadFile(file1, buffer1, DEDUP_READ_SIZE, &read1, NULL) ||
+        !ReadFile(file2, buffer2, DEDUP_READ_SIZE, &read2, NULL) ||
+        read1 != read2 || memcmp(buffer1, buffer2, read1) != 0) {
+      equal = 0;
+    } else if (read1 == 0) {
+      break;
+    }
+  }
+  free(buffer1);
+  free(buffer2);
+  CloseHandle(file1);
+  CloseHandle(file2);
+  return equal;
+}
+
+DWORD WINAPI dedup_hash_worker(LPVOID param) {
+  DedupHashJob *job = (DedupHashJob *)param;
+  while (1) {
+    LONG index = InterlockedIncrement(&job->next) - 1;
+    if (index >= job->todo_count) {
+      break;
+    }
+    DedupEntry *entry = &job->entries[job->todo[index]];
+    entry->hash =
+        hash_file_content(item_path(&job->items[entry->item]), &entry->hashed);
+  }
+  return 0;
+}
+
+int compare_dedup_entries(const void *a, const void *b) {
+  const DedupEntry *entry1 = (const DedupEntry *)a;
+  const DedupEntry *entry2 = (const DedupEntry *)b;
+  if (entry1->size != entry2->size)
+    return entry1->size < entry2->size ? -1 : 1;
+  if (entry1->hashed != entry2->hashed)
+    return entry2->hashed - entry1->hashed;
+  if (entry1->hash != entry2->hash)
+    return entry1->hash < entry2->hash ? -1 : 1;
+  return entry1->item - entry2->item;
+}
+
+int find_duplicate_files(const FileItem *items, int item_count,
+                         int *duplicate_of) {
+  double start_time = get_time_seconds();
+  DedupEntry *entries =
+      (DedupEntry *)safe_malloc(sizeof(DedupEntry) * (item_count + 1));
+  int entry_count = 0;
+  for (int i = 0; i < item_count; i++) {
+    duplicate_of[i] = -1;
+    if (items[i].type == TYPE_FILE && items[i].size >= DEDUP_MIN_FILE_SIZE) {
+      entries[entry_count].size = items[i].size;
+      entries[entry_count].hash = 0;
+      entries[entry_count].item = i;
+      entries[entry_count].hashed = 0;
+      entry_count++;
+    }
+  }
+  qsort(entries, entry_count, sizeof(DedupEntry), compare_dedup_entries);
+  DedupHashJob job = {0};
+  job.items = items;
+  job.entries = entries;
+  job.todo = (int *)safe_malloc(sizeof(int) * (entry_count + 1));
+  for (int i = 0; i < entry_count; i++) {
+    if ((i > 0 && entries[i - 1].size == entries[i].size) ||
+        (i + 1 < entry_count && entries[i + 1].size == entries[i].size)) {
+      job.todo[job.todo_count++] = i;
+    }
+  }
+  int thread_count = get_scan_thread_count();
+  if (thread_count > job.todo_count) {
+    thread_count = job.todo_count > 0 ? job.todo_count : 1;
+  }
+  HANDLE *threads = (HANDLE *)safe_malloc(sizeof(HANDLE) * thread_count);
+  for (int i = 1; i < thread_count; i++) {
+    threads[i] = CreateThread(NULL, 0, dedup_hash_worker, &job, 0, NULL);
+  }
+  dedup_hash_worker(&job);
+  for (int i = 1; i < thread_count; i++) {
+    if (threads[i]) {
+      WaitForSingleObject(threads[i], INFINITE);
+      CloseHandle(threads[i]);
+    }
+  }
+  free(threads);
+  qsort(entries, entry_count, sizeof(DedupEntry), compare_dedup_entries);
+  int duplicate_count = 0;
+  int mismatch_count = 0;
+  long long duplicate_size = 0;
+  int group_start = 0;
+  for (int i = 1; i < entry_count; i++) {
+    DedupEntry *previous = &entries[i - 1];
+    if (!entries[i].hashed || !previous->hashed ||
+        entries[i].size != previous->size ||
+        entries[i].hash != previous->hash) {
+      group_start = i;
+      continue;
+    }
+    const char *path = item_path(&items[entries[i].item]);
+    for (int j = group_start; j < i; j++) {
+      int canonical = entries[j].item;
+      if (duplicate_of[canonical] >= 0) {
+        continue;
+      }
+      if (file_contents_equal(item_path(&items[canonical]), path)) {
+        duplicate_of[entries[i].item] = canonical;
+        duplicate_count++;
+        duplicate_size += entries[i].size;
+        break;
+      }
+    }
+    if (duplicate_of[entries[i].item] < 0) {
+      mismatch_count++;
+    }
+  }
+  char size_str[32];
+  format_size(duplicate_size, size_str, sizeof(size_str));
+  printf("[去重] 哈希 %d 个同大小候选文件, 发现 %d 个重复文件 (%s), "
+         "耗时 %.3f 秒\n",
+         job.todo_count, duplicate_count, size_str,
+         get_time_seconds() - start_time);
+  if (mismatch_count > 0) {
+    printf("[去重] %d 个文件哈希相同但内容不同，未视为重复\n",
+           mismatch_count);
+  }
+  free(job.todo);
+  free(entries);
+  return duplicate_count;
+}
+
+int compare_dedup_owners(const void *a, const void *b) {
+  const DedupOwner *owner1 = (const DedupOwner *)a;
+  const DedupOwner *owner2 = (const DedupOwner *)b;
+  if (owner1->canonical != owner2->canonical)
+    return owner1->canonical - owner2->canonical;
+  if (owner1->owner != owner2->owner)
+    return owner1->owner - owner2->owner;
+  return owner1->item - owner2->item;
+}
+
+int *resolve_duplicate_files(FileItem *items, int item_count,
+                             PathTrie *placed_dirs) {
+  int *attach_to = (int *)safe_malloc(sizeof(int) * (item_count + 1));
+  if (find_duplicate_files(items, item_count, attach_to) == 0) {
+    return attach_to;
+  }
+  DedupOwner *owned =
+      (DedupOwner *)safe_malloc(sizeof(DedupOwner) * (item_count + 1));
+  int owned_count = 0;
+  long long saved_size = 0;
+  for (int i = 0; i < item_count; i++) {
+    int canonical = attach_to[i];
+    if (canonical < 0) {
+      continue;
+    }
+    int owner = path_trie_find_container(placed_dirs, item_path(&items[i]));
+    int canonical_owner =
+        path_trie_find_container(placed_dirs, item_path(&items[canonical]));
+    if (owner < 0) {
+      attach_to[i] = canonical_owner >= 0 ? canonical_owner : canonical;
+      saved_size += items[i].packed_size;
+      continue;
+    }
+    attach_to[i] = -1;
+    if (owner == canonical_owner) {
+      items[owner].packed_size -= items[i].packed_size;
+      saved_size += items[i].packed_size;
+    } else {
+      owned[owned_count].canonical = canonical;
+      owned[owned_count].owner = owner;
+      owned[owned_count].item = i;
+      owned_count++;
+    }
+  }
+  qsort(owned, owned_count, sizeof(DedupOwner), compare_dedup_owners);
+  for (int i = 1; i < owned_count; i++) {
+    if (owned[i].canonical == owned[i - 1].canonical &&
+        owned[i].owner == owned[i - 1].owner) {
+      items[owned[i].owner].packed_size -= items[owned[i].item].packed_size;
+      saved_size += items[owned[i].item].packed_size;
+    }
+  }
+  free(owned);
+  char size_str[32];
+  format_size(saved_size, size_str, sizeof(size_str));
+  printf("[去重] 重复内容不再占用分组容量, 共节省 %s\n", size_str);
+  return attach_to;
+}
+
+GroupResult group_files(FileItem *items, int item_count) {
+  GroupResult result = {0};
+  arena_init(&result.arena, 256 * 1024);
+  printf("[处理] 正在排序 %d 个项...\n", item_count);
+  qsort(items, item_count, sizeof(FileItem), compare_items);
+  printf("[处理] 开始分组处理...\n");
+  PackCandidate *candidates =
+      (PackCandidate *)safe_malloc(sizeof(PackCandidate) * (item_count + 1));
+  int candidate_count = 0;
+  PathTrie placed_dirs;
+  path_trie_init(&placed_dirs);
+  for (int i = 0; i < item_count; i++) {
+    if (items[i].type == TYPE_DIRECTORY &&
+        items[i].packed_size <= MAX_GROUP_SIZE) {
+      path_trie_insert(&placed_dirs, item_path(&items[i]), i);
+      candidates[candidate_count].item = i;
+      candidate_count++;
+    }
+  }
+  int *attach_to = NULL;
+  if (g_run_options.dedup) {
+    attach_to = resolve_duplicate_files(items, item_count, &placed_dirs);
+  }
+  for (int i = 0; i < item_count; i++) {
+    if (i % 1000 == 0 || i == item_count - 1) {
+      draw_progress_bar(i + 1, item_count, "分组进度");
+    }
+    if (items[i].type == TYPE_DIRECTORY) {
+      continue;
+    }
+    if (path_trie_find_container(&placed_dirs, item_path(&items[i])) >= 0) {
+      printf("  跳过已被包含的文件: %s\n", item_path(&items[i]));
+      continue;
+    }
+    if (attach_to && attach_to[i] >= 0) {
+      continue;
+    }
+    candidates[candidate_count].item = i;
+    candidate_count++;
+  }
+  path_trie_free(&placed_dirs);
+  for (int i = 0; i < candidate_count; i++) {
+    candidates[i].size = items[candidates[i].item].packed_size;
+  }
+  qsort(candidates, candidate_count, sizeof(PackCandidate),
+        compare_pack_candidates);
+  long long *sizes =
+      (long long *)safe_malloc(sizeof(long long) * (candidate_count + 1));
+  int *assignment = (int *)safe_malloc(sizeof(int) * (candidate_count + 1));
+  for (int i = 0; i < candidate_count; i++) {
+    sizes[i] = candidates[i].size;
+  }
+  PackStrategy strategy;
+  int group_count = pack_items(sizes, candidate_count, MAX_GROUP_SIZE,
+                               assignment, &strategy);
+  while (result.group_count < group_count) {
+    append_empty_group(&result);
+  }
+  for (int i = 0; i < candidate_count; i++) {
+    FileItem *item = &items[candidates[i].item];
+    FileGroup *group = &result.groups[assignment[i]];
+    if (item->type == TYPE_DIRECTORY) {
+      if (group->count == 0) {
+        printf("  创建新分组 %d 并添加文件夹: %s (%lld bytes)\n",
+               assignment[i] + 1, item_path(item), item->size);
+      } else {
+        printf("  添加文件夹到分组 %d: %s (%lld bytes)\n", assignment[i] + 1,
+               item_path(item), item->size);
+      }
+    }
+    group_append_item(&result.arena, group, item);
+  }
+  if (attach_to) {
+    int *item_group = (int *)safe_malloc(sizeof(int) * (item_count + 1));
+    for (int i = 0; i < candidate_count; i++) {
+      item_group[candidates[i].item] = assignment[i];
+    }
+    for (int i = 0; i < item_count; i++) {
+      if (attach_to[i] >= 0) {
+        FileItem duplicate = items[i];
+        duplicate.packed_size = 0;
+        group_append_item(&result.arena,
+                          &result.groups[item_group[attach_to[i]]],
+                          &duplicate);
+      }
+    }
+    free(item_group);
+    free(attach_to);
+  }
+  char *placed = (char *)calloc(item_count + 1, 1);
+  for (int i = 0; placed && i < candidate_count; i++) {
+    placed[candidates[i].item] = 1;
+  }
+  for (int i = 0; placed && i < item_count; i++) {
+    if (items[i].type == TYPE_DIRECTORY && !placed[i]) {
+      printf("\n  [错误] 文件夹已剪除但未分配到任何分组: %s (估算 %lld "
+             "bytes)\n",
+             item_path(&items[i]), items[i].packed_size);
+    }
+  }
+  free(placed);
+  int lower_bound = pack_lower_bound(sizes, candidate_count, MAX_GROUP_SIZE);
+  free(assignment);
+  free(sizes);
+  free(candidates);
+  printf("\n[完成] 分组完成，共 %d 个分组\n", result.group_count);
+  printf("[统计] 分组详情:\n");
+  for (int i = 0; i < result.group_count; i++) {
+    int file_count = 0, dir_count = 0;
+    for (int j = 0; j < result.groups[i].count; j++) {
+      if (result.groups[i].items[j].type == TYPE_FILE) {
+        file_count++;
+      } else {
+        dir_count++;
+      }
+    }
+    char size_str[32];
+    format_size(result.groups[i].total_size, size_str, sizeof(size_str));
+    printf("  分组 %d: %s (%d文件, %d文件夹, 填充率 %.1f%%)\n", i + 1,
+           size_str, file_count, dir_count,
+           (double)result.groups[i].packed_size / MAX_GROUP_SIZE * 100);
+    if (g_run_options.estimate_pack) {
+      char packed_str[32];
+      format_size(result.groups[i].packed_size, packed_str,
+                  sizeof(packed_str));
+      printf("    估算打包大小: %s\n", packed_str);
+    }
+  }
+  print_packing_report(&result, strategy, lower_bound);
+  return result;
+}
+
+void print_groups(const GroupResult *result) {
+  printf("\n========================================\n");
+  printf("              分组结果\n");
+  printf("========================================\n\n");
+  int max_groups_to_show = 10;
+  int groups_to_show = result->group_count < max_groups_to_show
+                           ? result->group_count
+                           : max_groups_to_show;
+  for (int i = 0; i < groups_to_show; i++) {
+    print_detailed_group_info(&result->groups[i], i);
+  }
+  if (result->group_count > max_groups_to_show) {
+    printf("[信息] 还有 %d 个分组未显示\n\n",
+           result->group_count - max_groups_to_show);
+  }
+}
+
+int clear_directory(const wchar_t *wdir_path) {
+  printf("    正在清空目录内容...\n");
+  wchar_t search_path[MAX_PATH_LENGTH];
+  if (!safe_path_join(search_path, MAX_PATH_LENGTH, wdir_path, L"*")) {
+    printf("    [错误] 无法构造搜索路径\n");
+    return 0;
+  }
+  WIN32_FIND_DATAW find_data;
+  HANDLE hFind = FindFirstFileW(search_path, &find_data);
+  if (hFind == INVALID_HANDLE_VALUE) {
+    return 1;
+  }
+  int success = 1;
+  do {
+    if (wcscmp(find_data.cFileName, L".") == 0 ||
+        wcscmp(find_data.cFileName, L"..") == 0) {
+      continue;
+    }
+    wchar_t full_path[MAX_PATH_LENGTH];
+    if (!safe_path_join(full_path, MAX_PATH_LENGTH, wdir_path,
+                        find_data.cFileName)) {
+      success = 0;
+      continue;
+    }
+    if (find_data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) {
+      if (!clear_directory(full_path)) {
+        success = 0;
+      }
+      if (!RemoveDirectoryW(full_path)) {
+        DWORD error = GetLastError();
+        printf("    [警告] 无法删除目录 %ls (错误: %lu)\n", find_data.cFileName,
+               error);
+        success = 0;
+      }
+    } else {
+      if (!DeleteFileW(full_path)) {
+        DWORD error = GetLastError();
+        printf("    [警告] 无法删除文件 %ls (错误: %lu)\n", find_data.cFileName,
+               error);
+        success = 0;
+      }
+    }
+  } while (FindNextFileW(hFind, &find_data));
+  FindClose(hFind);
+  return success;
+}
+
+const char *copy_method_name(CopyMethod method) {
+  switch (method) {
+  case COPY_METHOD_CLONE:
+    return "clone";
+  case COPY_METHOD_COPY_RANGE:
+    return "copy-range";
+  case COPY_METHOD_SENDFILE:
+    return "sendfile";
+  default:
+    return "buffer";
+  }
+}
+
+int parse_copy_method(const char *name, CopyMethod *method) {
+  for (int m = 0; m < COPY_METHOD_COUNT; m++) {
+    if (strcmp(name, copy_method_name((CopyMethod)m)) == 0) {
+      *method = (CopyMethod)m;
+      return 1;
+    }
+  }
+  return 0;
+}
+
+void copy_engine_init(CopyEngine *engine) {
+  memset(engine, 0, sizeof(CopyEngine));
+  for (int m = 0; m < COPY_METHOD_BUFFER; m++) {
+#ifdef _WIN32
+    engine->disabled[m] = 1;
+#else
+    engine->disabled[m] = m < (int)g_run_options.split_copy;
+#endif
+  }
+}
+
+void copy_engine_free(CopyEngine *engine) {
+  free(engine->buffer);
+  engine->buffer = NULL;
+}
+
+long long copy_engine_try(CopyEngine *engine, CopyMethod method,
+                          HANDLE source, long long source_offset,
+                          HANDLE target, long long target_offset,
+                          long long length, Xxh64State *hash) {
+  long long copied = 0;
+#ifndef _WIN32
+  int source_fd = ((CompatHandle *)source)->fd;
+  int target_fd = ((CompatHandle *)target)->fd;
+  if (method == COPY_METHOD_CLONE) {
+    struct file_clone_range range;
+    range.src_fd = source_fd;
+    range.src_offset = (unsigned long long)source_offset;
+    range.src_length = (unsigned long long)length;
+    range.dest_offset = (unsigned long long)target_offset;
+    if (ioctl(target_fd, FICLONERANGE, &range) == 0) {
+      return length;
+    }
+    if (errno != EINVAL) {
+      engine->disabled[method] = 1;
+    }
+    return 0;
+  }
+  if (method == COPY_METHOD_COPY_RANGE) {
+    loff_t in = source_offset, out = target_offset;
+    while (copied < length) {
+      long long chunk = length - copied;
+      ssize_t result = copy_file_range(
+          source_fd, &in, target_fd, &out,
+          (size_t)(chunk > SPLIT_COPY_CHUNK ? SPLIT_COPY_CHUNK : chunk), 0);
+      if (result < 0 && errno == EINTR) {
+        continue;
+      }
+      if (result <= 0) {
+        if (result < 0 && copied == 0) {
+          engine->disabled[method] = 1;
+        }
+        break;
+      }
+      copied += result;
+    }
+    return copied;
+  }
+  if (method == COPY_METHOD_SENDFILE) {
+    if (lseek(target_fd, target_offset, SEEK_SET) < 0) {
+      return 0;
+    }
+    off_t in = source_offset;
+    while (copied < length) {
+      long long chunk = length - copied;
+      ssize_t result =
+          sendfile(target_fd, source_fd, &in,
+                   (size_t)(chunk > SPLIT_COPY_CHUNK ? SPLIT_COPY_CHUNK : chunk));
+      if (result < 0 && errno == EINTR) {
+        continue;
+      }
+      if (result <= 0) {
+        if (result < 0 && copied == 0) {
+          engine->disabled[method] = 1;
+        }
+        break;
+      }
+      copied += result;
+    }
+    return copied;
+  }
+#endif
+  if (!engine->buffer) {
+    engine->buffer = (BYTE *)safe_malloc(SPLIT_COPY_BUFFER_SIZE);
+  }
+  while (copied < length) {
+    DWORD to_read = (DWORD)(length - copied > SPLIT_COPY_BUFFER_SIZE
+                                ? SPLIT_COPY_BUFFER_SIZE
+                                : length - copied);
+    DWORD bytes_read, bytes_written;
+    OVERLAPPED overlapped;
+    split_part_positions(&overlapped, source_offset + copied);
+    if (!ReadFile(source, engine->buffer, to_read, &bytes_read, &overlapped) ||
+        bytes_read == 0) {
+      printf("    [错误] 读取源文件失败\n");
+      return -1;
+    }
+    split_part_positions(&overlapped, target_offset + copied);
+    if (!WriteFile(target, engine->buffer, bytes_read, &bytes_written,
+                   &overlapped) ||
+        bytes_written != bytes_read) {
+      printf("    [错误] 写入部分文件失败\n");
+      return -1;
+    }
+    if (hash) {
+      xxh64_update(hash, engine->buffer, bytes_read);
+    }
+    copied += bytes_read;
+  }
+  return copied;
+}
+
+int copy_engine_copy(CopyEngine *engine, HANDLE source,
+                     long long source_offset, HANDLE target,
+                     long long target_offset, long long length,
+                     Xxh64State *hash) {
+  long long done = 0;
+  for (int m = 0; m < COPY_METHOD_COUNT && done < length; m++) {
+    if (engine->disabled[m]) {
+      continue;
+    }
+    long long copied =
+        copy_engine_try(engine, (CopyMethod)m, source, source_offset + done,
+                        target, target_offset + done, length - done, hash);
+    if (copied < 0) {
+      return 0;
+    }
+    if (hash && copied > 0 && m != COPY_METHOD_BUFFER) {
+      if (!engine->buffer) {
+        engine->buffer = (BYTE *)safe_malloc(SPLIT_COPY_BUFFER_SIZE);
+      }
+      if (!hash_file_update(source, source_offset + done, copied,
+                            engine->buffer, hash)) {
+        printf("    [错误] 读取源文件失败\n");
+        return 0;
+      }
+    }
+    engine->bytes[m] += copied;
+    done += copied;
+  }
+  return done == length;
+}
+
+void copy_engine_report(const CopyEngine *engine) {
+  printf("    复制方式:");
+  for (int m = 0; m < COPY_METHOD_COUNT; m++) {
+    if (engine->bytes[m] > 0) {
+      char size_str[32];
+      format_size(engine->bytes[m], size_str, sizeof(size_str));
+      printf(" %s %s", copy_method_name((CopyMethod)m), size_str);
+    }
+  }
+  printf("\n");
+}
+
+int cdc_params_prepare(CdcParams *params) {
+  if (params->min_size < CDC_MIN_CHUNK ||
+      params->min_size >= params->avg_size ||
+      params->avg_size >= params->max_size ||
+      params->max_size > MAX_FILE_SIZE) {
+    return 0;
+  }
+  int bits = 0;
+  while ((2LL << bits) <= params->avg_size) {
+    bits++;
+  }
+  params->mask_small = ~0ULL << (64 - (bits + 2));
+  params->mask_large = ~0ULL << (64 - (bits - 2));
+  unsigned long long state = CDC_GEAR_SEED;
+  for (int i = 0; i < 256; i++) {
+    unsigned long long z = (state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    g_gear[i] = z ^ (z >> 31);
+    g_gear_shifted[i] = g_gear[i] << 1;
+  }
+  return 1;
+}
+
+long long cdc_next_cut(const BYTE *scan, long long length,
+                       const CdcParams *params) {
+  if (length <= params->min_size) {
+    return length;
+  }
+  long long max_size = length < params->max_size ? length : params->max_size;
+  long long normal_size =
+      length < params->avg_size ? length : params->avg_size;
+  unsigned long long mask_small_shifted = params->mask_small << 1;
+  unsigned long long mask_large_shifted = params->mask_large << 1;
+  unsigned long long fp = 0;
+  long long skip = params->min_size;
+  long long i = 0;
+  for (; skip + i + 1 < normal_size; i += 2) {
+    fp = (fp << 2) + g_gear_shifted[scan[i]];
+    if (!(fp & mask_small_shifted)) {
+      return skip + i + 1;
+    }
+    fp += g_gear[scan[i + 1]];
+    if (!(fp & params->mask_small)) {
+      return skip + i + 2;
+    }
+  }
+  for (; skip + i + 1 < max_size; i += 2) {
+    fp = (fp << 2) + g_gear_shifted[scan[i]];
+    if (!(fp & mask_large_shifted)) {
+      return skip + i + 1;
+    }
+    fp += g_gear[scan[i + 1]];
+    if (!(fp & params->mask_large)) {
+      return skip + i + 2;
+    }
+  }
+  return max_size;
+}
+
+long long *plan_split_parts(const char *file_path, long long file_size,
+                            int *part_count) {
+  *part_count = 0;
+  if (g_run_options.split_mode == SPLIT_MODE_FIXED) {
+    int count = (int)((file_size + SPLIT_PART_SIZE - 1) / SPLIT_PART_SIZE);
+    long long *sizes = (long long *)safe_malloc(sizeof(long long) * count);
+    for (int i = 0; i < count; i++) {
+      sizes[i] = i == count - 1 ? file_size - SPLIT_PART_SIZE * i
+                                : SPLIT_PART_SIZE;
+    }
+    *part_count = count;
+    return sizes;
+  }
+  const wchar_t *wpath = path_to_wide(file_path, 0);
+  HANDLE file = wpath ? CreateFileW(wpath, GENERIC_READ, FILE_SHARE_READ,
+                                    NULL, OPEN_EXISTING,
+                                    FILE_FLAG_SEQUENTIAL_SCAN, NULL)
+                      : INVALID_HANDLE_VALUE;
+  if (file == INVALID_HANDLE_VALUE) {
+    printf("    [错误] 无法打开源文件进行分块 (错误: %lu)\n", GetLastError());
+    return NULL;
+  }
+  LARGE_INTEGER actual_size;
+  if (!GetFileSizeEx(file, &actual_size) || actual_size.QuadPart != file_size ||
+      file_size <= 0) {
+    printf("    [错误] 源文件大小已变化，无法分块\n");
+    CloseHandle(file);
+    return NULL;
+  }
+  double start_time = get_time_seconds();
+  const CdcParams *cdc = &g_run_options.cdc;
+  long long window_size = cdc->max_size - cdc->min_size + SPLIT_COPY_BUFFER_SIZE;
+  BYTE *window = (BYTE *)safe_malloc((size_t)window_size);
+  long long window_offset = 0, window_length = 0;
+  int capacity = (int)(file_size / cdc->avg_size) + 16;
+  long long *sizes = (long long *)safe_malloc(sizeof(long long) * capacity);
+  long long offset = 0;
+  while (offset < file_size) {
+    long long remaining = file_size - offset;
+    long long scan_start = offset + cdc->min_size;
+    long long scan_end =
+        offset + (remaining < cdc->max_size ? remaining : cdc->max_size);
+    if (scan_end > scan_start) {
+      long long keep = window_offset + window_length - scan_start;
+      if (keep > 0) {
+        memmove(window, window + (scan_start - window_offset), (size_t)keep);
+      }
+      window_offset = scan_start;
+      window_length = keep > 0 ? keep : 0;
+      while (window_offset + window_length < scan_end) {
+        long long room = window_size - window_length;
+        DWORD bytes_read = 0;
+        OVERLAPPED position;
+        split_part_positions(&position, window_offset + window_length);
+        if (!ReadFile(file, window + window_length,
+                      (DWORD)(room > SPLIT_COPY_BUFFER_SIZE
+                                  ? SPLIT_COPY_BUFFER_SIZE
+                                  : room),
+                      &bytes_read, &position) ||
+            bytes_read == 0) {
+          break;
+        }
+        window_length += bytes_read;
+      }
+      if (window_offset + window_length < scan_end) {
+        printf("    [错误] 读取源文件进行分块失败\n");
+        free(sizes);
+        sizes = NULL;
+        break;
+      }
+    }
+    if (*part_count >= capacity) {
+      capacity *= 2;
+      sizes = (long long *)safe_realloc(sizes, sizeof(long long) * capacity);
+    }
+    long long cut = cdc_next_cut(window, remaining, cdc);
+    sizes[(*part_count)++] = cut;
+    offset += cut;
+  }
+  free(window);
+  if (sizes) {
+    double elapsed = get_time_seconds() - start_time;
+    printf("    内容定义分块: %d 个块, 平均 %.1f MB, 分块耗时 %.3f 秒 "
+           "(%.1f MB/s)\n",
+           *part_count, (double)file_size / *part_count / (1024 * 1024),
+           elapsed,
+           elapsed > 0 ? file_size / elapsed / (1024 * 1024) : 0.0);
+  } else {
+    *part_count = 0;
+  }
+  CloseHandle(file);
+  return sizes;
+}
+
+void split_part_positions(OVERLAPPED *overlapped, long long offset) {
+  memset(overlapped, 0, sizeof(OVERLAPPED));
+  overlapped->Offset = (DWORD)(offset & 0xFFFFFFFF);
+  overlapped->OffsetHigh = (DWORD)(offset >> 32);
+}
+
+int hash_file_update(HANDLE file, long long offset, long long length,
+                     BYTE *buffer, Xxh64State *state) {
+  while (length > 0) {
+    DWORD chunk = length > SPLIT_COPY_BUFFER_SIZE ? SPLIT_COPY_BUFFER_SIZE
+                                                  : (DWORD)length;
+    OVERLAPPED position;
+    split_part_positions(&position, offset);
+    DWORD read = 0;
+    if (!ReadFile(file, buffer, chunk, &read, &position) || read == 0) {
+      return 0;
+    }
+    xxh64_update(state, buffer, read);
+    offset += read;
+    length -= read;
+  }
+  return 1;
+}
+
+int hash_file_range(HANDLE file, long long offset, long long length,
+                    BYTE *buffer, unsigned long long *hash) {
+  Xxh64State state;
+  xxh64_init(&state);
+  if (!hash_file_update(file, offset, length, buffer, &state)) {
+    return 0;
+  }
+  *hash = xxh64_digest(&state);
+  return 1;
+}
+
+int split_manifest_write(const char *split_dir, const SplitManifest *manifest,
+                         long long *written) {
+  char manifest_path[MAX_PATH_LENGTH];
+  snprintf(manifest_path, MAX_PATH_LENGTH, "%s\\%s", split_dir,
+           SPLIT_MANIFEST_NAME);
+  const wchar_t *wmanifest_path = path_to_wide(manifest_path, 0);
+  FILE *file = wmanifest_path ? _wfopen(wmanifest_path, L"wb") : NULL;
+  if (!file) {
+    return 0;
+  }
+  fprintf(file, "split-manifest %d\n", SPLIT_MANIFEST_VERSION);
+  fprintf(file, "source_size %lld\n", manifest->source_size);
+  fprintf(file, "source_mtime %llu\n", manifest->source_mtime);
+  fprintf(file, "file_hash %016llx\n", manifest->file_hash);
+  fprintf(file, "part_count %d\n", manifest->part_count);
+  for (int i = 0; i < manifest->part_count; i++) {
+    fprintf(file, "part %lld %016llx %s\n", manifest->parts[i].size,
+            manifest->parts[i].hash, manifest->parts[i].name);
+  }
+  *written = ftell(file);
+  int ok = !ferror(file);
+  if (fclose(file) != 0) {
+    ok = 0;
+  }
+  return ok;
+}
+
+int split_manifest_read(const char *split_dir, SplitManifest *manifest) {
+  memset(manifest, 0, sizeof(SplitManifest));
+  char manifest_path[MAX_PATH_LENGTH];
+  snprintf(manifest_path, MAX_PATH_LENGTH, "%s\\%s", split_dir,
+           SPLIT_MANIFEST_NAME);
+  const wchar_t *wmanifest_path = path_to_wide(manifest_path, 0);
+  FILE *file = wmanifest_path ? _wfopen(wmanifest_path, L"rb") : NULL;
+  if (!file) {
+    return 0;
+  }
+  return split_manifest_parse(file, manifest);
+}
+
+int split_manifest_check(const char *file_path, const char *split_dir,
+                         long long file_size, const SplitManifest *manifest,
+                         ItemList *parts) {
+  if (manifest->source_size != file_size) {
+    printf("    拆分清单大小不符: 原文件 %lld bytes, 清单记录 %lld bytes\n",
+           file_size, manifest->source_size);
+    return 0;
+  }
+  WIN32_FILE_ATTRIBUTE_DATA data;
+  const wchar_t *wfile_path = path_to_wide(file_path, 0);
+  if (wfile_path &&
+      GetFileAttributesExW(wfile_path, GetFileExInfoStandard, &data) &&
+      filetime_to_u64(&data.ftLastWriteTime) != manifest->source_mtime) {
+    printf("    原文件修改时间与拆分清单不符，需要重新拆分\n");
+    return 0;
+  }
+  BYTE *buffer = g_run_options.verify_split
+                     ? (BYTE *)safe_malloc(SPLIT_COPY_BUFFER_SIZE)
+                     : NULL;
+  int first_part_item = parts ? parts->count : 0;
+  int ok = 1;
+  char part_path[MAX_PATH_LENGTH];
+  for (int i = 0; ok && i < manifest->part_count; i++) {
+    const ManifestPart *part = &manifest->parts[i];
+    snprintf(part_path, MAX_PATH_LENGTH, "%s\\%s", split_dir, part->name);
+    const wchar_t *wpart = path_to_wide(part_path, 0);
+    if (!wpart ||
+        !GetFileAttributesExW(wpart, GetFileExInfoStandard, &data) ||
+        (data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)) {
+      printf("    缺少拆分文件: %s\n", part_path);
+      ok = 0;
+      break;
+    }
+    ULARGE_INTEGER size;
+    size.LowPart = data.nFileSizeLow;
+    size.HighPart = data.nFileSizeHigh;
+    if ((long long)size.QuadPart != part->size) {
+      printf("    拆分文件大小不符: %s (%llu bytes, 清单记录 %lld bytes)\n",
+             part_path, size.QuadPart, part->size);
+      ok = 0;
+      break;
+    }
+    if (buffer) {
+      HANDLE file = CreateFileW(wpart, GENERIC_READ, FILE_SHARE_READ, NULL,
+                                OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN,
+                                NULL);
+      unsigned long long hash = 0;
+      int hashed = file != INVALID_HANDLE_VALUE &&
+                   hash_file_range(file, 0, part->size, buffer, &hash);
+      if (file != INVALID_HANDLE_VALUE) {
+        CloseHandle(file);
+      }
+      if (!hashed || hash != part->hash) {
+        printf("    拆分文件校验失败: %s\n", part_path);
+        ok = 0;
+        break;
+      }
+    }
+    if (parts) {
+      item_list_add(parts, part_path, part->size, TYPE_FILE);
+    }
+  }
+  free(buffer);
+  if (!ok) {
+    if (parts) {
+      parts->count = first_part_item;
+    }
+    return 0;
+  }
+  if (parts) {
+    snprintf(part_path, MAX_PATH_LENGTH, "%s\\%s", split_dir,
+             SPLIT_MANIFEST_NAME);
+    item_list_add(parts, part_path, manifest->manifest_size, TYPE_FILE);
+  }
+  printf("    拆分清单检查: 原文件 %lld bytes, 共%d个部分, 文件哈希 %016llx%s\n",
+         file_size, manifest->part_count, manifest->file_hash,
+         g_run_options.verify_split ? ", 内容校验通过" : "");
+  return 1;
+}
+
+int split_part_unchanged(SplitWorker *worker, HANDLE source, int index) {
+  SplitJob *job = worker->job;
+  SplitPart *part = &job->parts[index];
+  WIN32_FILE_ATTRIBUTE_DATA data;
+  const wchar_t *wpart = path_to_wide(part->path, 0);
+  if (!wpart || !GetFileAttributesExW(wpart, GetFileExInfoStandard, &data) ||
+      (data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)) {
+    return 0;
+  }
+  ULARGE_INTEGER size;
+  size.LowPart = data.nFileSizeLow;
+  size.HighPart = data.nFileSizeHigh;
+  if ((long long)size.QuadPart != part->size) {
+    return 0;
+  }
+  if (!worker->engine.buffer) {
+    worker->engine.buffer = (BYTE *)safe_malloc(SPLIT_COPY_BUFFER_SIZE);
+  }
+  if (!hash_file_range(source, part->offset, part->size, worker->engine.buffer,
+                       &part->hash)) {
+    return 0;
+  }
+  part->hashed = 1;
+  HANDLE existing = CreateFileW(wpart, GENERIC_READ, FILE_SHARE_READ, NULL,
+                                OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+  if (existing == INVALID_HANDLE_VALUE) {
+    return 0;
+  }
+  unsigned long long hash = 0;
+  int same = hash_file_range(existing, 0, part->size, worker->engine.buffer,
+                             &hash) &&
+             hash == part->hash;
+  CloseHandle(existing);
+  return same;
+}
+
+int compare_split_reuse(const void *a, const void *b) {
+  const SplitReuse *x = (const SplitReuse *)a;
+  const SplitReuse *y = (const SplitReuse *)b;
+  if (x->size != y->size) {
+    return x->size < y->size ? -1 : 1;
+  }
+  if (x->hash != y->hash) {
+    return x->hash < y->hash ? -1 : 1;
+  }
+  return x->index - y->index;
+}
+
+int split_reuse_candidate(const SplitJob *job, const char *split_dir,
+                          SplitReuse *reuse, int first, int last,
+                          const SplitPart *part, BYTE *buffer) {
+  const char *name = strrchr(part->path, '\\') + 1;
+  char old_path[MAX_PATH_LENGTH];
+  while (1) {
+    int best = -1;
+    for (int k = first; k < last; k++) {
+      if (reuse[k].claimed) {
+        continue;
+      }
+      if (strcmp(job->previous->parts[reuse[k].index].name, name) == 0) {
+        best = k;
+        break;
+      }
+      if (best < 0) {
+        best = k;
+      }
+    }
+    if (best < 0) {
+      return -1;
+    }
+    reuse[best].claimed = 1;
+    snprintf(old_path, MAX_PATH_LENGTH, "%s\\%s", split_dir,
+             job->previous->parts[reuse[best].index].name);
+    WIN32_FILE_ATTRIBUTE_DATA data;
+    const wchar_t *wold = path_to_wide(old_path, 0);
+    if (!wold || !GetFileAttributesExW(wold, GetFileExInfoStandard, &data) ||
+        (data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)) {
+      continue;
+    }
+    ULARGE_INTEGER size;
+    size.LowPart = data.nFileSizeLow;
+    size.HighPart = data.nFileSizeHigh;
+    if ((long long)size.QuadPart != part->size) {
+      continue;
+    }
+    if (!g_run_options.verify_split) {
+      return reuse[best].index;
+    }
+    HANDLE existing = CreateFileW(wold, GENERIC_READ, FILE_SHARE_READ, NULL,
+                                  OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN,
+                                  NULL);
+    if (existing == INVALID_HANDLE_VALUE) {
+      continue;
+    }
+    unsigned long long hash = 0;
+    int same = hash_file_range(existing, 0, part->size, buffer, &hash) &&
+               hash == part->hash;
+    CloseHandle(existing);
+    if (same) {
+      return reuse[best].index;
+    }
+  }
+}
+
+int split_plan_reuse(SplitJob *job, const char *split_dir) {
+  const SplitManifest *previous = job->previous;
+  SplitReuse *reuse =
+      (SplitReuse *)safe_malloc(sizeof(SplitReuse) * previous->part_count);
+  for (int j = 0; j < previous->part_count; j++) {
+    reuse[j].size = previous->parts[j].size;
+    reuse[j].hash = previous->parts[j].hash;
+    reuse[j].index = j;
+    reuse[j].claimed = 0;
+  }
+  qsort(reuse, previous->part_count, sizeof(SplitReuse), compare_split_reuse);
+  int *source_of = (int *)safe_malloc(sizeof(int) * job->part_count);
+  BYTE *buffer = g_run_options.verify_split
+                     ? (BYTE *)safe_malloc(SPLIT_COPY_BUFFER_SIZE)
+                     : NULL;
+  for (int i = 0; i < job->part_count; i++) {
+    SplitPart *part = &job->parts[i];
+    source_of[i] = -1;
+    if (!part->hashed) {
+      continue;
+    }
+    int low = 0, high = previous->part_count;
+    while (low < high) {
+      int mid = low + (high - low) / 2;
+      if (reuse[mid].size < part->size ||
+          (reuse[mid].size == part->size && reuse[mid].hash < part->hash)) {
+        low = mid + 1;
+      } else {
+        high = mid;
+      }
+    }
+    int last = low;
+    while (last < previous->part_count && reuse[last].size == part->size &&
+           reuse[last].hash == part->hash) {
+      last++;
+    }
+    source_of[i] = split_reuse_candidate(job, split_dir, reuse, low, last,
+                                         part, buffer);
+  }
+  free(buffer);
+  free(reuse);
+  char old_path[MAX_PATH_LENGTH];
+  char temp_path[MAX_PATH_LENGTH];
+  wchar_t wtemp[MAX_PATH_LENGTH];
+  for (int i = 0; i < job->part_count; i++) {
+    if (source_of[i] < 0) {
+      continue;
+    }
+    const char *old_name = previous->parts[source_of[i]].name;
+    if (strcmp(old_name, strrchr(job->parts[i].path, '\\') + 1) == 0) {
+      continue;
+    }
+    snprintf(old_path, MAX_PATH_LENGTH, "%s\\%s", split_dir, old_name);
+    snprintf(temp_path, MAX_PATH_LENGTH, "%s\\%s.reuse", split_dir, old_name);
+    const wchar_t *wpath = path_to_wide(temp_path, 0);
+    if (!wpath) {
+      source_of[i] = -1;
+      continue;
+    }
+    wcscpy_s(wtemp, MAX_PATH_LENGTH, wpath);
+    wpath = path_to_wide(old_path, 0);
+    if (!wpath || !MoveFileExW(wpath, wtemp, MOVEFILE_REPLACE_EXISTING)) {
+      source_of[i] = -1;
+    }
+  }
+  int moved = 0;
+  for (int i = 0; i < job->part_count; i++) {
+    if (source_of[i] < 0) {
+      continue;
+    }
+    SplitPart *part = &job->parts[i];
+    const char *old_name = previous->parts[source_of[i]].name;
+    if (strcmp(old_name, strrchr(part->path, '\\') + 1) != 0) {
+      snprintf(temp_path, MAX_PATH_LENGTH, "%s\\%s.reuse", split_dir,
+               old_name);
+      const wchar_t *wpath = path_to_wide(temp_path, 0);
+      if (!wpath) {
+        continue;
+      }
+      wcscpy_s(wtemp, MAX_PATH_LENGTH, wpath);
+      wpath = path_to_wide(part->path, 0);
+      if (!wpath || !MoveFileExW(wtemp, wpath, MOVEFILE_REPLACE_EXISTING)) {
+        continue;
+      }
+      printf("    [复用] 部分文件内容未变化，已重命名: %s -> %s (%lld bytes)\n",
+             old_name, part->path, part->size);
+      moved++;
+    } else {
+      printf("    [复用] 部分文件未变化: %s (%lld bytes)\n", part->path,
+             part->size);
+    }
+    part->ok = 1;
+    part->reused = 1;
+  }
+  free(source_of);
+  return moved;
+}
+
+HANDLE split_open_source(const char *path) {
+  HANDLE source = INVALID_HANDLE_VALUE;
+  const wchar_t *wsource = path_to_wide(path, 0);
+  if (wsource) {
+    source = CreateFileW(wsource, GENERIC_READ, FILE_SHARE_READ, NULL,
+                         OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+  }
+  if (source == INVALID_HANDLE_VALUE) {
+    printf("    [错误] 无法打开源文件 (错误: %lu)\n", GetLastError());
+  }
+  return source;
+}
+
+DWORD WINAPI split_hash_worker(LPVOID param) {
+  SplitWorker *worker = (SplitWorker *)param;
+  SplitJob *job = worker->job;
+  HANDLE source = split_open_source(job->source_path);
+  if (source == INVALID_HANDLE_VALUE) {
+    return 0;
+  }
+  if (!worker->engine.buffer) {
+    worker->engine.buffer = (BYTE *)safe_malloc(SPLIT_COPY_BUFFER_SIZE);
+  }
+  while (1) {
+    LONG index = InterlockedIncrement(&job->next) - 1;
+    if (index >= job->part_count) {
+      break;
+    }
+    SplitPart *part = &job->parts[index];
+    part->hashed = hash_file_range(source, part->offset, part->size,
+                                   worker->engine.buffer, &part->hash);
+  }
+  CloseHandle(source);
+  return 0;
+}
+
+void split_run_workers(SplitWorker *workers, HANDLE *threads, int count,
+                       LPTHREAD_START_ROUTINE routine) {
+  workers[0].job->next = 0;
+  for (int i = 1; i < count; i++) {
+    threads[i] = CreateThread(NULL, 0, routine, &workers[i], 0, NULL);
+  }
+  routine(&workers[0]);
+  for (int i = 1; i < count; i++) {
+    if (threads[i]) {
+      WaitForSingleObject(threads[i], INFINITE);
+      CloseHandle(threads[i]);
+    }
+  }
+}
+
+int prune_split_directory(const char *split_dir, const SplitPart *parts,
+                          int part_count) {
+  wchar_t wsplit_dir[MAX_PATH_LENGTH];
+  wchar_t search_path[MAX_PATH_LENGTH];
+  const wchar_t *wdir = path_to_wide(split_dir, 0);
+  if (!wdir) {
+    return 0;
+  }
+  wcscpy_s(wsplit_dir, MAX_PATH_LENGTH, wdir);
+  if (!safe_path_join(search_path, MAX_PATH_LENGTH, wsplit_dir, L"*")) {
+    return 0;
+  }
+  WIN32_FIND_DATAW find_data;
+  HANDLE hFind = FindFirstFileW(search_path, &find_data);
+  if (hFind == INVALID_HANDLE_VALUE) {
+    return 1;
+  }
+  int success = 1;
+  char name[MAX_PATH_LENGTH];
+  do {
+    if (wcscmp(find_data.cFileName, L".") == 0 ||
+        wcscmp(find_data.cFileName, L"..") == 0) {
+      continue;
+    }
+    int is_directory = find_data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY;
+    if (!is_directory &&
+        path_from_wide(name, sizeof(name), find_data.cFileName) > 0) {
+      int keep = strcmp(name, SPLIT_MANIFEST_NAME) == 0;
+      for (int i = 0; i < part_count && !keep; i++) {
+        keep = strcmp(strrchr(parts[i].path, '\\') + 1, name) == 0;
+      }
+      if (keep) {
+        continue;
+      }
+    }
+    wchar_t full_path[MAX_PATH_LENGTH];
+    if (!safe_path_join(full_path, MAX_PATH_LENGTH, wsplit_dir,
+                        find_data.cFileName)) {
+      success = 0;
+      continue;
+    }
+    if (is_directory) {
+      if (!clear_directory(full_path) || !RemoveDirectoryW(full_path)) {
+        printf("    [警告] 无法删除目录 %ls (错误: %lu)\n", find_data.cFileName,
+               GetLastError());
+        success = 0;
+      }
+    } else if (DeleteFileW(full_path)) {
+      printf("    [清理] 删除多余的拆分文件: %ls\n", find_data.cFileName);
+    } else {
+      printf("    [警告] 无法删除文件 %ls (错误: %lu)\n", find_data.cFileName,
+             GetLastError());
+      success = 0;
+    }
+  } while (FindNextFileW(hFind, &find_data));
+  FindClose(hFind);
+  return success;
+}
+
+DWORD WINAPI split_part_worker(LPVOID param) {
+  SplitWorker *worker = (SplitWorker *)param;
+  SplitJob *job = worker->job;
+  HANDLE source = split_open_source(job->source_path);
+  if (source == INVALID_HANDLE_VALUE) {
+    return 0;
+  }
+  while (1) {
+    LONG index = InterlockedIncrement(&job->next) - 1;
+    if (index >= job->part_count) {
+      break;
+    }
+    SplitPart *part = &job->parts[index];
+    if (part->reused) {
+      continue;
+    }
+    if (job->incremental && !job->previous &&
+        split_part_unchanged(worker, source, index)) {
+      part->ok = 1;
+      part->reused = 1;
+      printf("    [复用] 部分文件未变化: %s (%lld bytes)\n", part->path,
+             part->size);
+      continue;
+    }
+    const wchar_t *wpart = path_to_wide(part->path, 0);
+    HANDLE target =
+        wpart ? CreateFileW(wpart, GENERIC_READ | GENERIC_WRITE, 0, NULL,
+                            CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL)
+              : INVALID_HANDLE_VALUE;
+    if (target == INVALID_HANDLE_VALUE) {
+      printf("    [错误] 无法创建部分文件 %s (错误: %lu)\n", part->path,
+             GetLastError());
+      continue;
+    }
+    double start = get_time_seconds();
+    Xxh64State state;
+    xxh64_init(&state);
+    part->ok = copy_engine_copy(&worker->engine, source, part->offset, target,
+                                0, part->size, part->hashed ? NULL : &state);
+    if (part->ok && !part->hashed) {
+      part->hash = xxh64_digest(&state);
+      part->hashed = 1;
+    }
+    CloseHandle(target);
+    part->seconds = get_time_seconds() - start;
+    if (part->ok) {
+      printf("    [成功] 创建部分文件: %s (%lld bytes, %.1f MB/s)\n",
+             part->path, part->size,
+             part->seconds > 0 ? part->size / part->seconds / (1024 * 1024)
+                               : 0.0);
+    } else {
+      printf("    [失败] 创建部分文件失败: %s\n", part->path);
+    }
+  }
+  CloseHandle(source);
+  return 0;
+}
+
+int split_large_file(const char *file_path, const char *split_dir,
+                     long long file_size, ItemList *parts) {
+  printf("    正在处理大文件拆分...\n");
+  if (is_split_complete(file_path, split_dir, file_size, parts)) {
+    printf("    [信息] 拆分目录已存在且完整，跳过拆分步骤\n");
+    return 1;
+  }
+  wchar_t *wfile_path = char_to_wchar(file_path);
+  wchar_t *wsplit_dir = char_to_wchar(split_dir);
+  if (!wfile_path || !wsplit_dir) {
+    printf("    [错误] 无法转换路径编码\n");
+    if (wfile_path)
+      free(wfile_path);
+    if (wsplit_dir)
+      free(wsplit_dir);
+    return 0;
+  }
+  DWORD source_attr = GetFileAttributesW(wfile_path);
+  if (source_attr == INVALID_FILE_ATTRIBUTES) {
+    DWORD error = GetLastError();
+    printf("    [错误] 源文件无法访问: %s (错误: %lu)\n", file_path, error);
+    free(wfile_path);
+    free(wsplit_dir);
+    return 0;
+  }
+  if (source_attr & FILE_ATTRIBUTE_DIRECTORY) {
+    printf("    [错误] 源路径是目录而不是文件: %s\n", file_path);
+    free(wfile_path);
+    free(wsplit_dir);
+    return 0;
+  }
+  WIN32_FILE_ATTRIBUTE_DATA source_data;
+  unsigned long long source_mtime = 0;
+  if (GetFileAttributesExW(wfile_path, GetFileExInfoStandard, &source_data)) {
+    source_mtime = filetime_to_u64(&source_data.ftLastWriteTime);
+  }
+  SplitManifest previous = {0};
+  int incremental = 0;
+  int has_previous = 0;
+  DWORD dir_attr = GetFileAttributesW(wsplit_dir);
+  const char *split_state = "拆分目录已存在但不完整";
+  if (dir_attr != INVALID_FILE_ATTRIBUTES &&
+      (dir_attr & FILE_ATTRIBUTE_DIRECTORY)) {
+    has_previous = split_manifest_read(split_dir, &previous);
+    if (has_previous && (previous.source_size != file_size ||
+                         previous.source_mtime != source_mtime)) {
+      split_state = "原文件已变化，拆分目录已过期";
+    }
+  }
+  if (dir_attr != INVALID_FILE_ATTRIBUTES &&
+      (dir_attr & FILE_ATTRIBUTE_DIRECTORY) &&
+      g_run_options.split_incremental) {
+    printf("    %s，仅重写变化的部分...\n", split_state);
+    incremental = 1;
+    if (has_previous) {
+      char manifest_path[MAX_PATH_LENGTH];
+      snprintf(manifest_path, MAX_PATH_LENGTH, "%s\\%s", split_dir,
+               SPLIT_MANIFEST_NAME);
+      const wchar_t *wmanifest_path = path_to_wide(manifest_path, 0);
+      if (!wmanifest_path || !DeleteFileW(wmanifest_path)) {
+        printf("    [警告] 无法删除旧的拆分清单，改为逐个比较部分文件内容\n");
+        split_manifest_free(&previous);
+        has_previous = 0;
+      }
+    }
+  } else if (dir_attr != INVALID_FILE_ATTRIBUTES &&
+             (dir_attr & FILE_ATTRIBUTE_DIRECTORY)) {
+    printf("    %s，正在清空...\n", split_state);
+    split_manifest_free(&previous);
+    has_previous = 0;
+    if (!clear_directory(wsplit_dir)) {
+      printf("    [警告] 清空拆分目录失败，继续尝试拆分...\n");
+    } else {
+      printf("    [成功] 拆分目录已清空\n");
+    }
+  } else {
+    if (!create_directory_recursive(wsplit_dir)) {
+      printf("    [错误] 无法创建拆分目录\n");
+      free(wfile_path);
+      free(wsplit_dir);
+      return 0;
+    }
+  }
+  int total_parts = 0;
+  long long *part_sizes = plan_split_parts(file_path, file_size, &total_parts);
+  if (!part_sizes || total_parts > SPLIT_MAX_PARTS) {
+    if (part_sizes) {
+      printf("    [错误] 拆分部分过多 (%d > %d)\n", total_parts,
+             SPLIT_MAX_PARTS);
+    }
+    free(part_sizes);
+    split_manifest_free(&previous);
+    free(wfile_path);
+    free(wsplit_dir);
+    return 0;
+  }
+  printf("    文件大小: %lld bytes, 需要拆分成 %d 个部分\n", file_size,
+         total_parts);
+  const char *filename = strrchr(file_path, '\\');
+  if (!filename) {
+    filename = strrchr(file_path, '/');
+  }
+  if (filename) {
+    filename++;
+  } else {
+    filename = file_path;
+  }
+  char file_base[MAX_PATH_LENGTH] = {0};
+  char file_ext[MAX_PATH_LENGTH] = {0};
+  char *dot_pos = strrchr(filename, '.');
+  if (dot_pos && dot_pos != filename) {
+    size_t base_len = dot_pos - filename;
+    strncpy_s(file_base, MAX_PATH_LENGTH, filename, base_len);
+    file_base[base_len] = '\0';
+    strcpy_s(file_ext, MAX_PATH_LENGTH, dot_pos);
+  } else {
+    strcpy_s(file_base, MAX_PATH_LENGTH, filename);
+    file_ext[0] = '\0';
+  }
+  SplitJob job = {0};
+  job.source_path = file_path;
+  job.part_count = total_parts;
+  job.incremental = incremental;
+  job.previous = has_previous ? &previous : NULL;
+  job.parts = (SplitPart *)safe_malloc(sizeof(SplitPart) * total_parts);
+  long long offset = 0;
+  for (int i = 0; i < total_parts; i++) {
+    SplitPart *part = &job.parts[i];
+    snprintf(part->path, MAX_PATH_LENGTH, "%s\\%s-part%04d%s", split_dir,
+             file_base, i + 1, file_ext);
+    part->offset = offset;
+    part->size = part_sizes[i];
+    part->seconds = 0;
+    part->ok = 0;
+    part->hashed = 0;
+    part->reused = 0;
+    offset += part->size;
+  }
+  free(part_sizes);
+  int thread_count = g_run_options.split_jobs > 0 ? g_run_options.split_jobs
+                                                  : 1;
+  if (thread_count > MAX_SCAN_THREADS) {
+    thread_count = MAX_SCAN_THREADS;
+  }
+  if (thread_count > total_parts) {
+    thread_count = total_parts;
+  }
+  SplitWorker *workers =
+      (SplitWorker *)safe_malloc(sizeof(SplitWorker) * thread_count);
+  HANDLE *threads = (HANDLE *)safe_malloc(sizeof(HANDLE) * thread_count);
+  double start_time = get_time_seconds();
+  for (int i = 0; i < thread_count; i++) {
+    workers[i].job = &job;
+    copy_engine_init(&workers[i].engine);
+  }
+  int moved_parts = 0;
+  if (job.previous) {
+    split_run_workers(workers, threads, thread_count, split_hash_worker);
+    moved_parts = split_plan_reuse(&job, split_dir);
+  }
+  split_run_workers(workers, threads, thread_count, split_part_worker);
+  double elapsed = get_time_seconds() - start_time;
+  CopyEngine engine;
+  copy_engine_init(&engine);
+  for (int i = 0; i < thread_count; i++) {
+    for (int m = 0; m < COPY_METHOD_COUNT; m++) {
+      engine.bytes[m] += workers[i].engine.bytes[m];
+    }
+    copy_engine_free(&workers[i].engine);
+  }
+  free(workers);
+  free(threads);
+  split_manifest_free(&previous);
+  int success_parts = 0;
+  int reused_parts = 0;
+  int first_part_item = parts->count;
+  for (int i = 0; i < total_parts; i++) {
+    reused_parts += job.parts[i].reused;
+    if (job.parts[i].ok) {
+      success_parts++;
+      item_list_add(parts, job.parts[i].path, job.parts[i].size, TYPE_FILE);
+    }
+  }
+  if (incremental) {
+    printf("    增量拆分: 复用 %d 个部分 (其中重命名 %d 个), 重写 %d 个部分\n",
+           reused_parts, moved_parts, success_parts - reused_parts);
+    if (!prune_split_directory(split_dir, job.parts, total_parts)) {
+      printf("    [警告] 清理多余的拆分文件失败\n");
+    }
+  }
+  if (success_parts == total_parts) {
+    SplitManifest manifest = {0};
+    manifest.source_size = file_size;
+    manifest.source_mtime = source_mtime;
+    manifest.part_count = total_parts;
+    manifest.parts =
+        (ManifestPart *)safe_malloc(sizeof(ManifestPart) * total_parts);
+    for (int i = 0; i < total_parts; i++) {
+      manifest.parts[i].name = strrchr(job.parts[i].path, '\\') + 1;
+      manifest.parts[i].size = job.parts[i].size;
+      manifest.parts[i].hash = job.parts[i].hash;
+    }
+    manifest.file_hash = split_manifest_file_hash(&manifest);
+    long long manifest_size = 0;
+    if (split_manifest_write(split_dir, &manifest, &manifest_size)) {
+      char manifest_path[MAX_PATH_LENGTH];
+      snprintf(manifest_path, MAX_PATH_LENGTH, "%s\\%s", split_dir,
+               SPLIT_MANIFEST_NAME);
+      item_list_add(parts, manifest_path, manifest_size, TYPE_FILE);
+      printf("    [成功] 写入拆分清单: %s (文件哈希 %016llx)\n", manifest_path,
+             manifest.file_hash);
+    } else {
+      printf("    [警告] 无法写入拆分清单，完整性检查将退回按大小比较\n");
+    }
+    free(manifest.parts);
+  }
+  free(job.parts);
+  copy_engine_report(&engine);
+  printf("    拆分吞吐: %.1f MB/s (%d 并发, 耗时 %.3f 秒)\n",
+         elapsed > 0 ? file_size / elapsed / (1024 * 1024) : 0.0, thread_count,
+         elapsed);
+  if (success_parts == total_parts) {
+    printf("    [成功] 文件拆分完成，共 %d 个部分\n", total_parts);
+    if (is_split_complete(file_path, split_dir, file_size, NULL)) {
+      printf("    [验证] 拆分完整性验证通过\n");
+      printf("    [信息] 拆分完成，原文件将在备份后被删除\n");
+      free(wfile_path);
+      free(wsplit_dir);
+      return 1;
+    } else {
+      printf("    [警告] 拆分完整性验证失败\n");
+      parts->count = first_part_item;
+      free(wfile_path);
+      free(wsplit_dir);
+      return 0;
+    }
+  } else {
+    printf("    [警告] 文件拆分部分成功: %d/%d 个部分\n", success_parts,
+           total_parts);
+    parts->count = first_part_item;
+    free(wfile_path);
+    free(wsplit_dir);
+    return 0;
+  }
+}
+
+int is_split_complete(const char *file_path, const char *split_dir,
+                      long long file_size, ItemList *parts) {
+  SplitManifest manifest;
+  if (split_manifest_read(split_dir, &manifest)) {
+    int complete = split_manifest_check(file_path, split_dir, file_size,
+                                        &manifest, parts);
+    split_manifest_free(&manifest);
+    return complete;
+  }
+  wchar_t *wsplit_dir = char_to_wchar(split_dir);
+  if (!wsplit_dir)
+    return 0;
+  DWORD attr = GetFileAttributesW(wsplit_dir);
+  if (attr == INVALID_FILE_ATTRIBUTES || !(attr & FILE_ATTRIBUTE_DIRECTORY)) {
+    printf("    拆分目录不存在: %s\n", split_dir);
+    free(wsplit_dir);
+    return 0;
+  }
+  long long split_total_size = 0;
+  int part_count = 0;
+  int first_part_item = parts ? parts->count : 0;
+  wchar_t search_path[MAX_PATH_LENGTH];
+  if (!safe_path_join(search_path, MAX_PATH_LENGTH, wsplit_dir, L"*")) {
+    free(wsplit_dir);
+    return 0;
+  }
+  WIN32_FIND_DATAW find_data;
+  HANDLE hFind = FindFirstFileW(search_path, &find_data);
+  if (hFind != INVALID_HANDLE_VALUE) {
+    do {
+      if (wcscmp(find_data.cFileName, L".") == 0 ||
+          wcscmp(find_data.cFileName, L"..") == 0) {
+        continue;
+      }
+      if (!(find_data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)) {
+        ULARGE_INTEGER part_size;
+        part_size.LowPart = find_data.nFileSizeLow;
+        part_size.HighPart = find_data.nFileSizeHigh;
+        split_total_size += part_size.QuadPart;
+        part_count++;
+        char *part_filename = wchar_to_char(find_data.cFileName);
+        if (part_filename) {
+          printf("      找到拆分文件: %s (%llu bytes)\n", part_filename,
+                 part_size.QuadPart);
+          if (parts) {
+            char part_path[MAX_PATH_LENGTH];
+            snprintf(part_path, MAX_PATH_LENGTH, "%s\\%s", split_dir,
+                     part_filename);
+            item_list_add(parts, part_path, (long long)part_size.QuadPart,
+                          TYPE_FILE);
+          }
+          free(part_filename);
+        }
+      }
+    } while (FindNextFileW(hFind, &find_data));
+    FindClose(hFind);
+  }
+  free(wsplit_dir);
+  if (part_count == 0) {
+    printf("    拆分目录为空: %s\n", split_dir);
+    return 0;
+  }
+  long long size_difference = llabs(split_total_size - file_size);
+  double difference_ratio = (double)size_difference / file_size;
+  printf("    拆分检查: 原文件 %lld bytes, 拆分文件 %lld bytes (共%d个文件), "
+         "差异 %.4f%%\n",
+         file_size, split_total_size, part_count, difference_ratio * 100);
+  if (size_difference > 1024) {
+    printf("    文件大小不匹配，需要重新拆分\n");
+    if (parts) {
+      parts->count = first_part_item;
+    }
+    return 0;
+  }
+  printf("    拆分目录完整，跳过拆分步骤\n");
+  return 1;
+}
+
+int delete_original_file(const char *file_path) {
+  if (!file_path || strlen(file_path) == 0) {
+    printf("    [错误] 文件路径为空\n");
+    return 0;
+  }
+  printf("    [调试] 准备删除文件: %s\n", file_path);
+  wchar_t *wfile_path = char_to_wchar(file_path);
+  if (!wfile_path) {
+    printf("    [错误] 无法转换文件路径编码: %s\n", file_path);
+    return 0;
+  }
+  DWORD attr = GetFileAttributesW(wfile_path);
+  if (attr == INVALID_FILE_ATTRIBUTES) {
+    DWORD error = GetLastError();
+    if (error == ERROR_FILE_NOT_FOUND || error == ERROR_PATH_NOT_FOUND) {
+      printf("    [信息] 文件已不存在: %s\n", file_path);
+      free(wfile_path);
+      return 1;
+    } else {
+      printf("    [错误] 无法访问文件 %s (错误: %lu)\n", file_path, error);
+      free(wfile_path);
+      return 0;
+    }
+  }
+  if (attr & FILE_ATTRIBUTE_DIRECTORY) {
+    printf("    [错误] 路径是目录而不是文件: %s\n", file_path);
+    free(wfile_path);
+    return 0;
+  }
+  if (DeleteFileW(wfile_path)) {
+    printf("    [成功] 文件删除成功: %s\n", file_path);
+    free(wfile_path);
+    return 1;
+  } else {
+    DWORD error = GetLastError();
+    printf("    [错误] 无法删除文件 %s (错误: %lu)\n", file_path, error);
+    switch (error) {
+    case ERROR_FILE_NOT_FOUND:
+      printf("        文件不存在\n");
+      break;
+    case ERROR_ACCESS_DENIED:
+      printf("        访问被拒绝，文件可能正在被使用或没有权限\n");
+      break;
+    case ERROR_SHARING_VIOLATION:
+      printf("        文件正在被其他进程使用\n");
+      break;
+    default:
+      printf("        未知错误\n");
+      break;
+    }
+    free(wfile_path);
+    return 0;
+  }
+}
+
+AdditionalFiles print_skipped_files(GroupResult *result) {
+  AdditionalFiles additional = {0};
+  if (result->skipped_count == 0) {
+    printf("\n[信息] 没有跳过的大文件\n");
+    return additional;
+  }
+  printf("\n========================================\n");
+  printf("          跳过的大文件列表\n");
+  printf("========================================\n\n");
+  printf("共跳过 %d 个大文件 (超过 %lld MB):\n\n", result->skipped_count,
+         MAX_FILE_SIZE / (1024 * 1024));
+  long long total_skipped_size = 0;
+  int backup_success_count = 0;
+  int gitignore_update_count = 0;
+  int split_success_count = 0;
+  int backup_attempt_count = 0;
+  int gitignore_attempt_count = 0;
+  int delete_success_count = 0;
+  char git_repo_path[MAX_PATH_LENGTH];
+  if (!GetCurrentDirectoryA(MAX_PATH_LENGTH, git_repo_path)) {
+    printf("[错误] 无法获取当前工作目录\n");
+    return additional;
+  }
+  normalize_path(git_repo_path);
+  printf("Git仓库路径: %s\n", git_repo_path);
+  char backup_base_dir[MAX_PATH_LENGTH];
+  snprintf(backup_base_dir, MAX_PATH_LENGTH, "%s-backup", git_repo_path);
+  printf("备份基础路径: %s\n\n", backup_base_dir);
+  for (int i = 0; i < result->skipped_count; i++) {
+    total_skipped_size += result->skipped_files[i].size;
+    char size_str[32];
+    format_size(result->skipped_files[i].size, size_str, sizeof(size_str));
+    printf("%3d. %s\n", i + 1, result->skipped_files[i].path);
+    printf("     大小: %s\n", size_str);
+    char split_dir[MAX_PATH_LENGTH];
+    snprintf(split_dir, MAX_PATH_LENGTH, "%s-split",
+             result->skipped_files[i].path);
+    int needs_split = !is_split_complete(
+        result->skipped_files[i].path, split_dir,
+        result->skipped_files[i].size, &additional.split_items);
+    if (needs_split) {
+      printf("    需要拆分大文件...\n");
+      if (split_large_file(result->skipped_files[i].path, split_dir,
+                           result->skipped_files[i].size,
+                           &additional.split_items)) {
+        split_success_count++;
+        printf("    [成功] 大文件拆分完成\n");
+        printf("    正在备份原文件...\n");
+        backup_attempt_count++;
+        if (copy_file_with_backup(result->skipped_files[i].path,
+                                  backup_base_dir)) {
+          backup_success_count++;
+          printf("    [成功] 原文件备份完成\n");
+          printf("    正在删除原文件...\n");
+          if (delete_original_file(result->skipped_files[i].path)) {
+            delete_success_count++;
+            printf("    [成功] 原文件已删除\n");
+          } else {
+            printf("    [警告] 原文件删除失败\n");
+          }
+        } else {
+          printf("    [警告] 原文件备份失败，跳过删除步骤\n");
+        }
+        gitignore_attempt_count++;
+        if (update_gitignore_for_skipped_file(result->skipped_files[i].path,
+                                              &additional.gitignore_items)) {
+          gitignore_update_count++;
+        }
+      } else {
+        printf("    [失败] 大文件拆分失败，跳过备份和.gitignore更新\n");
+      }
+    } else {
+      printf("    [信息] 大文件已拆分且完整，跳过拆分步骤\n");
+      split_success_count++;
+      DWORD attr = GetFileAttributesA(result->skipped_files[i].path);
+      if (attr != INVALID_FILE_ATTRIBUTES &&
+          !(attr & FILE_ATTRIBUTE_DIRECTORY)) {
+        printf("    原文件仍然存在，进行备份...\n");
+        backup_attempt_count++;
+        if (copy_file_with_backup(result->skipped_files[i].path,
+                                  backup_base_dir)) {
+          backup_success_count++;
+          printf("    [成功] 原文件备份完成\n");
+          printf("    正在删除原文件...\n");
+          if (delete_original_file(result->skipped_files[i].path)) {
+            delete_success_count++;
+            printf("    [成功] 原文件已删除\n");
+          } else {
+            printf("    [警告] 原文件删除失败\n");
+          }
+          gitignore_attempt_count++;
+          if (update_gitignore_for_skipped_file(
+                  result->skipped_files[i].path, NULL)) {
+            gitignore_update_count++;
+          }
+        } else {
+          printf("    [警告] 原文件备份失败，跳过删除步骤\n");
+        }
+      } else {
+        printf("    [信息] 原文件已不存在，无需备份和删除\n");
+      }
+    }
+    if (i != result->skipped_count - 1) {
+      printf("\n");
+    }
+  }
+  char total_skipped_str[32];
+  format_size(total_skipped_size, total_skipped_str, sizeof(total_skipped_str));
+  printf("\n跳过大文件总大小: %s\n", total_skipped_str);
+  printf("需要拆分的文件: %d/%d 个\n", split_success_count,
+         result->skipped_count);
+  if (backup_attempt_count > 0) {
+    printf("备份成功: %d/%d 个文件\n", backup_success_count,
+           backup_attempt_count);
+  } else {
+    printf("备份成功: 0/0 个文件 (无需备份)\n");
+  }
+  printf("删除成功: %d/%d 个文件\n", delete_success_count,
+         backup_success_count);
+  if (gitignore_attempt_count > 0) {
+    printf(".gitignore更新: %d/%d 个目录\n", gitignore_update_count,
+           gitignore_attempt_count);
+  } else {
+    printf(".gitignore更新: 0/0 个目录 (无需更新)\n");
+  }
+  if (backup_attempt_count > 0 && backup_success_count < backup_attempt_count) {
+    printf("[警告] 部分文件备份失败，请检查权限和磁盘空间\n");
+  } else if (backup_success_count > 0) {
+    printf("[成功] 所有需要备份的大文件已备份到: %s-backup\n", git_repo_path);
+  } else {
+    printf("[信息] 没有需要备份的文件\n");
+  }
+  if (delete_success_count > 0) {
+    printf("[成功] %d 个原文件已删除\n", delete_success_count);
+  }
+  if (backup_success_count > 0 && delete_success_count < backup_success_count) {
+    printf("[警告] 部分文件备份成功但删除失败\n");
+  }
+  if (split_success_count < result->skipped_count) {
+    printf("[警告] 部分大文件拆分失败\n");
+  } else {
+    printf("[成功] 所有大文件拆分处理完成\n");
+  }
+  if (gitignore_attempt_count > 0 &&
+      gitignore_update_count < gitignore_attempt_count) {
+    printf("[警告] 部分.gitignore文件更新失败\n");
+  } else if (gitignore_update_count > 0) {
+    printf("[成功] 所有相关.gitignore文件已更新\n");
+  } else {
+    printf("[信息] 没有需要更新的.gitignore文件\n");
+  }
+  return additional;
+}
+
+void free_additional_files(AdditionalFiles *additional) {
+  if (additional) {
+    free(additional->gitignore_items.items);
+    free(additional->split_items.items);
+  }
+}
+
+void add_additional_files_to_groups(GroupResult *result,
+                                    AdditionalFiles *additional) {
+  if (!additional || (!additional->gitignore_items.count &&
+                      !additional->split_items.count)) {
+    return;
+  }
+  printf("\n[处理] 正在将额外文件添加到分组...\n");
+  printf("  共 %d 个.gitignore文件, %d 个拆分文件需要添加到分组\n",
+         additional->gitignore_items.count, additional->split_items.count);
+  GroupPacker packer;
+  group_packer_init(&packer, result, MAX_GROUP_SIZE);
+  const ItemList *lists[] = {&additional->gitignore_items,
+                             &additional->split_items};
+  for (int l = 0; l < 2; l++) {
+    for (int i = 0; i < lists[l]->count; i++) {
+      FileItem *item = &lists[l]->items[i];
+      int created;
+      int group = group_packer_add(&packer, item, &created);
+      if (created) {
+        printf("      已创建新分组 %d 并添加 '%s' (%lld bytes)\n", group + 1,
+               item_path(item), item->size);
+      } else {
+        printf("      已添加 '%s' (%lld bytes) 到分组 %d\n", item_path(item),
+               item->size, group + 1);
+      }
+    }
+  }
+  group_packer_free(&packer);
+}
+
+int update_gitignore_for_skipped_file(const char *skipped_file_path,
+                                      ItemList *gitignore_items) {
+  char dir_path[MAX_PATH_LENGTH];
+  strcpy_s(dir_path, MAX_PATH_LENGTH, skipped_file_path);
+  char *last_slash = strrchr(dir_path, '\\');
+  if (!last_slash) {
+    last_slash = strrchr(dir_path, '/');
+  }
+  if (!last_slash) {
+    printf("    [警告] 无法提取目录路径: %s\n", skipped_file_path);
+    return 0;
+  }
+  *last_slash = '\0';
+  char gitignore_path[MAX_PATH_LENGTH];
+  snprintf(gitignore_path, MAX_PATH_LENGTH, "%s\\.gitignore", dir_path);
+  const char *filename = last_slash + 1;
+  char backup_filename[MAX_PATH_LENGTH];
+  char file_base[MAX_PATH_LENGTH] = {0};
+  char file_ext[MAX_PATH_LENGTH] = {0};
+  char *dot_pos = strrchr(filename, '.');
+  if (dot_pos && dot_pos != filename) {
+    size_t base_len = dot_pos - filename;
+    strncpy_s(file_base, MAX_PATH_LENGTH, filename, base_len);
+    file_base[base_len] = '\0';
+    strcpy_s(file_ext, MAX_PATH_LENGTH, dot_pos);
+  } else {
+    strcpy_s(file_base, MAX_PATH_LENGTH, filename);
+    file_ext[0] = '\0';
+  }
+  snprintf(backup_filename, MAX_PATH_LENGTH, "%s-merged%s", file_base,
+           file_ext);
+  wchar_t *wgitignore_path = char_to_wchar(gitignore_path);
+  if (!wgitignore_path) {
+    printf("    [错误] 无法转换.gitignore路径编码: %s\n", gitignore_path);
+    return 0;
+  }
+  DWORD attr = GetFileAttributesW(wgitignore_path);
+  int file_exists =
+      (attr != INVALID_FILE_ATTRIBUTES && !(attr & FILE_ATTRIBUTE_DIRECTORY));
+  char *existing_content = NULL;
+  size_t existing_size = 0;
+  if (file_exists) {
+    FILE *file = _wfopen(wgitignore_path, L"rb");
+    if (file) {
+      fseek(file, 0, SEEK_END);
+      long file_size = ftell(file);
+      fseek(file, 0, SEEK_SET);
+      if (file_size > 0 && file_size < 10 * 1024 * 1024) {
+        existing_content = (char *)safe_malloc(file_size + 1);
+        size_t read_size = fread(existing_content, 1, file_size, file);
+        existing_content[read_size] = '\0';
+        existing_size = read_size;
+      }
+      fclose(file);
+    }
+  }
+  int already_ignored = 0;
+  if (existing_content) {
+    char *content_copy = (char *)safe_malloc(existing_size + 1);
+    strcpy_s(content_copy, existing_size + 1, existing_content);
+    char *line = strtok(content_copy, "\n");
+    while (line != NULL) {
+      if (strlen(line) > 0 && line[0] != '#') {
+        char *trimmed_line = line;
+        while (*trimmed_line == ' ' || *trimmed_line == '\t') {
+          trimmed_line++;
+        }
+        char *end = trimmed_line + strlen(trimmed_line) - 1;
+        while (end > trimmed_line &&
+               (*end == ' ' || *end == '\t' || *end == '\r')) {
+          *end = '\0';
+          end--;
+        }
+        if (strcmp(trimmed_line, backup_filename) == 0) {
+          already_ignored = 1;
+          printf("    [信息] 备份文件已在.gitignore中忽略: %s\n",
+                 backup_filename);
+          break;
+        }
+      }
+      line = strtok(NULL, "\n");
+    }
+    free(content_copy);
+  }
+  if (!already_ignored) {
+    FILE *file = NULL;
+    if (file_exists) {
+      file = _wfopen(wgitignore_path, L"ab");
+    } else {
+      file = _wfopen(wgitignore_path, L"wb");
+    }
+    if (file) {
+      if (!file_exists || (existing_size == 0)) {
+        unsigned char bom[] = {0xEF, 0xBB, 0xBF};
+        fwrite(bom, 1, 3, file);
+        char header[] = "# 自动生成的.gitignore文件\n# 忽略备份的大文件\n\n";
+        fwrite(header, 1, strlen(header), file);
+      } else if (existing_size > 0) {
+        if (existing_content[existing_size - 1] != '\n') {
+          fputc('\n', file);
+        }
+      }
+      fprintf(file, "%s\n", backup_filename);
+      fflush(file);
+      long long gitignore_size = ftell(file);
+      fclose(file);
+      printf("    [成功] 已更新.gitignore: %s -> %s\n", gitignore_path,
+             backup_filename);
+      if (gitignore_items) {
+        FileItem *item = NULL;
+        for (int i = 0; i < gitignore_items->count && !item; i++) {
+          if (strcmp(item_path(&gitignore_items->items[i]), gitignore_path) ==
+              0) {
+            item = &gitignore_items->items[i];
+          }
+        }
+        if (item) {
+          item->size = gitignore_size;
+          item->packed_size = gitignore_size;
+        } else {
+          item_list_add(gitignore_items, gitignore_path, gitignore_size,
+                        TYPE_FILE);
+        }
+      }
+    } else {
+      printf("    [错误] 无法创建或打开.gitignore文件: %s\n", gitignore_path);
+      free(wgitignore_path);
+      if (existing_content)
+        free(existing_content);
+      return 0;
+    }
+  }
+  free(wgitignore_path);
+  if (existing_content)
+    free(existing_content);
+  return !already_ignored;
+}
+
+void print_statistics(const GroupResult *result, long long total_scanned_size,
+                      long long skipped_files_size) {
+  printf("========================================\n");
+  printf("              统计信息\n");
+  printf("========================================\n\n");
+  long long total_grouped_size = 0;
+  int total_grouped_files = 0;
+  int total_grouped_dirs = 0;
+  for (int i = 0; i < result->group_count; i++) {
+    total_grouped_size += result->groups[i].total_size;
+    for (int j = 0; j < result->groups[i].count; j++) {
+      if (result->groups[i].items[j].type == TYPE_FILE) {
+        total_grouped_files++;
+      } else {
+        total_grouped_dirs++;
+      }
+    }
+  }
+  double avg_group_size = result->group_count > 0
+                              ? (double)total_grouped_size / result->group_count
+                              : 0;
+  double grouped_percent = total_scanned_size > 0 ? (double)total_grouped_size /
+                                                        total_scanned_size * 100
+                                                  : 0;
+  double skipped_percent = total_scanned_size > 0 ? (double)skipped_files_size /
+                                                        total_scanned_size * 100
+                                                  : 0;
+  printf("总体统计:\n");
+  printf("  总分组数: %d 个\n", result->group_count);
+  char avg_size_str[32];
+  format_size((long long)avg_group_size, avg_size_str, sizeof(avg_size_str));
+  printf("  平均每组大小: %s\n", avg_size_str);
+  printf("\n");
+  printf("项目统计:\n");
+  printf("  分组总项数: %d 个\n", total_grouped_files + total_grouped_dirs);
+  printf("  分组文件数: %d 个\n", total_grouped_files);
+  printf("  分组文件夹数: %d 个\n", total_grouped_dirs);
+  printf("\n");
+  printf("大小统计:\n");
+  char grouped_size_str[32], scanned_size_str[32], skipped_size_str[32];
+  format_size(total_grouped_size, grouped_size_str, sizeof(grouped_size_str));
+  format_size(total_scanned_size, scanned_size_str, sizeof(scanned_size_str));
+  format_size(skipped_files_size, skipped_size_str, sizeof(skipped_size_str));
+  printf("  扫描总大小: %s\n", scanned_size_str);
+  printf("  分组总大小: %s (%.1f%%)\n", grouped_size_str, grouped_percent);
+  printf("  跳过大文件: %s (%.1f%%)\n", skipped_size_str, skipped_percent);
+}
+
+void validate_result(const GroupResult *result, long long input_total_size,
+                     long long total_scanned_size,
+                     long long skipped_files_size) {
+  printf("\n========================================\n");
+  printf("              验证结果\n");
+  printf("========================================\n\n");
+  long long total_grouped_size = 0;
+  for (int i = 0; i < result->group_count; i++) {
+    total_grouped_size += result->groups[i].total_size;
+  }
+  long long calculated_total = total_grouped_size + skipped_files_size;
+  long long difference = input_total_size - calculated_total;
+  double difference_percent =
+      input_total_size > 0 ? (double)difference / input_total_size * 100 : 0;
+  char input_str[32], grouped_str[32], skipped_str[32], scanned_str[32],
+      diff_str[32];
+  format_size(input_total_size, input_str, sizeof(input_str));
+  format_size(total_grouped_size, grouped_str, sizeof(grouped_str));
+  format_size(skipped_files_size, skipped_str, sizeof(skipped_str));
+  format_size(total_scanned_size, scanned_str, sizeof(scanned_str));
+  format_size(difference, diff_str, sizeof(diff_str));
+  printf("    输入总大小: %s vs\n", input_str);
+  printf("    分组总大小: %s\n", grouped_str);
+  printf("\n");
+  if (total_grouped_size == input_total_size) {
+    printf("  [成功] 验证成功: 没有文件遗漏\n");
+  } else if (total_grouped_size < input_total_size) {
+    printf("  [警告] 可能有文件遗漏\n");
+    printf("        相差: %s (%.2f%%)\n", diff_str, difference_percent);
+    printf("        可能原因:\n");
+    printf("          1. 隐藏文件或系统文件未被统计\n");
+    printf("          2. 权限问题导致某些文件无法访问\n");
+    printf("          3. 符号链接或特殊文件类型\n");
+  } else {
+    printf("  [错误] 数据不一致\n");
+    printf("        计算值比输入值大: %s (%.2f%%)\n", diff_str,
+           difference_percent);
+  }
+}
+
+void free_group_result(GroupResult *result) {
+  if (result) {
+    arena_free_all(&result->arena);
+    free(result->groups);
+    result->groups = NULL;
+    if (result->skipped_files) {
+      free(result->skipped_files);
+      result->skipped_files = NULL;
+    }
+    result->group_count = 0;
+    result->groups_capacity = 0;
+    result->skipped_count = 0;
+    result->skipped_capacity = 0;
+  }
+}
+
+GroupResult process_input_paths(char *paths[], int path_count,
+                                long long *total_scanned_size,
+                                long long *skipped_files_size) {
+  ItemList items = {0};
+  item_list_reserve(&items, path_count);
+  long long total_input_size = 0;
+  *total_scanned_size = 0;
+  *skipped_files_size = 0;
+  GroupResult result = {0};
+  printf("[开始] 正在扫描文件和文件夹...\n\n");
+  for (int i = 0; i < path_count; i++) {
+    process_input_path(paths[i], &items, &total_input_size,
+                       total_scanned_size, skipped_files_size, &result);
+  }
+  printf("\n[完成] 扫描完成:\n");
+  printf("  共收集到 %d 个有效项\n", items.count);
+  char path_bytes_str[32];
+  format_size((long long)g_path_arena.length, path_bytes_str,
+              sizeof(path_bytes_str));
+  printf("  路径存储: %s (%zu 个唯一路径, 每项 %zu 字节)\n", path_bytes_str,
+         g_path_arena.index_count, sizeof(FileItem));
+  char input_size_str[32], scanned_size_str[32], skipped_size_str[32];
+  format_size(total_input_size, input_size_str, sizeof(input_size_str));
+  format_size(*total_scanned_size, scanned_size_str, sizeof(scanned_size_str));
+  format_size(*skipped_files_size, skipped_size_str, sizeof(skipped_size_str));
+  printf("  输入总大小: %s\n", input_size_str);
+  printf("  扫描总大小: %s\n", scanned_size_str);
+  printf("  跳过大文件: %s\n", skipped_size_str);
+  printf("  扫描耗时: %.3f 秒 (单遍扫描 %lld 个目录, %lld 个条目)\n",
+         result.scan_stats.elapsed_seconds,
+         result.scan_stats.directories_scanned,
+         result.scan_stats.entries_scanned);
+  printf("  扫描吞吐: %.0f 条目/秒\n\n",
+         scan_entries_per_second(&result.scan_stats));
+  printf("[处理] 正在进行分组...\n");
+  GroupResult grouping_result = group_files(items.items, items.count);
+  result.groups = grouping_result.groups;
+  result.group_count = grouping_result.group_count;
+  result.groups_capacity = grouping_result.groups_capacity;
+  result.arena = grouping_result.arena;
+  result.total_input_size = total_input_size;
+  result.skipped_size = *skipped_files_size;
+  free(items.items);
+  return result;
+}
+
+int git_run_with_items(const char *command, const FileItem *items,
+                       int count) {
+  FILE *pipe = _popen(command, "wb");
+  if (!pipe) {
+    return -1;
+  }
+  char path[MAX_PATH_LENGTH];
+  for (int i = 0; i < count; i++) {
+    if (strcpy_s(path, MAX_PATH_LENGTH, item_path(&items[i])) != 0) {
+      continue;
+    }
+    for (char *p = path; *p; p++) {
+      if (*p == '\\') {
+        *p = '/';
+      }
+    }
+    fwrite(path, 1, strlen(path) + 1, pipe);
+  }
+  return _pclose(pipe);
+}
+
+void execute_git_commands(const GroupResult *result,
+                          const char *commit_info_file) {
+  printf("\n========================================\n");
+  printf("              执行Git操作\n");
+  printf("========================================\n\n");
+  if (result->group_count == 0) {
+    printf("[信息] 没有分组需要处理\n");
+    return;
+  }
+  if (_wsystem(L"git status >nul 2>&1") != 0) {
+    printf("[错误] 当前目录不是Git仓库或git命令不可用\n");
+    return;
+  }
+  int total_commands = 0;
+  int success_commands = 0;
+  int total_paths_processed = 0;
+  long long verified_estimate = 0, verified_actual = 0;
+  for (int group_idx = 0; group_idx < result->group_count; group_idx++) {
+    const FileGroup *group = &result->groups[group_idx];
+    printf("\n处理分组 %d/%d (包含 %d 个项):\n", group_idx + 1,
+           result->group_count, group->count);
+    long long current_group_total_size = 0;
+    for (int i = 0; i < group->count; i++) {
+      current_group_total_size += group->items[i].size;
+    }
+    char group_total_size_str[32];
+    format_size(current_group_total_size, group_total_size_str,
+                sizeof(group_total_size_str));
+    printf("  分组总大小: %s\n", group_total_size_str);
+    for (int item_idx = 0; item_idx < group->count; item_idx++) {
+      const FileItem *item = &group->items[item_idx];
+      char item_size_str[32];
+      format_size(item->size, item_size_str, sizeof(item_size_str));
+      const char *type_str = item->type == TYPE_FILE ? "文件" : "文件夹";
+      printf("    添加%s: %s (%s)\n", type_str, item_path(item), item_size_str);
+    }
+    printf("  执行命令: git add --pathspec-from-file=- [%d个路径, %s]\n",
+           group->count, group_total_size_str);
+    int add_ret = git_run_with_items(
+        "git --literal-pathspecs add --pathspec-from-file=- "
+        "--pathspec-file-nul",
+        group->items, group->count);
+    total_commands++;
+    if (add_ret == 0) {
+      success_commands++;
+      printf("    [成功] 命令执行成功\n");
+    } else {
+      printf("    [失败] 命令返回代码: %d\n", add_ret);
+    }
+    total_paths_processed += group->count;
+    if (commit_info_file && commit_info_file[0] != '\0') {
+      printf("\n执行提交: git commit --pathspec-from-file=- -F \"%s\" "
+             "[仅提交本分组的 %d 个路径]\n",
+             commit_info_file, group->count);
+      char commit_command[MAX_PATH_LENGTH + 128];
+      snprintf(commit_command, sizeof(commit_command),
+               "git --literal-pathspecs commit --pathspec-from-file=- "
+               "--pathspec-file-nul -F \"%s\"",
+               commit_info_file);
+      int ret = git_run_with_items(commit_command, group->items, group->count);
+      total_commands++;
+      if (ret == 0) {
+        success_commands++;
+        printf("[成功] 提交完成\n");
+        if (g_run_options.verify_pack) {
+          long long actual = measure_head_pack_size();
+          if (actual >= 0) {
+            char estimate_str[32], actual_str[32];
+            format_size(group->packed_size, estimate_str,
+                        sizeof(estimate_str));
+            format_size(actual, actual_str, sizeof(actual_str));
+            printf("[校验] 估算打包大小: %s, 实际打包大小: %s (%+.1f%%)\n",
+                   estimate_str, actual_str,
+                   actual > 0 ? (double)(group->packed_size - actual) /
+                                    actual * 100
+                              : 0.0);
+            verified_estimate += group->packed_size;
+            verified_actual += actual;
+          } else {
+            printf("[警告] 无法计算本次提交的实际打包大小\n");
+          }
+        }
+      } else {
+        printf("[失败] 提交命令返回代码: %d\n", ret);
+      }
+    } else {
+      printf("\n[警告] 未提供提交信息文件，跳过提交步骤\n");
+    }
+    printf("\n执行推送: git push\n");
+    int ret = _wsystem(L"git push");
+    total_commands++;
+    if (ret == 0) {
+      success_commands++;
+      printf("[成功] 推送完成\n");
+    } else {
+      printf("[失败] 推送命令返回代码: %d\n", ret);
+    }
+    printf("  分组 %d 处理完成，共处理 %d 个路径\n", group_idx + 1,
+           group->count);
   }
-  if (gitignore_attempt_count > 0 &&
-      gitignore_update_count < gitignore_attempt_count) {
-    printf("[警告] 部分.gitignore文件更新失败\n");
-  } else if (gitignore_update_count > 0) {
-    printf("[成功] 所有相关.gitignore文件已更新\n");
-  } else {
-    printf("[信息] 没有需要更新的.gitignore文件\n");
+  printf("\nGit操作统计:\n");
+  printf("  总命令数: %d\n", total_commands);
+  printf("  成功命令: %d\n", success_commands);
+  printf("  失败命令: %d\n", total_commands - success_commands);
+  printf("  总处理路径: %d\n", total_paths_processed);
+  if (verified_actual > 0) {
+    char estimate_str[32], actual_str[32];
+    format_size(verified_estimate, estimate_str, sizeof(estimate_str));
+    format_size(verified_actual, actual_str, sizeof(actual_str));
+    printf("  打包估算: %s, 实际: %s (偏差 %+.1f%%)\n", estimate_str,
+           actual_str,
+           (double)(verified_estimate - verified_actual) / verified_actual *
+               100);
   }
-  return additional;
+  printf("  成功率: %.1f%%\n",
+         total_commands > 0 ? (double)success_commands / total_commands * 100
+                            : 0.0);
 }
 
-void free_additional_files(AdditionalFiles *additional) {
-  if (additional) {
-    for (int i = 0; i < additional->gitignore_count; i++) {
-      free(additional->gitignore_files[i]);
+void print_detailed_group_info(const FileGroup *group, int group_index) {
+  printf("分组 %d 详细信息:\n", group_index + 1);
+  long long total_size = 0;
+  int file_count = 0, dir_count = 0;
+  for (int i = 0; i < group->count; i++) {
+    total_size += group->items[i].size;
+    if (group->items[i].type == TYPE_FILE) {
+      file_count++;
+    } else {
+      dir_count++;
     }
-    free(additional->gitignore_files);
-    for (int i = 0; i < additional->split_count; i++) {
-      free(additional->split_files[i]);
+  }
+  char size_str[32];
+  format_size(total_size, size_str, sizeof(size_str));
+  printf("  总大小: %s\n", size_str);
+  printf("  包含: %d 个文件, %d 个文件夹\n", file_count, dir_count);
+  double usage_rate = (double)total_size / MAX_GROUP_SIZE * 100;
+  printf("  使用率: %.1f%%\n", usage_rate);
+  PathTrie group_dirs;
+  path_trie_init(&group_dirs);
+  for (int i = 0; i < group->count; i++) {
+    if (group->items[i].type == TYPE_DIRECTORY) {
+      path_trie_insert(&group_dirs, item_path(&group->items[i]), i);
     }
-    free(additional->split_files);
   }
-}
-
-void add_additional_files_to_groups(GroupResult *result,
-                                    AdditionalFiles *additional) {
-  if (!additional ||
-      (!additional->gitignore_count && !additional->split_count)) {
-    return;
+  int *container = (int *)safe_malloc(sizeof(int) * (group->count + 1));
+  int *first_child = (int *)safe_malloc(sizeof(int) * (group->count + 1));
+  int *next_child = (int *)safe_malloc(sizeof(int) * (group->count + 1));
+  for (int i = 0; i < group->count; i++) {
+    first_child[i] = -1;
   }
-  printf("\n[处理] 正在将额外文件添加到分组...\n");
-  FileItem *new_items = (FileItem *)safe_malloc(sizeof(FileItem) * MAX_ITEMS);
-  int new_item_count = 0;
-  for (int i = 0; i < additional->gitignore_count && new_item_count < MAX_ITEMS;
-       i++) {
-    char *path = additional->gitignore_files[i];
-    wchar_t *wpath = char_to_wchar(path);
-    if (wpath) {
-      DWORD attr = GetFileAttributesW(wpath);
-      if (attr != INVALID_FILE_ATTRIBUTES &&
-          !(attr & FILE_ATTRIBUTE_DIRECTORY)) {
-        HANDLE hFile = CreateFileW(wpath, GENERIC_READ, FILE_SHARE_READ, NULL,
-                                   OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
-        if (hFile != INVALID_HANDLE_VALUE) {
-          DWORD sizeLow, sizeHigh;
-          sizeLow = GetFileSize(hFile, &sizeHigh);
-          CloseHandle(hFile);
-          ULARGE_INTEGER file_size;
-          file_size.LowPart = sizeLow;
-          file_size.HighPart = sizeHigh;
-          strcpy_s(new_items[new_item_count].path, MAX_PATH_LENGTH, path);
-          new_items[new_item_count].size = file_size.QuadPart;
-          new_items[new_item_count].type = TYPE_FILE;
-          new_item_count++;
-          printf("      添加.gitignore文件: %s (%lld bytes)\n", path,
-                 file_size.QuadPart);
-        } else {
-          printf("      警告: 无法打开.gitignore文件: %s (错误: %lu)\n", path,
-                 GetLastError());
-        }
-      } else {
-        printf("      警告: .gitignore文件不存在或无法访问: %s\n", path);
+  for (int j = group->count - 1; j >= 0; j--) {
+    container[j] = -1;
+    if (group->items[j].type == TYPE_FILE) {
+      container[j] =
+          path_trie_find_container(&group_dirs, item_path(&group->items[j]));
+      if (container[j] >= 0) {
+        next_child[j] = first_child[container[j]];
+        first_child[container[j]] = j;
       }
-      free(wpath);
-    } else {
-      printf("      错误: 无法转换.gitignore文件路径编码: %s\n", path);
     }
   }
-  for (int i = 0; i < additional->split_count && new_item_count < MAX_ITEMS;
-       i++) {
-    char *split_dir = additional->split_files[i];
-    wchar_t *wsplit_dir = char_to_wchar(split_dir);
-    if (wsplit_dir) {
-      collect_split_directory_files(wsplit_dir, new_items, &new_item_count);
-      free(wsplit_dir);
-    } else {
-      printf("      错误: 无法转换拆分目录路径编码: %s\n", split_dir);
-    }
-  }
-  if (new_item_count > 0) {
-    printf("  共找到 %d 个额外文件需要添加到分组\n", new_item_count);
-    for (int i = 0; i < new_item_count; i++) {
-      FileItem *item = &new_items[i];
-      int best_group = -1;
-      long long best_remaining = MAX_GROUP_SIZE;
-      for (int j = 0; j < result->group_count; j++) {
-        long long remaining = MAX_GROUP_SIZE - result->groups[j].total_size;
-        if (remaining >= item->size && remaining < best_remaining) {
-          best_remaining = remaining;
-          best_group = j;
-        }
-      }
-      if (best_group != -1) {
-        FileGroup *group = &result->groups[best_group];
-        if (group->count >= group->capacity) {
-          int new_capacity = group->capacity * 2;
-          FileItem *new_items_array = (FileItem *)safe_realloc(
-              group->items, sizeof(FileItem) * new_capacity);
-          group->items = new_items_array;
-          group->capacity = new_capacity;
-        }
-        group->items[group->count++] = *item;
-        group->total_size += item->size;
-        printf("      已添加 '%s' 到分组 %d\n", item->path, best_group + 1);
-      } else {
-        if (result->group_count >= result->groups_capacity) {
-          int new_capacity = result->groups_capacity * 2;
-          FileGroup *new_groups = (FileGroup *)safe_realloc(
-              result->groups, sizeof(FileGroup) * new_capacity);
-          for (int k = result->group_count; k < new_capacity; k++) {
-            new_groups[k].items =
-                (FileItem *)safe_malloc(sizeof(FileItem) * 10);
-            new_groups[k].count = 0;
-            new_groups[k].capacity = 10;
-            new_groups[k].total_size = 0;
-          }
-          result->groups = new_groups;
-          result->groups_capacity = new_capacity;
-        }
-        FileGroup *new_group = &result->groups[result->group_count];
-        if (new_group->count >= new_group->capacity) {
-          int new_capacity = new_group->capacity * 2;
-          FileItem *new_items_array = (FileItem *)safe_realloc(
-              new_group->items, sizeof(FileItem) * new_capacity);
-          new_group->items = new_items_array;
-          new_group->capacity = new_capacity;
-        }
-        new_group->items[new_group->count++] = *item;
-        new_group->total_size += item->size;
-        result->group_count++;
-        printf("      已创建新分组 %d 并添加 '%s'\n", result->group_count,
-               item->path);
+  path_trie_free(&group_dirs);
+  printf("  文件夹列表:\n");
+  for (int i = 0; i < group->count; i++) {
+    if (group->items[i].type == TYPE_DIRECTORY) {
+      char item_size_str[32];
+      format_size(group->items[i].size, item_size_str, sizeof(item_size_str));
+      printf("    [文件夹] %s (%s)\n", item_path(&group->items[i]),
+             item_size_str);
+      for (int j = first_child[i]; j >= 0; j = next_child[j]) {
+        char file_size_str[32];
+        format_size(group->items[j].size, file_size_str,
+                    sizeof(file_size_str));
+        printf("      └─ [文件] %s (%s)\n", item_path(&group->items[j]),
+               file_size_str);
       }
     }
-  } else {
-    printf("  没有找到需要添加的额外文件\n");
   }
-  free(new_items);
-}
-
-void collect_split_directory_files(const wchar_t *wdir_path, FileItem *items,
-                                   int *item_count) {
-  wchar_t search_path[MAX_PATH_LENGTH];
-  if (!safe_path_join(search_path, MAX_PATH_LENGTH, wdir_path, L"*")) {
-    return;
+  printf("  独立文件列表:\n");
+  int has_independent_files = 0;
+  for (int i = 0; i < group->count; i++) {
+    if (group->items[i].type == TYPE_FILE && container[i] < 0) {
+      char file_size_str[32];
+      format_size(group->items[i].size, file_size_str, sizeof(file_size_str));
+      printf("    [文件] %s (%s)\n", item_path(&group->items[i]),
+             file_size_str);
+      has_independent_files = 1;
+    }
   }
-  WIN32_FIND_DATAW find_data;
-  HANDLE hFind = FindFirstFileW(search_path, &find_data);
-  if (hFind == INVALID_HANDLE_VALUE) {
-    return;
+  free(container);
+  free(first_child);
+  free(next_child);
+  if (!has_independent_files) {
+    printf("    无独立文件\n");
   }
-  do {
-    if (wcscmp(find_data.cFileName, L".") == 0 ||
-        wcscmp(find_data.cFileName, L"..") == 0) {
-      continue;
-    }
-    wchar_t full_path[MAX_PATH_LENGTH];
-    if (!safe_path_join(full_path, MAX_PATH_LENGTH, wdir_path,
-                        find_data.cFileName)) {
-      continue;
-    }
-    if (find_data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) {
-      collect_split_directory_files(full_path, items, item_count);
-    } else {
-      if (*item_count < MAX_ITEMS) {
-        char *char_path = wchar_to_char(full_path);
-        if (char_path) {
-          normalize_path(char_path);
-          ULARGE_INTEGER file_size;
-          file_size.LowPart = find_data.nFileSizeLow;
-          file_size.HighPart = find_data.nFileSizeHigh;
-          strcpy_s(items[*item_count].path, MAX_PATH_LENGTH, char_path);
-          items[*item_count].size = file_size.QuadPart;
-          items[*item_count].type = TYPE_FILE;
-          (*item_count)++;
-          printf("    找到拆分文件: %s (%lld bytes)\n", char_path,
-                 file_size.QuadPart);
-          free(char_path);
-        }
-      }
-    }
-  } while (FindNextFileW(hFind, &find_data) && *item_count < MAX_ITEMS);
-  FindClose(hFind);
+  printf("\n");
 }
 
-int update_gitignore_for_skipped_file(const char *skipped_file_path) {
-  char dir_path[MAX_PATH_LENGTH];
-  strcpy_s(dir_path, MAX_PATH_LENGTH, skipped_file_path);
-  char *last_slash = strrchr(dir_path, '\\');
-  if (!last_slash) {
-    last_slash = strrchr(dir_path, '/');
+char *get_current_time() {
+  static char time_str[64];
+  time_t now = time(NULL);
+  struct tm *tm_info = localtime(&now);
+  strftime(time_str, sizeof(time_str), "%Y-%m-%d %H:%M:%S", tm_info);
+  return time_str;
+}
+
+int run_grouping_test_with_git(char *paths[], int path_count,
+                               const char *commit_info_file) {
+  long long total_scanned_size, skipped_files_size;
+  GroupResult result = process_input_paths(
+      paths, path_count, &total_scanned_size, &skipped_files_size);
+  AdditionalFiles additional = print_skipped_files(&result);
+  add_additional_files_to_groups(&result, &additional);
+  print_groups(&result);
+  print_statistics(&result, total_scanned_size, skipped_files_size);
+  validate_result(&result, result.total_input_size, total_scanned_size,
+                  skipped_files_size);
+  execute_git_commands(&result, commit_info_file);
+  free_additional_files(&additional);
+  free_group_result(&result);
+  path_arena_free();
+  return 0;
+}
+
+int run_grouping_test(char *paths[], int path_count) {
+  long long total_scanned_size, skipped_files_size;
+  GroupResult result = process_input_paths(
+      paths, path_count, &total_scanned_size, &skipped_files_size);
+  AdditionalFiles additional = print_skipped_files(&result);
+  add_additional_files_to_groups(&result, &additional);
+  print_groups(&result);
+  print_statistics(&result, total_scanned_size, skipped_files_size);
+  validate_result(&result, result.total_input_size, total_scanned_size,
+                  skipped_files_size);
+  free_additional_files(&additional);
+  free_group_result(&result);
+  path_arena_free();
+  return 0;
+}
+
+char *parse_status_record(char *record, int *is_rename,
+                          GitChangeKind *kind) {
+  int fields;
+  *is_rename = record[0] == '2';
+  *kind = GIT_CHANGE_MODIFIED;
+  switch (record[0]) {
+  case '1':
+    fields = 8;
+    break;
+  case '2':
+    fields = 9;
+    break;
+  case 'u':
+    fields = 10;
+    break;
+  case '?':
+    fields = 1;
+    *kind = GIT_CHANGE_UNTRACKED;
+    break;
+  default:
+    return NULL;
   }
-  if (!last_slash) {
-    printf("    [警告] 无法提取目录路径: %s\n", skipped_file_path);
-    return 0;
+  char *path = record;
+  for (int i = 0; i < fields && path; i++) {
+    path = strchr(path, ' ');
+    if (path) {
+      path++;
+    }
   }
-  *last_slash = '\0';
-  char gitignore_path[MAX_PATH_LENGTH];
-  snprintf(gitignore_path, MAX_PATH_LENGTH, "%s\\.gitignore", dir_path);
-  const char *filename = last_slash + 1;
-  char backup_filename[MAX_PATH_LENGTH];
-  char file_base[MAX_PATH_LENGTH] = {0};
-  char file_ext[MAX_PATH_LENGTH] = {0};
-  char *dot_pos = strrchr(filename, '.');
-  if (dot_pos && dot_pos != filename) {
-    size_t base_len = dot_pos - filename;
-    strncpy_s(file_base, MAX_PATH_LENGTH, filename, base_len);
-    file_base[base_len] = '\0';
-    strcpy_s(file_ext, MAX_PATH_LENGTH, dot_pos);
-  } else {
-    strcpy_s(file_base, MAX_PATH_LENGTH, filename);
-    file_ext[0] = '\0';
+  if (!path || !*path) {
+    return NULL;
   }
-  snprintf(backup_filename, MAX_PATH_LENGTH, "%s-merged%s", file_base,
-           file_ext);
-  wchar_t *wgitignore_path = char_to_wchar(gitignore_path);
-  if (!wgitignore_path) {
-    printf("    [错误] 无法转换.gitignore路径编码: %s\n", gitignore_path);
-    return 0;
+  if (record[0] != '?' && record[3] == 'D') {
+    *kind = GIT_CHANGE_DELETED;
   }
-  DWORD attr = GetFileAttributesW(wgitignore_path);
-  int file_exists =
-      (attr != INVALID_FILE_ATTRIBUTES && !(attr & FILE_ATTRIBUTE_DIRECTORY));
-  char *existing_content = NULL;
-  size_t existing_size = 0;
-  if (file_exists) {
-    FILE *file = _wfopen(wgitignore_path, L"rb");
-    if (file) {
-      fseek(file, 0, SEEK_END);
-      long file_size = ftell(file);
-      fseek(file, 0, SEEK_SET);
-      if (file_size > 0 && file_size < 10 * 1024 * 1024) {
-        existing_content = (char *)safe_malloc(file_size + 1);
-        size_t read_size = fread(existing_content, 1, file_size, file);
-        existing_content[read_size] = '\0';
-        existing_size = read_size;
-      }
-      fclose(file);
+  size_t length = 0;
+  for (char *p = path; *p; p++, length++) {
+    if (*p == '/') {
+      *p = '\\';
     }
   }
-  int already_ignored = 0;
-  if (existing_content) {
-    char *content_copy = (char *)safe_malloc(existing_size + 1);
-    strcpy_s(content_copy, existing_size + 1, existing_content);
-    char *line = strtok(content_copy, "\n");
-    while (line != NULL) {
-      if (strlen(line) > 0 && line[0] != '#') {
-        char *trimmed_line = line;
-        while (*trimmed_line == ' ' || *trimmed_line == '\t') {
-          trimmed_line++;
-        }
-        char *end = trimmed_line + strlen(trimmed_line) - 1;
-        while (end > trimmed_line &&
-               (*end == ' ' || *end == '\t' || *end == '\r')) {
-          *end = '\0';
-          end--;
-        }
-        if (strcmp(trimmed_line, backup_filename) == 0) {
-          already_ignored = 1;
-          printf("    [信息] 备份文件已在.gitignore中忽略: %s\n",
-                 backup_filename);
-          break;
+  if (*kind == GIT_CHANGE_UNTRACKED && path[length - 1] == '\\') {
+    *kind = GIT_CHANGE_UNTRACKED_DIR;
+  }
+  return path;
+}
+
+char **get_git_status_paths(int *path_count) {
+  printf("[Git] 正在执行 git status --porcelain=v2 -z...\n");
+  FILE *pipe = _popen("git status --porcelain=v2 -z", "rb");
+  if (!pipe) {
+    printf("[错误] 无法执行git命令\n");
+    return NULL;
+  }
+  char **paths = NULL;
+  unsigned char *kinds = NULL;
+  int paths_capacity = 0;
+  *path_count = 0;
+  size_t capacity = STATUS_READ_CHUNK;
+  char *buffer = (char *)arena_alloc(&g_status_arena, capacity);
+  size_t length = 0;
+  size_t parsed = 0;
+  int skip_original_path = 0;
+  while (1) {
+    size_t got = fread(buffer + length, 1, capacity - length, pipe);
+    length += got;
+    char *record = buffer + parsed;
+    char *end = buffer + length;
+    char *terminator;
+    while ((terminator = (char *)memchr(record, '\0', end - record))) {
+      if (skip_original_path) {
+        skip_original_path = 0;
+      } else {
+        GitChangeKind kind;
+        char *path = parse_status_record(record, &skip_original_path, &kind);
+        if (path) {
+          if (*path_count >= paths_capacity) {
+            paths_capacity = paths_capacity == 0 ? 256 : paths_capacity * 2;
+            paths = (char **)safe_realloc(paths,
+                                          sizeof(char *) * paths_capacity);
+            kinds = (unsigned char *)safe_realloc(kinds, paths_capacity);
+          }
+          kinds[*path_count] = (unsigned char)kind;
+          paths[(*path_count)++] = path;
         }
       }
-      line = strtok(NULL, "\n");
+      record = terminator + 1;
     }
-    free(content_copy);
-  }
-  if (!already_ignored) {
-    FILE *file = NULL;
-    if (file_exists) {
-      file = _wfopen(wgitignore_path, L"ab");
-    } else {
-      file = _wfopen(wgitignore_path, L"wb");
+    parsed = (size_t)(record - buffer);
+    if (got == 0) {
+      break;
     }
-    if (file) {
-      if (!file_exists || (existing_size == 0)) {
-        unsigned char bom[] = {0xEF, 0xBB, 0xBF};
-        fwrite(bom, 1, 3, file);
-        char header[] = "# 自动生成的.gitignore文件\n# 忽略备份的大文件\n\n";
-        fwrite(header, 1, strlen(header), file);
-      } else if (existing_size > 0) {
-        if (existing_content[existing_size - 1] != '\n') {
-          fputc('\n', file);
-        }
+    if (length == capacity) {
+      size_t rest = length - parsed;
+      if (rest == capacity) {
+        capacity *= 2;
       }
-      fprintf(file, "%s\n", backup_filename);
-      fflush(file);
-      fclose(file);
-      printf("    [成功] 已更新.gitignore: %s -> %s\n", gitignore_path,
-             backup_filename);
-    } else {
-      printf("    [错误] 无法创建或打开.gitignore文件: %s\n", gitignore_path);
-      free(wgitignore_path);
-      if (existing_content)
-        free(existing_content);
-      return 0;
+      char *next = (char *)arena_alloc(&g_status_arena, capacity);
+      memcpy(next, record, rest);
+      buffer = next;
+      length = rest;
+      parsed = 0;
     }
   }
-  free(wgitignore_path);
-  if (existing_content)
-    free(existing_content);
-  return !already_ignored;
+  _pclose(pipe);
+  printf("[Git] 找到 %d 个变更项\n", *path_count);
+  if (*path_count > 0) {
+    printf("[Git] 变更项列表:\n");
+    for (int i = 0; i < *path_count; i++) {
+      const char *label = "[文件]";
+      if (kinds[i] == GIT_CHANGE_UNTRACKED_DIR) {
+        label = "[目录]";
+      } else if (kinds[i] == GIT_CHANGE_DELETED) {
+        label = "[已删除]";
+      } else if (kinds[i] == GIT_CHANGE_UNTRACKED) {
+        label = "[未跟踪]";
+      }
+      printf("  %d. '%s' %s\n", i + 1, paths[i], label);
+    }
+  }
+  free(kinds);
+  return paths;
 }
 
-void print_statistics(const GroupResult *result, long long total_scanned_size,
-                      long long skipped_files_size) {
-  printf("========================================\n");
-  printf("              统计信息\n");
-  printf("========================================\n\n");
-  long long total_grouped_size = 0;
-  int total_grouped_files = 0;
-  int total_grouped_dirs = 0;
-  for (int i = 0; i < result->group_count; i++) {
-    total_grouped_size += result->groups[i].total_size;
-    for (int j = 0; j < result->groups[i].count; j++) {
-      if (result->groups[i].items[j].type == TYPE_FILE) {
-        total_grouped_files++;
-      } else {
-        total_grouped_dirs++;
+void normalize_directory_path(char *path) {
+  if (!path || strlen(path) == 0)
+    return;
+  normalize_path(path);
+  size_t len = strlen(path);
+  if (len > 0 && path[len - 1] != '\\') {
+    if (len == 2 && path[1] == ':') {
+      if (len < MAX_PATH_LENGTH - 1) {
+        path[len] = '\\';
+        path[len + 1] = '\0';
+      }
+    } else if (!(len == 3 && path[1] == ':' && path[2] == '\\')) {
+      if (len < MAX_PATH_LENGTH - 1) {
+        path[len] = '\\';
+        path[len + 1] = '\0';
       }
     }
   }
-  double avg_group_size = result->group_count > 0
-                              ? (double)total_grouped_size / result->group_count
-                              : 0;
-  double grouped_percent = total_scanned_size > 0 ? (double)total_grouped_size /
-                                                        total_scanned_size * 100
-                                                  : 0;
-  double skipped_percent = total_scanned_size > 0 ? (double)skipped_files_size /
-                                                        total_scanned_size * 100
-                                                  : 0;
-  printf("总体统计:\n");
-  printf("  总分组数: %d 个\n", result->group_count);
-  char avg_size_str[32];
-  format_size((long long)avg_group_size, avg_size_str, sizeof(avg_size_str));
-  printf("  平均每组大小: %s\n", avg_size_str);
-  printf("\n");
-  printf("项目统计:\n");
-  printf("  分组总项数: %d 个\n", total_grouped_files + total_grouped_dirs);
-  printf("  分组文件数: %d 个\n", total_grouped_files);
-  printf("  分组文件夹数: %d 个\n", total_grouped_dirs);
-  printf("\n");
-  printf("大小统计:\n");
-  char grouped_size_str[32], scanned_size_str[32], skipped_size_str[32];
-  format_size(total_grouped_size, grouped_size_str, sizeof(grouped_size_str));
-  format_size(total_scanned_size, scanned_size_str, sizeof(scanned_size_str));
-  format_size(skipped_files_size, skipped_size_str, sizeof(skipped_size_str));
-  printf("  扫描总大小: %s\n", scanned_size_str);
-  printf("  分组总大小: %s (%.1f%%)\n", grouped_size_str, grouped_percent);
-  printf("  跳过大文件: %s (%.1f%%)\n", skipped_size_str, skipped_percent);
 }
 
-void validate_result(const GroupResult *result, long long input_total_size,
-                     long long total_scanned_size,
-                     long long skipped_files_size) {
-  printf("\n========================================\n");
-  printf("              验证结果\n");
-  printf("========================================\n\n");
-  long long total_grouped_size = 0;
-  for (int i = 0; i < result->group_count; i++) {
-    total_grouped_size += result->groups[i].total_size;
+void free_git_status_paths(char **paths, int path_count) {
+  free(paths);
+  arena_free_all(&g_status_arena);
+}
+
+unsigned int read_be32(const unsigned char *p) {
+  return ((unsigned int)p[0] << 24) | ((unsigned int)p[1] << 16) |
+         ((unsigned int)p[2] << 8) | p[3];
+}
+
+int git_repo_uses_sha256(void) {
+  FILE *file = compat_fopen(".git\\config", "r");
+  if (!file) {
+    return 0;
   }
-  long long calculated_total = total_grouped_size + skipped_files_size;
-  long long difference = input_total_size - calculated_total;
-  double difference_percent =
-      input_total_size > 0 ? (double)difference / input_total_size * 100 : 0;
-  char input_str[32], grouped_str[32], skipped_str[32], scanned_str[32],
-      diff_str[32];
-  format_size(input_total_size, input_str, sizeof(input_str));
-  format_size(total_grouped_size, grouped_str, sizeof(grouped_str));
-  format_size(skipped_files_size, skipped_str, sizeof(skipped_str));
-  format_size(total_scanned_size, scanned_str, sizeof(scanned_str));
-  format_size(difference, diff_str, sizeof(diff_str));
-  printf("    输入总大小: %s vs\n", input_str);
-  printf("    分组总大小: %s\n", grouped_str);
-  printf("\n");
-  if (total_grouped_size == input_total_size) {
-    printf("  [成功] 验证成功: 没有文件遗漏\n");
-  } else if (total_grouped_size < input_total_size) {
-    printf("  [警告] 可能有文件遗漏\n");
-    printf("        相差: %s (%.2f%%)\n", diff_str, difference_percent);
-    printf("        可能原因:\n");
-    printf("          1. 隐藏文件或系统文件未被统计\n");
-    printf("          2. 权限问题导致某些文件无法访问\n");
-    printf("          3. 符号链接或特殊文件类型\n");
-  } else {
-    printf("  [错误] 数据不一致\n");
-    printf("        计算值比输入值大: %s (%.2f%%)\n", diff_str,
-           difference_percent);
+  char line[1024];
+  int sha256 = 0;
+  while (fgets(line, sizeof(line), file)) {
+    if (strstr(line, "objectformat") && strstr(line, "sha256")) {
+      sha256 = 1;
+      break;
+    }
   }
+  fclose(file);
+  return sha256;
 }
 
-void free_group_result(GroupResult *result) {
-  if (result) {
-    if (result->groups) {
-      for (int i = 0; i < result->groups_capacity; i++) {
-        if (result->groups[i].items) {
-          free(result->groups[i].items);
-          result->groups[i].items = NULL;
+int git_index_parse(GitIndex *index, const unsigned char *data, size_t size) {
+  if (size < 12 || memcmp(data, "DIRC", 4) != 0) {
+    printf("[错误] .git\\index 格式无效\n");
+    return 0;
+  }
+  index->version = read_be32(data + 4);
+  if (index->version < 2 || index->version > 4) {
+    printf("[错误] 不支持的索引版本: %u\n", index->version);
+    return 0;
+  }
+  unsigned int entry_count = read_be32(data + 8);
+  size_t hash_size = git_repo_uses_sha256() ? 32 : 20;
+  size_t fixed_size = 40 + hash_size + 2;
+  index->entries =
+      (GitIndexEntry *)safe_malloc(sizeof(GitIndexEntry) * (entry_count + 1));
+  index->entry_count = 0;
+  size_t offset = 12;
+  const char *previous = "";
+  size_t previous_length = 0;
+  for (unsigned int i = 0; i < entry_count; i++) {
+    if (offset + fixed_size > size) {
+      printf("[错误] .git\\index 条目被截断\n");
+      return 0;
+    }
+    const unsigned char *entry = data + offset;
+    unsigned int flags = ((unsigned int)entry[fixed_size - 2] << 8) |
+                         entry[fixed_size - 1];
+    size_t path_offset = fixed_size;
+    if ((flags & 0x4000) && index->version >= 3) {
+      flags |= (((unsigned int)entry[path_offset] << 8) |
+                entry[path_offset + 1])
+               << 16;
+      path_offset += 2;
+    }
+    size_t strip = 0;
+    if (index->version == 4) {
+      unsigned char c;
+      do {
+        if (offset + path_offset >= size) {
+          printf("[错误] .git\\index 条目被截断\n");
+          return 0;
         }
+        c = entry[path_offset++];
+        strip = (strip << 7) | (c & 127);
+        if (c & 128) {
+          strip++;
+        }
+      } while (c & 128);
+      if (strip > previous_length) {
+        printf("[错误] .git\\index 路径压缩数据无效\n");
+        return 0;
       }
-      free(result->groups);
-      result->groups = NULL;
     }
-    if (result->skipped_files) {
-      free(result->skipped_files);
-      result->skipped_files = NULL;
+    const char *name = (const char *)entry + path_offset;
+    const char *name_end =
+        (const char *)memchr(name, '\0', size - offset - path_offset);
+    if (!name_end) {
+      printf("[错误] .git\\index 路径未终止\n");
+      return 0;
+    }
+    size_t name_length = (size_t)(name_end - name);
+    size_t keep = index->version == 4 ? previous_length - strip : 0;
+    char *path = (char *)arena_alloc(&index->paths, keep + name_length + 1);
+    memcpy(path, previous, keep);
+    memcpy(path + keep, name, name_length + 1);
+    GitIndexEntry *out = &index->entries[index->entry_count++];
+    out->path = path;
+    out->path_length = (unsigned int)(keep + name_length);
+    out->mtime_sec = read_be32(entry + 8);
+    out->mtime_nsec = read_be32(entry + 12);
+    out->mode = read_be32(entry + 24);
+    out->size = read_be32(entry + 36);
+    out->flags = flags;
+    previous = path;
+    previous_length = out->path_length;
+    if (index->version == 4) {
+      offset += path_offset + name_length + 1;
+    } else {
+      offset += (path_offset + name_length + 8) & ~(size_t)7;
     }
-    result->group_count = 0;
-    result->groups_capacity = 0;
-    result->skipped_count = 0;
-    result->skipped_capacity = 0;
   }
+  while (offset + 8 + hash_size <= size) {
+    if (memcmp(data + offset, "link", 4) == 0) {
+      printf("[错误] 不支持拆分索引 (split index)\n");
+      return 0;
+    }
+    offset += 8 + (size_t)read_be32(data + offset + 4);
+  }
+  return 1;
 }
 
-GroupResult process_input_paths(char *paths[], int path_count,
-                                long long *total_scanned_size,
-                                long long *skipped_files_size) {
-  FileItem *items = (FileItem *)safe_malloc(sizeof(FileItem) * MAX_ITEMS);
-  int item_count = 0;
-  long long total_input_size = 0;
-  *total_scanned_size = 0;
-  *skipped_files_size = 0;
-  GroupResult result = {0};
-  result.groups_capacity = 10;
-  result.groups =
-      (FileGroup *)safe_malloc(sizeof(FileGroup) * result.groups_capacity);
-  result.skipped_capacity = 10;
-  result.skipped_files =
-      (SkippedFile *)safe_malloc(sizeof(SkippedFile) * result.skipped_capacity);
-  result.skipped_count = 0;
-  for (int i = 0; i < result.groups_capacity; i++) {
-    result.groups[i].items = (FileItem *)safe_malloc(sizeof(FileItem) * 10);
-    result.groups[i].count = 0;
-    result.groups[i].capacity = 10;
-    result.groups[i].total_size = 0;
+int git_index_load(GitIndex *index) {
+  memset(index, 0, sizeof(GitIndex));
+  arena_init(&index->paths, 1024 * 1024);
+  HANDLE file = CreateFileW(L".git\\index", GENERIC_READ, FILE_SHARE_READ,
+                            NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+  if (file == INVALID_HANDLE_VALUE) {
+    printf("[错误] 无法打开 .git\\index\n");
+    return 0;
   }
-  printf("[开始] 正在扫描文件和文件夹...\n\n");
-  for (int i = 0; i < path_count; i++) {
-    process_input_path(paths[i], items, &item_count, &total_input_size,
-                       total_scanned_size, skipped_files_size, &result);
+  LARGE_INTEGER file_size;
+  FILETIME index_mtime = {0};
+  GetFileTime(file, NULL, NULL, &index_mtime);
+  unsigned long long index_time = filetime_to_u64(&index_mtime);
+  index->mtime_sec =
+      index_time > UNIX_EPOCH_FILETIME
+          ? (unsigned int)((index_time - UNIX_EPOCH_FILETIME) / 10000000)
+          : 0;
+  HANDLE mapping = NULL;
+  const unsigned char *view = NULL;
+  if (GetFileSizeEx(file, &file_size) && file_size.QuadPart > 0) {
+    mapping = CreateFileMappingW(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (mapping) {
+      view = (const unsigned char *)MapViewOfFile(mapping, FILE_MAP_READ, 0,
+                                                  0, 0);
+    }
   }
-  printf("\n[完成] 扫描完成:\n");
-  printf("  共收集到 %d 个有效项\n", item_count);
-  char input_size_str[32], scanned_size_str[32], skipped_size_str[32];
-  format_size(total_input_size, input_size_str, sizeof(input_size_str));
-  format_size(*total_scanned_size, scanned_size_str, sizeof(scanned_size_str));
-  format_size(*skipped_files_size, skipped_size_str, sizeof(skipped_size_str));
-  printf("  输入总大小: %s\n", input_size_str);
-  printf("  扫描总大小: %s\n", scanned_size_str);
-  printf("  跳过大文件: %s\n\n", skipped_size_str);
-  printf("[处理] 正在进行分组...\n");
-  GroupResult grouping_result = group_files(items, item_count);
-  result.groups = grouping_result.groups;
-  result.group_count = grouping_result.group_count;
-  result.groups_capacity = grouping_result.groups_capacity;
-  result.total_input_size = total_input_size;
-  result.skipped_size = *skipped_files_size;
-  free(items);
-  return result;
+  int ok = view && git_index_parse(index, view, (size_t)file_size.QuadPart);
+  if (view) {
+    UnmapViewOfFile(view);
+  }
+  if (mapping) {
+    CloseHandle(mapping);
+  }
+  CloseHandle(file);
+  return ok;
 }
 
-void execute_git_commands(const GroupResult *result,
-                          const char *commit_info_file) {
-  printf("\n========================================\n");
-  printf("              执行Git操作\n");
-  printf("========================================\n\n");
-  if (result->group_count == 0) {
-    printf("[信息] 没有分组需要处理\n");
-    return;
+void git_index_free(GitIndex *index) {
+  free(index->entries);
+  arena_free_all(&index->paths);
+  memset(index, 0, sizeof(GitIndex));
+}
+
+int git_index_contains(const GitIndex *index, const char *path, size_t length,
+                       int as_directory) {
+  int lo = 0, hi = index->entry_count;
+  while (lo < hi) {
+    int mid = lo + (hi - lo) / 2;
+    const GitIndexEntry *entry = &index->entries[mid];
+    int cmp = strncmp(entry->path, path, length);
+    if (cmp == 0 && !as_directory && entry->path_length > length) {
+      cmp = 1;
+    }
+    if (cmp < 0) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
   }
-  if (_wsystem(L"git status >nul 2>&1") != 0) {
-    printf("[错误] 当前目录不是Git仓库或git命令不可用\n");
-    return;
+  if (lo >= index->entry_count) {
+    return 0;
   }
-  int total_commands = 0;
-  int success_commands = 0;
-  int total_paths_processed = 0;
-  for (int group_idx = 0; group_idx < result->group_count; group_idx++) {
-    const FileGroup *group = &result->groups[group_idx];
-    printf("\n处理分组 %d/%d (包含 %d 个项):\n", group_idx + 1,
-           result->group_count, group->count);
-    long long current_group_total_size = 0;
-    for (int i = 0; i < group->count; i++) {
-      current_group_total_size += group->items[i].size;
+  const GitIndexEntry *entry = &index->entries[lo];
+  if (strncmp(entry->path, path, length) != 0) {
+    return 0;
+  }
+  if (!as_directory) {
+    return entry->path_length == length;
+  }
+  for (int i = lo; i < index->entry_count; i++) {
+    entry = &index->entries[i];
+    if (strncmp(entry->path, path, length) != 0) {
+      break;
     }
-    char group_total_size_str[32];
-    format_size(current_group_total_size, group_total_size_str,
-                sizeof(group_total_size_str));
-    printf("  分组总大小: %s\n", group_total_size_str);
-    wchar_t command_buffer[32768] = L"git add";
-    size_t buffer_len = wcslen(command_buffer);
-    int current_command_path_count = 0;
-    long long current_command_total_size = 0;
-    long long cumulative_group_size = 0;
-    for (int item_idx = 0; item_idx < group->count; item_idx++) {
-      const FileItem *item = &group->items[item_idx];
-      wchar_t *wpath = char_to_wchar(item->path);
-      if (!wpath) {
-        printf("    [警告] 无法转换路径编码: %s\n", item->path);
-        continue;
+    if (entry->path_length > length && entry->path[length] == '/') {
+      return 1;
+    }
+  }
+  return 0;
+}
+
+int glob_match(const char *pattern, const char *text) {
+  const char *p = pattern, *t = text;
+  for (; *p; p++, t++) {
+    if (*p == '*') {
+      int double_star = p[1] == '*';
+      while (*p == '*') {
+        p++;
       }
-      wchar_t quoted_path[MAX_PATH_LENGTH + 10];
-      if (wcschr(wpath, L' ') != NULL || wcschr(wpath, L'&') != NULL ||
-          wcschr(wpath, L'|') != NULL || wcschr(wpath, L'>') != NULL ||
-          wcschr(wpath, L'<') != NULL || wcschr(wpath, L'^') != NULL) {
-        _snwprintf_s(quoted_path, _countof(quoted_path), _TRUNCATE, L" \"%s\"",
-                     wpath);
-      } else {
-        _snwprintf_s(quoted_path, _countof(quoted_path), _TRUNCATE, L" %s",
-                     wpath);
-      }
-      size_t quoted_path_len = wcslen(quoted_path);
-      if (buffer_len + quoted_path_len >= 4000) {
-        char command_size_str[32];
-        format_size(current_command_total_size, command_size_str,
-                    sizeof(command_size_str));
-        cumulative_group_size += current_command_total_size;
-        char cumulative_size_str[32];
-        format_size(cumulative_group_size, cumulative_size_str,
-                    sizeof(cumulative_size_str));
-        printf(
-            "  执行命令: git add [%d个路径, 本次添加: %s, 累积添加: %s/%s]\n",
-            current_command_path_count, command_size_str, cumulative_size_str,
-            group_total_size_str);
-        int ret = _wsystem(command_buffer);
-        total_commands++;
-        if (ret == 0) {
-          success_commands++;
-          printf("    [成功] 命令执行成功\n");
-        } else {
-          printf("    [失败] 命令返回代码: %d\n", ret);
-          char *cmd_str = wchar_to_char(command_buffer);
-          if (cmd_str) {
-            printf("    失败命令: %s\n", cmd_str);
-            free(cmd_str);
+      if (double_star) {
+        if (*p == '/' && glob_match(p + 1, t)) {
+          return 1;
+        }
+        for (; *t; t++) {
+          if (glob_match(p, t)) {
+            return 1;
           }
         }
-        wcscpy_s(command_buffer, _countof(command_buffer), L"git add");
-        buffer_len = wcslen(command_buffer);
-        total_paths_processed += current_command_path_count;
-        current_command_path_count = 0;
-        current_command_total_size = 0;
-      }
-      if (buffer_len + quoted_path_len < _countof(command_buffer)) {
-        wcscat_s(command_buffer, _countof(command_buffer), quoted_path);
-        buffer_len += quoted_path_len;
-        current_command_path_count++;
-        current_command_total_size += item->size;
-        char item_size_str[32];
-        format_size(item->size, item_size_str, sizeof(item_size_str));
-        const char *type_str = item->type == TYPE_FILE ? "文件" : "文件夹";
-        printf("    添加%s: %s (%s)\n", type_str, item->path, item_size_str);
-      }
-      free(wpath);
-    }
-    if (current_command_path_count > 0) {
-      char command_size_str[32];
-      format_size(current_command_total_size, command_size_str,
-                  sizeof(command_size_str));
-      cumulative_group_size += current_command_total_size;
-      char cumulative_size_str[32];
-      format_size(cumulative_group_size, cumulative_size_str,
-                  sizeof(cumulative_size_str));
-      printf("  执行命令: git add [%d个路径, 本次添加: %s, 累积添加: %s/%s]\n",
-             current_command_path_count, command_size_str, cumulative_size_str,
-             group_total_size_str);
-      int ret = _wsystem(command_buffer);
-      total_commands++;
-      if (ret == 0) {
-        success_commands++;
-        printf("    [成功] 命令执行成功\n");
-      } else {
-        printf("    [失败] 命令返回代码: %d\n", ret);
-        char *cmd_str = wchar_to_char(command_buffer);
-        if (cmd_str) {
-          printf("    失败命令: %s\n", cmd_str);
-          free(cmd_str);
+        return glob_match(p, t);
+      }
+      for (;; t++) {
+        if (glob_match(p, t)) {
+          return 1;
+        }
+        if (!*t || *t == '/') {
+          return 0;
         }
       }
-      total_paths_processed += current_command_path_count;
     }
-    if (commit_info_file && commit_info_file[0] != '\0') {
-      printf("\n执行提交: git commit -F \"%s\"\n", commit_info_file);
-      int is_temp_file = 0;
-      char temp_dir[MAX_PATH_LENGTH];
-      if (GetTempPathA(MAX_PATH_LENGTH, temp_dir) > 0) {
-        if (strstr(commit_info_file, temp_dir) == commit_info_file) {
-          is_temp_file = 1;
-        }
+    if (!*t) {
+      return 0;
+    }
+    if (*p == '?') {
+      if (*t == '/') {
+        return 0;
       }
-      wchar_t commit_command[512];
-      wchar_t *wcommit_file = char_to_wchar(commit_info_file);
-      if (wcommit_file) {
-        _snwprintf_s(commit_command, _countof(commit_command), _TRUNCATE,
-                     L"git commit -F \"%s\"", wcommit_file);
-        int ret = _wsystem(commit_command);
-        total_commands++;
-        if (ret == 0) {
-          success_commands++;
-          printf("[成功] 提交完成\n");
+      continue;
+    }
+    if (*p == '[') {
+      const char *q = p + 1;
+      int negate = *q == '!' || *q == '^';
+      int matched = 0;
+      if (negate) {
+        q++;
+      }
+      if (*q == ']') {
+        matched = *t == ']';
+        q++;
+      }
+      while (*q && *q != ']') {
+        if (q[1] == '-' && q[2] && q[2] != ']') {
+          if (*t >= q[0] && *t <= q[2]) {
+            matched = 1;
+          }
+          q += 3;
         } else {
-          printf("[失败] 提交命令返回代码: %d\n", ret);
+          if (*t == *q) {
+            matched = 1;
+          }
+          q++;
         }
-        free(wcommit_file);
-      } else {
-        printf("[错误] 无法转换提交信息文件路径编码\n");
       }
-    } else {
-      printf("\n[警告] 未提供提交信息文件，跳过提交步骤\n");
+      if (!*q || matched == negate || *t == '/') {
+        return 0;
+      }
+      p = q;
+      continue;
+    }
+    if (*p == '\\' && p[1]) {
+      p++;
+    }
+    if (*p != *t) {
+      return 0;
+    }
+  }
+  return *t == '\0';
+}
+
+void ignore_list_add_file(IgnoreList *list, const char *file_path,
+                          const char *base) {
+  FILE *file = compat_fopen(file_path, "r");
+  if (!file) {
+    return;
+  }
+  size_t base_length = strlen(base);
+  char *base_copy = (char *)arena_alloc(&list->strings, base_length + 1);
+  memcpy(base_copy, base, base_length + 1);
+  char line[MAX_PATH_LENGTH];
+  while (fgets(line, sizeof(line), file)) {
+    size_t length = strcspn(line, "\r\n");
+    line[length] = '\0';
+    while (length > 0 && line[length - 1] == ' ' &&
+           (length < 2 || line[length - 2] != '\\')) {
+      line[--length] = '\0';
+    }
+    char *pattern = line;
+    if (length == 0 || pattern[0] == '#') {
+      continue;
+    }
+    IgnorePattern entry = {0};
+    if (pattern[0] == '!') {
+      entry.negate = 1;
+      pattern++;
+    } else if (pattern[0] == '\\' &&
+               (pattern[1] == '#' || pattern[1] == '!')) {
+      pattern++;
+    }
+    length = strlen(pattern);
+    if (length > 0 && pattern[length - 1] == '/') {
+      entry.dir_only = 1;
+      pattern[--length] = '\0';
+    }
+    if (strchr(pattern, '/')) {
+      entry.anchored = 1;
+      if (pattern[0] == '/') {
+        pattern++;
+        length--;
+      }
     }
-    printf("\n执行推送: git push\n");
-    int ret = _wsystem(L"git push");
-    total_commands++;
-    if (ret == 0) {
-      success_commands++;
-      printf("[成功] 推送完成\n");
-    } else {
-      printf("[失败] 推送命令返回代码: %d\n", ret);
+    if (length == 0) {
+      continue;
     }
-    printf("  分组 %d 处理完成，共处理 %d 个路径\n", group_idx + 1,
-           group->count);
+    entry.pattern = (char *)arena_alloc(&list->strings, length + 1);
+    memcpy(entry.pattern, pattern, length + 1);
+    entry.base = base_copy;
+    entry.base_length = base_length;
+    if (list->count >= list->capacity) {
+      list->capacity = list->capacity == 0 ? 64 : list->capacity * 2;
+      list->patterns = (IgnorePattern *)safe_realloc(
+          list->patterns, sizeof(IgnorePattern) * list->capacity);
+    }
+    list->patterns[list->count++] = entry;
   }
-  printf("\nGit操作统计:\n");
-  printf("  总命令数: %d\n", total_commands);
-  printf("  成功命令: %d\n", success_commands);
-  printf("  失败命令: %d\n", total_commands - success_commands);
-  printf("  总处理路径: %d\n", total_paths_processed);
-  printf("  成功率: %.1f%%\n",
-         total_commands > 0 ? (double)success_commands / total_commands * 100
-                            : 0.0);
+  fclose(file);
 }
 
-void print_detailed_group_info(const FileGroup *group, int group_index) {
-  printf("分组 %d 详细信息:\n", group_index + 1);
-  long long total_size = 0;
-  int file_count = 0, dir_count = 0;
-  for (int i = 0; i < group->count; i++) {
-    total_size += group->items[i].size;
-    if (group->items[i].type == TYPE_FILE) {
-      file_count++;
-    } else {
-      dir_count++;
+int ignore_list_match(const IgnoreList *list, const char *relative_path,
+                      int is_directory) {
+  const char *basename = strrchr(relative_path, '/');
+  basename = basename ? basename + 1 : relative_path;
+  int ignored = 0;
+  for (int i = 0; i < list->count; i++) {
+    const IgnorePattern *entry = &list->patterns[i];
+    if (entry->dir_only && !is_directory) {
+      continue;
+    }
+    if (strncmp(relative_path, entry->base, entry->base_length) != 0) {
+      continue;
+    }
+    const char *subject = entry->anchored
+                              ? relative_path + entry->base_length
+                              : basename;
+    if (glob_match(entry->pattern, subject)) {
+      ignored = !entry->negate;
     }
   }
-  char size_str[32];
-  format_size(total_size, size_str, sizeof(size_str));
-  printf("  总大小: %s\n", size_str);
-  printf("  包含: %d 个文件, %d 个文件夹\n", file_count, dir_count);
-  double usage_rate = (double)total_size / MAX_GROUP_SIZE * 100;
-  printf("  使用率: %.1f%%\n", usage_rate);
-  printf("  文件夹列表:\n");
-  for (int i = 0; i < group->count; i++) {
-    if (group->items[i].type == TYPE_DIRECTORY) {
-      char item_size_str[32];
-      format_size(group->items[i].size, item_size_str, sizeof(item_size_str));
-      printf("    [文件夹] %s (%s)\n", group->items[i].path, item_size_str);
-      for (int j = 0; j < group->count; j++) {
-        if (group->items[j].type == TYPE_FILE &&
-            is_path_contained(group->items[j].path, group->items[i].path)) {
-          char file_size_str[32];
-          format_size(group->items[j].size, file_size_str,
-                      sizeof(file_size_str));
-          printf("      └─ [文件] %s (%s)\n", group->items[j].path,
-                 file_size_str);
-        }
-      }
+  return ignored;
+}
+
+void git_change_add(GitChangeList *list, const char *path, long long size,
+                    unsigned long long mtime, GitChangeKind kind) {
+  if (list->count >= list->capacity) {
+    list->capacity = list->capacity == 0 ? 256 : list->capacity * 2;
+    list->changes = (GitChange *)safe_realloc(
+        list->changes, sizeof(GitChange) * list->capacity);
+  }
+  GitChange *change = &list->changes[list->count++];
+  size_t length = strlen(path);
+  change->path = (char *)arena_alloc(&g_status_arena, length + 2);
+  memcpy(change->path, path, length + 1);
+  for (char *p = change->path; *p; p++) {
+    if (*p == '/') {
+      *p = '\\';
     }
   }
-  printf("  独立文件列表:\n");
-  int has_independent_files = 0;
-  for (int i = 0; i < group->count; i++) {
-    if (group->items[i].type == TYPE_FILE) {
-      int is_contained = 0;
-      for (int j = 0; j < group->count; j++) {
-        if (group->items[j].type == TYPE_DIRECTORY &&
-            is_path_contained(group->items[i].path, group->items[j].path)) {
-          is_contained = 1;
-          break;
+  if (kind == GIT_CHANGE_UNTRACKED_DIR) {
+    change->path[length] = '\\';
+    change->path[length + 1] = '\0';
+  }
+  change->size = size;
+  change->mtime = mtime;
+  change->kind = kind;
+}
+
+DWORD WINAPI index_stat_worker(LPVOID param) {
+  IndexStatJob *job = (IndexStatJob *)param;
+  const GitIndex *index = job->index;
+  while (1) {
+    LONG block = InterlockedIncrement(&job->next) - 1;
+    int first = block * INDEX_STAT_BLOCK;
+    if (first >= index->entry_count) {
+      break;
+    }
+    int last = first + INDEX_STAT_BLOCK;
+    if (last > index->entry_count) {
+      last = index->entry_count;
+    }
+    for (int i = first; i < last; i++) {
+      const GitIndexEntry *entry = &index->entries[i];
+      job->status[i] = GIT_CHANGE_NONE;
+      if ((entry->mode & 0170000) == 0160000 ||
+          (entry->flags & (INDEX_FLAG_ASSUME_VALID |
+                           INDEX_FLAG_SKIP_WORKTREE))) {
+        continue;
+      }
+      char native[MAX_PATH_LENGTH];
+      snprintf(native, sizeof(native), "%s", entry->path);
+      for (char *p = native; *p; p++) {
+        if (*p == '/') {
+          *p = '\\';
         }
       }
-      if (!is_contained) {
-        char file_size_str[32];
-        format_size(group->items[i].size, file_size_str, sizeof(file_size_str));
-        printf("    [文件] %s (%s)\n", group->items[i].path, file_size_str);
-        has_independent_files = 1;
+      const wchar_t *wpath = path_to_wide(native, 0);
+      if (!wpath) {
+        continue;
+      }
+      WIN32_FILE_ATTRIBUTE_DATA data;
+      if (!GetFileAttributesExW(wpath, GetFileExInfoStandard, &data)) {
+        job->status[i] = GIT_CHANGE_DELETED;
+        continue;
+      }
+      long long size =
+          ((long long)data.nFileSizeHigh << 32) | data.nFileSizeLow;
+      unsigned long long mtime = filetime_to_u64(&data.ftLastWriteTime);
+      unsigned long long unix_time =
+          mtime > UNIX_EPOCH_FILETIME ? mtime - UNIX_EPOCH_FILETIME : 0;
+      unsigned int sec = (unsigned int)(unix_time / 10000000);
+      unsigned int nsec = (unsigned int)(unix_time % 10000000) * 100;
+      job->sizes[i] = size;
+      job->mtimes[i] = mtime;
+      if ((data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) ||
+          (unsigned int)size != entry->size || sec != entry->mtime_sec ||
+          (entry->mtime_nsec != 0 && nsec != entry->mtime_nsec / 100 * 100) ||
+          entry->mtime_sec >= index->mtime_sec ||
+          (entry->flags & INDEX_FLAG_STAGE_MASK)) {
+        job->status[i] = GIT_CHANGE_MODIFIED;
       }
     }
   }
-  if (!has_independent_files) {
-    printf("    无独立文件\n");
-  }
-  printf("\n");
-}
-
-char *get_current_time() {
-  static char time_str[64];
-  time_t now = time(NULL);
-  struct tm *tm_info = localtime(&now);
-  strftime(time_str, sizeof(time_str), "%Y-%m-%d %H:%M:%S", tm_info);
-  return time_str;
+  return 0;
 }
 
-int run_grouping_test_with_git(char *paths[], int path_count,
-                               const char *commit_info_file) {
-  long long total_scanned_size, skipped_files_size;
-  GroupResult result = process_input_paths(
-      paths, path_count, &total_scanned_size, &skipped_files_size);
-  AdditionalFiles additional = print_skipped_files(&result);
-  add_additional_files_to_groups(&result, &additional);
-  print_groups(&result);
-  print_statistics(&result, total_scanned_size, skipped_files_size);
-  validate_result(&result, result.total_input_size, total_scanned_size,
-                  skipped_files_size);
-  execute_git_commands(&result, commit_info_file);
-  free_additional_files(&additional);
-  free_group_result(&result);
-  return 0;
+void collect_tracked_changes(const GitIndex *index, GitChangeList *list) {
+  IndexStatJob job = {0};
+  job.index = index;
+  job.status = (unsigned char *)safe_malloc(index->entry_count + 1);
+  job.sizes =
+      (long long *)safe_malloc(sizeof(long long) * (index->entry_count + 1));
+  job.mtimes = (unsigned long long *)safe_malloc(
+      sizeof(unsigned long long) * (index->entry_count + 1));
+  int thread_count = get_scan_thread_count();
+  HANDLE *threads = (HANDLE *)safe_malloc(sizeof(HANDLE) * thread_count);
+  for (int i = 1; i < thread_count; i++) {
+    threads[i] = CreateThread(NULL, 0, index_stat_worker, &job, 0, NULL);
+  }
+  index_stat_worker(&job);
+  for (int i = 1; i < thread_count; i++) {
+    if (threads[i]) {
+      WaitForSingleObject(threads[i], INFINITE);
+      CloseHandle(threads[i]);
+    }
+  }
+  free(threads);
+  for (int i = 0; i < index->entry_count; i++) {
+    if (job.status[i] == GIT_CHANGE_NONE ||
+        (i > 0 && strcmp(index->entries[i - 1].path,
+                         index->entries[i].path) == 0)) {
+      continue;
+    }
+    git_change_add(list, index->entries[i].path, job.sizes[i], job.mtimes[i],
+                   (GitChangeKind)job.status[i]);
+  }
+  free(job.status);
+  free(job.sizes);
+  free(job.mtimes);
 }
 
-int run_grouping_test(char *paths[], int path_count) {
-  long long total_scanned_size, skipped_files_size;
-  GroupResult result = process_input_paths(
-      paths, path_count, &total_scanned_size, &skipped_files_size);
-  AdditionalFiles additional = print_skipped_files(&result);
-  add_additional_files_to_groups(&result, &additional);
-  print_groups(&result);
-  print_statistics(&result, total_scanned_size, skipped_files_size);
-  validate_result(&result, result.total_input_size, total_scanned_size,
-                  skipped_files_size);
-  free_additional_files(&additional);
-  free_group_result(&result);
-  return 0;
+int untracked_directory_has_files(UntrackedWalk *walk, char *relative,
+                                  size_t length) {
+  char search[MAX_PATH_LENGTH];
+  snprintf(search, sizeof(search), "%s\\*", relative);
+  for (char *p = search; *p; p++) {
+    if (*p == '/') {
+      *p = '\\';
+    }
+  }
+  const wchar_t *wsearch = path_to_wide(search, 0);
+  if (!wsearch) {
+    return 0;
+  }
+  WIN32_FIND_DATAW find_data;
+  HANDLE hFind =
+      FindFirstFileExW(wsearch, FindExInfoBasic, &find_data,
+                       FindExSearchNameMatch, NULL, FIND_FIRST_EX_LARGE_FETCH);
+  if (hFind == INVALID_HANDLE_VALUE) {
+    return 0;
+  }
+  int saved_count = walk->ignores.count;
+  snprintf(search, sizeof(search), "%s\\.gitignore", relative);
+  char base[MAX_PATH_LENGTH];
+  snprintf(base, sizeof(base), "%s/", relative);
+  ignore_list_add_file(&walk->ignores, search, base);
+  int found = 0;
+  do {
+    if (wcscmp(find_data.cFileName, L".") == 0 ||
+        wcscmp(find_data.cFileName, L"..") == 0) {
+      continue;
+    }
+    relative[length] = '/';
+    int name_length = path_from_wide(relative + length + 1,
+                                     MAX_PATH_LENGTH - (int)length - 1,
+                                     find_data.cFileName);
+    if (name_length >= 0) {
+      size_t child_length = length + 1 + name_length;
+      int is_directory =
+          (find_data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0;
+      if (!ignore_list_match(&walk->ignores, relative, is_directory)) {
+        found = is_directory ? untracked_directory_has_files(walk, relative,
+                                                             child_length)
+                             : 1;
+      }
+    }
+    relative[length] = '\0';
+  } while (!found && FindNextFileW(hFind, &find_data));
+  FindClose(hFind);
+  walk->ignores.count = saved_count;
+  return found;
 }
 
-char **get_git_status_paths(int *path_count) {
-  printf("[Git] 正在执行 git status --porcelain...\n");
-  FILE *pipe = _popen("git status --porcelain", "r");
-  if (!pipe) {
-    printf("[错误] 无法执行git命令\n");
-    return NULL;
+void collect_untracked_paths(UntrackedWalk *walk, char *relative,
+                             size_t length) {
+  char search[MAX_PATH_LENGTH];
+  if (length > 0) {
+    snprintf(search, sizeof(search), "%s\\*", relative);
+  } else {
+    strcpy(search, "*");
   }
-  char **paths = (char **)safe_malloc(sizeof(char *) * MAX_ITEMS);
-  *path_count = 0;
-  char line[MAX_PATH_LENGTH * 2];
-  while (fgets(line, sizeof(line), pipe) && *path_count < MAX_ITEMS) {
-    char *path_start = line;
-    int status_chars = 0;
-    while (*path_start &&
-           (*path_start == ' ' || *path_start == 'M' || *path_start == 'A' ||
-            *path_start == 'D' || *path_start == 'R' || *path_start == 'C' ||
-            *path_start == 'U' || *path_start == '?' || *path_start == '!')) {
-      path_start++;
-      status_chars++;
-      if (status_chars >= 3)
-        break;
+  for (char *p = search; *p; p++) {
+    if (*p == '/') {
+      *p = '\\';
     }
-    while (*path_start == ' ') {
-      path_start++;
-    }
-    size_t len = strlen(path_start);
-    if (len > 0 && path_start[len - 1] == '\n') {
-      path_start[len - 1] = '\0';
-      len--;
-    }
-    char *arrow_pos = strstr(path_start, " -> ");
-    if (arrow_pos) {
-      path_start = arrow_pos + 4;
-      len = strlen(path_start);
-    }
-    char *final_path = path_start;
-    if (len >= 2 && path_start[0] == '"' && path_start[len - 1] == '"') {
-      path_start[len - 1] = '\0';
-      final_path = path_start + 1;
-      len -= 2;
-    }
-    char *trimmed_path = final_path;
-    while (*trimmed_path == ' ') {
-      trimmed_path++;
-    }
-    char *end = trimmed_path + strlen(trimmed_path) - 1;
-    while (end > trimmed_path && *end == ' ') {
-      *end = '\0';
-      end--;
-    }
-    if (strlen(trimmed_path) > 0) {
-      int is_directory_indicated = 0;
-      size_t trimmed_len = strlen(trimmed_path);
-      if (trimmed_len > 0 && (trimmed_path[trimmed_len - 1] == '/' ||
-                              trimmed_path[trimmed_len - 1] == '\\')) {
-        is_directory_indicated = 1;
-        char dir_path[MAX_PATH_LENGTH];
-        strcpy_s(dir_path, MAX_PATH_LENGTH, trimmed_path);
-        for (char *p = dir_path; *p; p++) {
-          if (*p == '/')
-            *p = '\\';
-        }
-        size_t dir_len = strlen(dir_path);
-        if (dir_len > 0 && dir_path[dir_len - 1] != '\\') {
-          if (dir_len < MAX_PATH_LENGTH - 1) {
-            strcat_s(dir_path, MAX_PATH_LENGTH, "\\");
-          }
-        }
-        paths[*path_count] = (char *)safe_malloc(strlen(dir_path) + 1);
-        strcpy(paths[*path_count], dir_path);
-        (*path_count)++;
-        printf("  [目录] 添加目录路径: '%s'\n", dir_path);
-      } else {
-        char file_path[MAX_PATH_LENGTH];
-        strcpy_s(file_path, MAX_PATH_LENGTH, trimmed_path);
-        for (char *p = file_path; *p; p++) {
-          if (*p == '/')
-            *p = '\\';
+  }
+  const wchar_t *wsearch = path_to_wide(search, 0);
+  if (!wsearch) {
+    return;
+  }
+  WIN32_FIND_DATAW find_data;
+  HANDLE hFind =
+      FindFirstFileExW(wsearch, FindExInfoBasic, &find_data,
+                       FindExSearchNameMatch, NULL, FIND_FIRST_EX_LARGE_FETCH);
+  if (hFind == INVALID_HANDLE_VALUE) {
+    return;
+  }
+  int saved_count = walk->ignores.count;
+  if (length > 0) {
+    char base[MAX_PATH_LENGTH];
+    snprintf(search, sizeof(search), "%s\\.gitignore", relative);
+    snprintf(base, sizeof(base), "%s/", relative);
+    ignore_list_add_file(&walk->ignores, search, base);
+  }
+  do {
+    if (wcscmp(find_data.cFileName, L".") == 0 ||
+        wcscmp(find_data.cFileName, L"..") == 0 ||
+        (length == 0 && wcscmp(find_data.cFileName, L".git") == 0)) {
+      continue;
+    }
+    size_t offset = length > 0 ? length + 1 : 0;
+    if (length > 0) {
+      relative[length] = '/';
+    }
+    int name_length = path_from_wide(relative + offset,
+                                     MAX_PATH_LENGTH - (int)offset,
+                                     find_data.cFileName);
+    if (name_length < 0) {
+      relative[length] = '\0';
+      continue;
+    }
+    size_t child_length = offset + name_length;
+    int is_directory =
+        (find_data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0;
+    if (!ignore_list_match(&walk->ignores, relative, is_directory)) {
+      if (is_directory) {
+        if (git_index_contains(walk->index, relative, child_length, 1)) {
+          collect_untracked_paths(walk, relative, child_length);
+        } else if (!git_index_contains(walk->index, relative, child_length,
+                                       0) &&
+                   untracked_directory_has_files(walk, relative,
+                                                 child_length)) {
+          git_change_add(walk->changes, relative, -1, 0,
+                         GIT_CHANGE_UNTRACKED_DIR);
         }
-        paths[*path_count] = (char *)safe_malloc(strlen(file_path) + 1);
-        strcpy(paths[*path_count], file_path);
-        (*path_count)++;
-        printf("  [文件] 添加文件路径: '%s'\n", file_path);
+      } else if (!git_index_contains(walk->index, relative, child_length, 0)) {
+        git_change_add(
+            walk->changes, relative,
+            ((long long)find_data.nFileSizeHigh << 32) | find_data.nFileSizeLow,
+            filetime_to_u64(&find_data.ftLastWriteTime), GIT_CHANGE_UNTRACKED);
       }
     }
-  }
-  _pclose(pipe);
-  printf("[Git] 找到 %d 个变更项\n", *path_count);
-  if (*path_count > 0) {
-    printf("[Git] 变更项列表:\n");
-    for (int i = 0; i < *path_count; i++) {
-      DWORD attr = GetFileAttributesA(paths[i]);
-      if (attr == INVALID_FILE_ATTRIBUTES) {
-        printf("  %d. '%s' [无法访问]\n", i + 1, paths[i]);
-      } else if (attr & FILE_ATTRIBUTE_DIRECTORY) {
-        printf("  %d. '%s' [目录]\n", i + 1, paths[i]);
-      } else {
-        printf("  %d. '%s' [文件]\n", i + 1, paths[i]);
+    relative[length] = '\0';
+  } while (FindNextFileW(hFind, &find_data));
+  FindClose(hFind);
+  walk->ignores.count = saved_count;
+}
+
+void path_stat_hints_add(const char *path, long long size,
+                         unsigned long long mtime) {
+  PathStatHints *hints = &g_path_stat_hints;
+  if ((hints->count + 1) * 10 >= hints->capacity * 7) {
+    int new_capacity = hints->capacity == 0 ? 1024 : hints->capacity * 2;
+    PathStatHint *slots =
+        (PathStatHint *)safe_malloc(sizeof(PathStatHint) * new_capacity);
+    memset(slots, 0, sizeof(PathStatHint) * new_capacity);
+    for (int i = 0; i < hints->capacity; i++) {
+      if (hints->slots[i].path) {
+        const char *key = hints->slots[i].path;
+        int slot = (int)(hash_path(key, strlen(key)) & (new_capacity - 1));
+        while (slots[slot].path) {
+          slot = (slot + 1) & (new_capacity - 1);
+        }
+        slots[slot] = hints->slots[i];
       }
     }
+    free(hints->slots);
+    hints->slots = slots;
+    hints->capacity = new_capacity;
   }
-  return paths;
+  int slot = (int)(hash_path(path, strlen(path)) & (hints->capacity - 1));
+  while (hints->slots[slot].path && strcmp(hints->slots[slot].path, path)) {
+    slot = (slot + 1) & (hints->capacity - 1);
+  }
+  if (!hints->slots[slot].path) {
+    size_t length = strlen(path);
+    hints->slots[slot].path = (char *)safe_malloc(length + 1);
+    memcpy(hints->slots[slot].path, path, length + 1);
+    hints->count++;
+  }
+  hints->slots[slot].size = size;
+  hints->slots[slot].mtime = mtime;
 }
 
-void normalize_directory_path(char *path) {
-  if (!path || strlen(path) == 0)
-    return;
-  normalize_path(path);
-  size_t len = strlen(path);
-  if (len > 0 && path[len - 1] != '\\') {
-    if (len == 2 && path[1] == ':') {
-      if (len < MAX_PATH_LENGTH - 1) {
-        path[len] = '\\';
-        path[len + 1] = '\0';
-      }
-    } else if (!(len == 3 && path[1] == ':' && path[2] == '\\')) {
-      if (len < MAX_PATH_LENGTH - 1) {
-        path[len] = '\\';
-        path[len + 1] = '\0';
-      }
+int path_stat_hints_get(const char *path, long long *size,
+                        unsigned long long *mtime) {
+  const PathStatHints *hints = &g_path_stat_hints;
+  if (hints->capacity == 0) {
+    return 0;
+  }
+  int slot = (int)(hash_path(path, strlen(path)) & (hints->capacity - 1));
+  while (hints->slots[slot].path) {
+    if (strcmp(hints->slots[slot].path, path) == 0) {
+      *size = hints->slots[slot].size;
+      *mtime = hints->slots[slot].mtime;
+      return 1;
     }
+    slot = (slot + 1) & (hints->capacity - 1);
   }
+  return 0;
 }
 
-void free_git_status_paths(char **paths, int path_count) {
-  for (int i = 0; i < path_count; i++) {
-    free(paths[i]);
+void path_stat_hints_free(void) {
+  for (int i = 0; i < g_path_stat_hints.capacity; i++) {
+    free(g_path_stat_hints.slots[i].path);
   }
-  free(paths);
+  free(g_path_stat_hints.slots);
+  memset(&g_path_stat_hints, 0, sizeof(PathStatHints));
+}
+
+char **get_git_index_paths(int *path_count) {
+  printf("[Git] 正在读取 .git\\index...\n");
+  double start_time = get_time_seconds();
+  GitIndex index;
+  if (!git_index_load(&index)) {
+    git_index_free(&index);
+    return NULL;
+  }
+  printf("[Git] 索引版本 %u, %d 个条目\n", index.version, index.entry_count);
+  GitChangeList changes = {0};
+  collect_tracked_changes(&index, &changes);
+  int tracked_changes = changes.count;
+  UntrackedWalk walk = {0};
+  walk.index = &index;
+  walk.changes = &changes;
+  arena_init(&walk.ignores.strings, 64 * 1024);
+  ignore_list_add_file(&walk.ignores, ".git\\info\\exclude", "");
+  ignore_list_add_file(&walk.ignores, ".gitignore", "");
+  char relative[MAX_PATH_LENGTH] = "";
+  collect_untracked_paths(&walk, relative, 0);
+  free(walk.ignores.patterns);
+  arena_free_all(&walk.ignores.strings);
+  git_index_free(&index);
+  char **paths = (char **)safe_malloc(sizeof(char *) * (changes.count + 1));
+  *path_count = 0;
+  for (int i = 0; i < changes.count; i++) {
+    GitChange *change = &changes.changes[i];
+    paths[(*path_count)++] = change->path;
+    if (change->kind == GIT_CHANGE_UNTRACKED_DIR) {
+      printf("  [目录] 未跟踪目录: '%s'\n", change->path);
+    } else if (change->kind == GIT_CHANGE_DELETED) {
+      printf("  [文件] 已删除: '%s'\n", change->path);
+    } else {
+      char size_str[32];
+      format_size(change->size, size_str, sizeof(size_str));
+      printf("  [文件] %s: '%s' (%s)\n",
+             change->kind == GIT_CHANGE_UNTRACKED ? "未跟踪" : "已修改",
+             change->path, size_str);
+      path_stat_hints_add(change->path, change->size, change->mtime);
+    }
+  }
+  free(changes.changes);
+  printf("[Git] 找到 %d 个变更项 (已跟踪 %d, 未跟踪 %d), 耗时 %.3f 秒\n",
+         *path_count, tracked_changes, *path_count - tracked_changes,
+         get_time_seconds() - start_time);
+  return paths;
 }
 
 int create_temp_commit_file(const char *temp_filename) {
@@ -2342,7 +6949,7 @@ int create_temp_commit_file(const char *temp_filename) {
       free(wtemp_dir);
     }
   }
-  FILE *file = fopen(temp_filename, "w");
+  FILE *file = compat_fopen(temp_filename, "w");
   if (!file) {
     printf("[错误] 无法创建临时文件: %s\n", temp_filename);
     return 0;
@@ -2374,7 +6981,7 @@ int create_temp_commit_file(const char *temp_filename) {
   fclose(file);
   if (line_count == 0) {
     printf("[警告] 未输入任何提交信息，使用默认信息\n");
-    file = fopen(temp_filename, "w");
+    file = compat_fopen(temp_filename, "w");
     if (file) {
       fprintf(file, "自动提交 - %s\n", get_current_time());
       fclose(file);
@@ -2389,7 +6996,7 @@ int create_temp_commit_file(const char *temp_filename) {
   if (line_count > 0) {
     printf("提交信息内容:\n");
     printf("----------------------------------------\n");
-    file = fopen(temp_filename, "r");
+    file = compat_fopen(temp_filename, "r");
     if (file) {
       fseek(file, 3, SEEK_SET);
       char buffer[1024];
@@ -2406,6 +7013,163 @@ int create_temp_commit_file(const char *temp_filename) {
   return 1;
 }
 
+int run_scan_benchmark(const char *path) {
+  char normalized_path[MAX_PATH_LENGTH];
+  strcpy_s(normalized_path, MAX_PATH_LENGTH, path);
+  normalize_path(normalized_path);
+  ItemList items = {0};
+  double best_seconds = 0;
+  long long directories = 0, entries = 0;
+  for (int round = 0; round < 3; round++) {
+    GroupResult result = {0};
+    int has_large_files = 0;
+    long long scanned_size = 0, skipped_size = 0, packed_size = 0;
+    items.count = 0;
+    scan_directory_tree(normalized_path, &items, &scanned_size, &skipped_size,
+                        &result, &has_large_files, &packed_size);
+    if (round == 0 || result.scan_stats.elapsed_seconds < best_seconds) {
+      best_seconds = result.scan_stats.elapsed_seconds;
+    }
+    directories = result.scan_stats.directories_scanned;
+    entries = result.scan_stats.entries_scanned;
+    free(result.skipped_files);
+    path_arena_free();
+  }
+  free(items.items);
+  printf("BENCH dirs=%lld entries=%lld seconds=%.6f us_per_dir=%.3f "
+         "entries_per_sec=%.0f backend=%s\n",
+         directories, entries, best_seconds,
+         directories > 0 ? best_seconds * 1e6 / directories : 0.0,
+         best_seconds > 0 ? entries / best_seconds : 0.0,
+         scan_backend_name(g_run_options.scan_backend));
+  return 0;
+}
+
+int run_convert_benchmark(const char *path) {
+  char normalized_path[MAX_PATH_LENGTH];
+  strcpy_s(normalized_path, MAX_PATH_LENGTH, path);
+  normalize_path(normalized_path);
+  ItemList items = {0};
+  GroupResult result = {0};
+  int has_large_files = 0;
+  long long scanned_size = 0, skipped_size = 0, packed_size = 0;
+  g_run_options.dedup = 1;
+  scan_directory_tree(normalized_path, &items, &scanned_size, &skipped_size,
+                      &result, &has_large_files, &packed_size);
+  free(result.skipped_files);
+  int count = items.count;
+  if (count == 0) {
+    printf("[错误] 目录中没有可用于测试的文件: %s\n", normalized_path);
+    free(items.items);
+    path_arena_free();
+    return 1;
+  }
+  wchar_t **wide_paths = (wchar_t **)safe_malloc(sizeof(wchar_t *) * count);
+  for (int i = 0; i < count; i++) {
+    wide_paths[i] = char_to_wchar(item_path(&items.items[i]));
+  }
+  double best_old = 0, best_new = 0;
+  size_t checksum = 0;
+  char buffer[MAX_PATH_LENGTH];
+  for (int round = 0; round < 5; round++) {
+    double start = get_time_seconds();
+    for (int i = 0; i < count; i++) {
+      char *narrow = wchar_to_char(wide_paths[i]);
+      wchar_t *wide = narrow ? char_to_wchar(narrow) : NULL;
+      checksum += narrow ? strlen(narrow) : 0;
+      free(narrow);
+      free(wide);
+    }
+    double old_seconds = get_time_seconds() - start;
+    start = get_time_seconds();
+    for (int i = 0; i < count; i++) {
+      const char *narrow = item_path(&items.items[i]);
+      size_t length = strlen(narrow);
+      memcpy(buffer, narrow, length + 1);
+      checksum += path_to_wide(buffer, 0) ? length : 0;
+    }
+    double new_seconds = get_time_seconds() - start;
+    if (round == 0 || old_seconds < best_old) {
+      best_old = old_seconds;
+    }
+    if (round == 0 || new_seconds < best_new) {
+      best_new = new_seconds;
+    }
+  }
+  for (int i = 0; i < count; i++) {
+    free(wide_paths[i]);
+  }
+  free(wide_paths);
+  free(items.items);
+  path_arena_free();
+  printf("BENCH paths=%d old_ns_per_path=%.1f new_ns_per_path=%.1f "
+         "speedup=%.2f checksum=%zu\n",
+         count, best_old * 1e9 / count, best_new * 1e9 / count,
+         best_new > 0 ? best_old / best_new : 0.0, checksum);
+  return 0;
+}
+
+const char *parse_run_options(int argc, char *argv[]) {
+  const char *positional = NULL;
+  for (int i = 1; i < argc; i++) {
+    if (strncmp(argv[i], "--scan-threads=", 15) == 0) {
+      g_run_options.scan_threads = atoi(argv[i] + 15);
+    } else if (strncmp(argv[i], "--bench-scan=", 13) == 0) {
+      g_run_options.bench_scan_path = argv[i] + 13;
+    } else if (strncmp(argv[i], "--bench-convert=", 16) == 0) {
+      g_run_options.bench_convert_path = argv[i] + 16;
+    } else if (strcmp(argv[i], "--estimate-pack") == 0) {
+      g_run_options.estimate_pack = 1;
+    } else if (strncmp(argv[i], "--pack-margin=", 14) == 0) {
+      g_run_options.pack_margin = atoi(argv[i] + 14);
+    } else if (strcmp(argv[i], "--verify-pack") == 0) {
+      g_run_options.verify_pack = 1;
+    } else if (strcmp(argv[i], "--dedup") == 0) {
+      g_run_options.dedup = 1;
+    } else if (strcmp(argv[i], "--scan-cache") == 0) {
+      g_run_options.scan_cache = 1;
+    } else if (strcmp(argv[i], "--native-index") == 0) {
+      g_run_options.native_index = 1;
+    } else if (strcmp(argv[i], "--split-mode=fixed") == 0) {
+      g_run_options.split_mode = SPLIT_MODE_FIXED;
+    } else if (strcmp(argv[i], "--split-mode=cdc") == 0) {
+      g_run_options.split_mode = SPLIT_MODE_CDC;
+    } else if (strncmp(argv[i], "--cdc-min=", 10) == 0) {
+      g_run_options.cdc.min_size = atoll(argv[i] + 10) * 1024 * 1024;
+    } else if (strncmp(argv[i], "--cdc-avg=", 10) == 0) {
+      g_run_options.cdc.avg_size = atoll(argv[i] + 10) * 1024 * 1024;
+    } else if (strncmp(argv[i], "--cdc-max=", 10) == 0) {
+      g_run_options.cdc.max_size = atoll(argv[i] + 10) * 1024 * 1024;
+    } else if (strcmp(argv[i], "--verify-split") == 0) {
+      g_run_options.verify_split = 1;
+    } else if (strcmp(argv[i], "--split-incremental") == 0) {
+      g_run_options.split_incremental = 1;
+    } else if (strncmp(argv[i], "--split-jobs=", 13) == 0) {
+      g_run_options.split_jobs = atoi(argv[i] + 13);
+    } else if (strncmp(argv[i], "--split-copy=", 13) == 0) {
+      if (!parse_copy_method(argv[i] + 13, &g_run_options.split_copy)) {
+        printf("[警告] 未知复制方式: %s (可选 clone, copy-range, sendfile, "
+               "buffer)\n",
+               argv[i] + 13);
+      }
+    } else if (strncmp(argv[i], "--scan-backend=", 15) == 0) {
+      if (!parse_scan_backend(argv[i] + 15, &g_run_options.scan_backend)) {
+        printf("[警告] 不可用的扫描后端: %s\n", argv[i] + 15);
+      }
+    } else if (strncmp(argv[i], "--pack=", 7) == 0) {
+      if (!parse_pack_strategy(argv[i] + 7, &g_run_options.pack_strategy)) {
+        printf("[警告] 未知装箱策略: %s (可选 bfd, ffd, kk, bnb, auto)\n",
+               argv[i] + 7);
+      }
+    } else if (strncmp(argv[i], "--", 2) == 0) {
+      printf("[警告] 未知选项: %s\n", argv[i]);
+    } else if (!positional) {
+      positional = argv[i];
+    }
+  }
+  return positional;
+}
+
 int main(int argc, char *argv[]) {
   SetConsoleOutputCP(CP_UTF8);
   printf("========================================\n");
@@ -2419,8 +7183,50 @@ int main(int argc, char *argv[]) {
   int use_git = 0;
   int temp_file_created = 0;
   char temp_commit_file[MAX_PATH_LENGTH];
-  if (argc >= 2) {
-    commit_info_file = argv[1];
+  const char *commit_arg = parse_run_options(argc, argv);
+  printf("扫描线程数: %d\n", get_scan_thread_count());
+  printf("装箱策略: %s\n", pack_strategy_name(g_run_options.pack_strategy));
+#ifndef _WIN32
+  if (g_run_options.scan_backend == SCAN_BACKEND_URING &&
+      !uring_backend_available()) {
+    printf("[警告] io_uring 不可用, 回退到 getdents 同步扫描\n");
+    g_run_options.scan_backend = SCAN_BACKEND_GETDENTS;
+  }
+#endif
+  printf("扫描后端: %s\n", scan_backend_name(g_run_options.scan_backend));
+  if (g_run_options.split_mode == SPLIT_MODE_CDC) {
+    if (!cdc_params_prepare(&g_run_options.cdc)) {
+      printf("[警告] 分块大小无效 (需满足 最小 < 平均 < 最大 <= %lld MB), "
+             "使用默认值\n",
+             MAX_FILE_SIZE / (1024 * 1024));
+      g_run_options.cdc.min_size = CDC_DEFAULT_MIN;
+      g_run_options.cdc.avg_size = CDC_DEFAULT_AVG;
+      g_run_options.cdc.max_size = CDC_DEFAULT_MAX;
+      cdc_params_prepare(&g_run_options.cdc);
+    }
+    printf("拆分模式: 内容定义分块 (最小 %lld MB, 平均 %lld MB, 最大 %lld "
+           "MB)\n",
+           g_run_options.cdc.min_size / (1024 * 1024),
+           g_run_options.cdc.avg_size / (1024 * 1024),
+           g_run_options.cdc.max_size / (1024 * 1024));
+  }
+  if (g_run_options.estimate_pack) {
+    printf("按压缩估算分组 (安全余量 %d%%)\n", g_run_options.pack_margin);
+    estimate_cache_load();
+  }
+  if (g_run_options.scan_cache) {
+    scan_cache_open(&g_scan_cache);
+  }
+  if (g_run_options.bench_scan_path) {
+    int status = run_scan_benchmark(g_run_options.bench_scan_path);
+    scan_cache_save(&g_scan_cache);
+    return status;
+  }
+  if (g_run_options.bench_convert_path) {
+    return run_convert_benchmark(g_run_options.bench_convert_path);
+  }
+  if (commit_arg) {
+    commit_info_file = commit_arg;
     use_git = 1;
     printf("提交信息文件: %s\n\n", commit_info_file);
   } else {
@@ -2444,7 +7250,16 @@ int main(int argc, char *argv[]) {
     }
   }
   int path_count = 0;
-  char **input_paths = get_git_status_paths(&path_count);
+  char **input_paths = NULL;
+  if (g_run_options.native_index) {
+    input_paths = get_git_index_paths(&path_count);
+    if (!input_paths) {
+      printf("[警告] 无法使用 .git\\index 快速路径，改用 git status\n");
+    }
+  }
+  if (!input_paths) {
+    input_paths = get_git_status_paths(&path_count);
+  }
   if (path_count == 0 || !input_paths) {
     printf("[错误] 无法从git status获取文件列表或没有变更文件\n");
     exit(2);
@@ -2462,6 +7277,8 @@ int main(int argc, char *argv[]) {
   } else {
     run_grouping_test(input_paths, path_count);
   }
+  estimate_cache_save();
+  scan_cache_save(&g_scan_cache);
   if (temp_file_created) {
     remove(temp_commit_file);
     printf("[清理] 已删除临时提交信息文件: %s\n", temp_commit_file);
@@ -2471,6 +7288,7 @@ int main(int argc, char *argv[]) {
       free_git_status_paths(input_paths, path_count);
     }
   }
+  path_stat_hints_free();
   printf("\n[完成] 所有处理完成！\n");
   return 0;
 }